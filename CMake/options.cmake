@@ -466,6 +466,17 @@ if(FLTK_USE_POLL)
   check_symbol_exists(poll   "poll.h"   USE_POLL)
 endif(FLTK_USE_POLL)
 
+option(FLTK_USE_EPOLL "use epoll on Linux if available" OFF)
+mark_as_advanced(FLTK_USE_EPOLL)
+
+if(FLTK_USE_EPOLL)
+  check_symbol_exists(epoll_create1 "sys/epoll.h" USE_EPOLL)
+  check_symbol_exists(timerfd_create "sys/timerfd.h" HAVE_TIMERFD)
+  if(NOT HAVE_TIMERFD)
+    set(USE_EPOLL 0)
+  endif()
+endif(FLTK_USE_EPOLL)
+
 #######################################################################
 option(FLTK_BUILD_SHARED_LIBS
   "Build shared libraries in addition to static libraries"
@@ -1045,6 +1056,18 @@ else(FLTK_USE_XRENDER)
   set(FLTK_XRENDER_FOUND FALSE)
 endif(FLTK_USE_XRENDER)
 
+#######################################################################
+if(X11_XShm_FOUND)
+  option(FLTK_USE_XSHM "use the X shared memory extension" ON)
+endif(X11_XShm_FOUND)
+
+if(FLTK_USE_XSHM)
+  set(HAVE_XSHM ${X11_XShm_FOUND})
+  if(HAVE_XSHM)
+    list(APPEND FLTK_BUILD_INCLUDE_DIRECTORIES ${X11_XShm_INCLUDE_PATH})
+  endif(HAVE_XSHM)
+endif(FLTK_USE_XSHM)
+
 #######################################################################
 set(FL_NO_PRINT_SUPPORT FALSE)
 if(X11_FOUND AND NOT FLTK_OPTION_PRINT_SUPPORT)
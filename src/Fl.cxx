@@ -30,6 +30,7 @@
 
 #include <stdlib.h>
 #include "flstring.h"
+#include <unordered_map>
 
 #if defined(DEBUG) || defined(DEBUG_WATCH)
 #  include <stdio.h>
@@ -83,6 +84,8 @@ int             Fl::Private::e_x_down { 0 };
 int             Fl::Private::e_y_down { 0 };
 
 int             Fl::Private::selection_to_clipboard_ = 0;
+int             Fl::Private::compress_motion_ = 0;
+std::vector<int> Fl::Private::merged_motion_;
 
 Fl_Window       *fl_xfocus = NULL; // which window X thinks has focus
 Fl_Window       *fl_xmousewin;     // which window X thinks has FL_ENTER
@@ -134,6 +137,82 @@ int Fl::selection_to_clipboard() {
   return Private::selection_to_clipboard_;
 }
 
+/**
+  Merges consecutive mouse motion events if enabled.
+
+  If the program handles mouse motion slower than the events arrive, for
+  instance when dragging over a slow network connection or when each
+  FL_DRAG redraws a complex canvas, the system queues many motion events.
+  If this is switched on (\p mode = 1), FLTK delivers a run of queued
+  motion events for the same window and the same buttons and modifier
+  keys as a single FL_MOVE or FL_DRAG event at the latest position.
+  Programs that need every position, for instance to draw smooth strokes,
+  can get the positions of the merged events with
+  Fl::event_merged_motions() and Fl::event_merged_motion().
+
+  Expose events do not need this option: exposed areas are always merged
+  into the damaged region of the window, which is drawn once by the next
+  Fl::flush().
+
+  This method can be called on all platforms, but currently only the X11
+  platform merges motion events. The default is disabled.
+
+  \note System event handlers (see Fl::add_system_handler()) do not see
+    the merged motion events.
+
+  \param[in]  mode  1 = merge motion events, 0 = deliver all motion events
+
+  \since 1.5.0
+*/
+void Fl::compress_motion(int mode) {
+  Private::compress_motion_ = mode ? 1 : 0;
+}
+
+/**
+  \brief Returns the current motion compression mode.
+
+  \see void compress_motion(int)
+*/
+int Fl::compress_motion() {
+  return Private::compress_motion_;
+}
+
+/**
+  Returns the number of mouse motion events merged into the current event.
+
+  This is only non-zero during the handling of FL_MOVE and FL_DRAG events
+  if Fl::compress_motion() is enabled and motion events were merged.
+
+  \see Fl::event_merged_motion(int i, int &X, int &Y)
+  \since 1.5.0
+*/
+int Fl::event_merged_motions() {
+  return (int)Private::merged_motion_.size() / 2;
+}
+
+/**
+  Returns the position of a mouse motion event merged into the current event.
+
+  The positions are relative to the window, like Fl::event_x() and
+  Fl::event_y(), and ordered from the oldest (\p i = 0) to the newest,
+  followed by the position of the current event itself.
+
+  \param[in]   i     index from 0 to Fl::event_merged_motions() - 1
+  \param[out]  X, Y  the mouse position of the merged event
+
+  \see Fl::compress_motion(int)
+  \since 1.5.0
+*/
+void Fl::event_merged_motion(int i, int &X, int &Y) {
+  if (i < 0 || i >= event_merged_motions()) {
+    X = Fl::e_x;
+    Y = Fl::e_y;
+    return;
+  }
+  X = Private::merged_motion_[2 * i];
+  Y = Private::merged_motion_[2 * i + 1];
+}
+
 //
 // Drivers
 //
@@ -456,6 +535,38 @@ int Fl::remove_next_timeout(Fl_Timeout_Handler cb, void *data, void **data_retur
   return Fl_Timeout::remove_next_timeout(cb, data, data_return);
 }
 
+/**
+  Allows matching timeouts to run up to \p slack seconds late.
+
+  Fl::wait() can then run timeouts that expire close to each other in
+  a single wakeup instead of waking up for each of them, which saves
+  power in applications with many timers, for instance animations and
+  periodic status updates that do not need to be exact.
+
+  The slack applies to the active timeouts with the callback \p cb and
+  the given \p data. A timeout that is scheduled again with
+  Fl::repeat_timeout() in its callback keeps its slack, and the next
+  expiration time is still computed from the scheduled expiration time.
+  Timeouts added with Fl::add_timeout() have no slack.
+
+  \code
+    Fl::add_timeout(1.0, status_cb, data);
+    Fl::timeout_slack(0.2, status_cb, data); // may run up to 1.2 s from now
+  \endcode
+
+  \param[in]  slack maximum delay in seconds after the expiration time
+  \param[in]  cb    Timer callback (must match)
+  \param[in]  data  Wildcard if NULL (default), must match otherwise
+
+  \see Fl::add_timeout(double time, Fl_Timeout_Handler cb, void *data)
+  \see Fl::repeat_timeout(double time, Fl_Timeout_Handler cb, void *data)
+
+  \since 1.5.0
+*/
+void Fl::timeout_slack(double slack, Fl_Timeout_Handler cb, void *data) {
+  Fl_Timeout::timeout_slack(slack, cb, data);
+}
+
 /**
   Return a list of all currently running timeouts.
   \return a vector with all relevant timeout data
@@ -1965,9 +2076,14 @@ void Fl::do_widget_deletion() {
 }
 
 
-static Fl_Widget ***widget_watch = 0;
-static int num_widget_watch = 0;
-static int max_widget_watch = 0;
+// The widget watch list: watched pointers by the widget they pointed to
+// when they were added, and the same widget by watched pointer.
+// These are allocated on first use and never freed, because static widgets
+// may be destroyed after the static objects of this file.
+typedef std::unordered_multimap<const Fl_Widget*, Fl_Widget**> Widget_Watch;
+typedef std::unordered_map<Fl_Widget**, const Fl_Widget*> Watched_Pointers;
+static Widget_Watch *widget_watch = 0;
+static Watched_Pointers *watched_pointers = 0;
 
 
 /**
@@ -2006,6 +2122,15 @@ static int max_widget_watch = 0;
    This works, because all widgets call Fl::clear_widget_pointer() in their
    destructors.
 
+   The watch list is a hash table indexed by widget, hence adding, releasing,
+   and clearing widget pointers takes constant time.
+
+   \note While a pointer is watched it may be set to NULL, but if it is
+   changed to point to another widget this function must be called again
+   to watch the new widget. Otherwise the pointer is \e not cleared when
+   the new widget is deleted. FLTK 1.4 and older cleared it anyway, because
+   they searched all watched pointers whenever a widget was deleted.
+
    \see Fl::release_widget_pointer()
    \see Fl::clear_widget_pointer()
 
@@ -2018,18 +2143,20 @@ static int max_widget_watch = 0;
 void Fl::watch_widget_pointer(Fl_Widget *&w)
 {
   Fl_Widget **wp = &w;
-  int i;
-  for (i=0; i<num_widget_watch; ++i) {
-    if (widget_watch[i]==wp) return;
+  if (!widget_watch) {
+    widget_watch = new Widget_Watch;
+    watched_pointers = new Watched_Pointers;
   }
-  if (num_widget_watch==max_widget_watch) {
-    max_widget_watch += 8;
-    widget_watch = (Fl_Widget***)realloc(widget_watch, sizeof(Fl_Widget**)*max_widget_watch);
+  auto p = watched_pointers->find(wp);
+  if (p != watched_pointers->end()) {
+    if (p->second == w) return;
+    release_widget_pointer(w); // watched, but points to another widget now
   }
-  widget_watch[num_widget_watch++] = wp;
+  (*watched_pointers)[wp] = w;
+  widget_watch->insert(std::make_pair((const Fl_Widget*)w, wp));
 #ifdef DEBUG_WATCH
-  printf ("\nwatch_widget_pointer:   (%d/%d) %8p => %8p\n",
-    num_widget_watch,num_widget_watch,wp,*wp);
+  printf ("\nwatch_widget_pointer:   (%d) %8p => %8p\n",
+    (int)watched_pointers->size(),wp,*wp);
   fflush(stdout);
 #endif // DEBUG_WATCH
 }
@@ -2048,25 +2175,22 @@ void Fl::watch_widget_pointer(Fl_Widget *&w)
 void Fl::release_widget_pointer(Fl_Widget *&w)
 {
   Fl_Widget **wp = &w;
-  int i,j=0;
-  for (i=0; i<num_widget_watch; ++i) {
-    if (widget_watch[i]!=wp) {
-      if (j<i) widget_watch[j] = widget_watch[i]; // fill gap
-      j++;
-    }
-#ifdef DEBUG_WATCH
-    else { // found widget pointer
-      printf("release_widget_pointer: (%d/%d) %8p => %8p\n",
-             i+1, num_widget_watch, wp, *wp);
+  if (!watched_pointers) return;
+  auto p = watched_pointers->find(wp);
+  if (p == watched_pointers->end()) return;
+  auto range = widget_watch->equal_range(p->second);
+  for (auto it = range.first; it != range.second; ++it) {
+    if (it->second == wp) {
+      widget_watch->erase(it);
+      break;
     }
-#endif //DEBUG_WATCH
   }
-  num_widget_watch = j;
+  watched_pointers->erase(p);
 #ifdef DEBUG_WATCH
-  printf ("                        num_widget_watch = %d\n\n",num_widget_watch);
+  printf("release_widget_pointer: %8p => %8p\n", wp, *wp);
+  printf ("                        watched pointers = %d\n\n",(int)watched_pointers->size());
   fflush(stdout);
 #endif // DEBUG_WATCH
-  return;
 }
 
 
@@ -2079,7 +2203,9 @@ void Fl::release_widget_pointer(Fl_Widget *&w)
   \note Internal use only !
 
   This method searches the widget watch list for pointers to the widget and
-  clears each pointer that points to it. Widget pointers can be added to the
+  clears each pointer that points to it. Only pointers that pointed to the
+  widget when they were last passed to Fl::watch_widget_pointer() are found.
+  Widget pointers can be added to the
   widget watch list by calling Fl::watch_widget_pointer() or by using the
   helper class Fl_Widget_Tracker (recommended).
 
@@ -2088,12 +2214,11 @@ void Fl::release_widget_pointer(Fl_Widget *&w)
 */
 void Fl::clear_widget_pointer(Fl_Widget const *w)
 {
-  if (w==0L) return;
-  int i;
-  for (i=0; i<num_widget_watch; ++i) {
-    if (widget_watch[i] && *widget_watch[i]==w) {
-      *widget_watch[i] = 0L;
-    }
+  if (w==0L || !widget_watch || widget_watch->empty()) return;
+  auto range = widget_watch->equal_range(w);
+  for (auto it = range.first; it != range.second; ++it) {
+    if (*it->second == w)
+      *it->second = 0L;
   }
 }
 
@@ -26,20 +26,25 @@
 #include <FL/Fl_Select_Browser.H>
 
 
-// I modified this from the original Forms data to use a linked list
-// so that the number of items in the browser and size of those items
-// is unlimited. The only problem is that the old browser used an
-// index number to identify a line, and it is slow to convert from/to
-// a pointer. I use a cache of the last match to try to speed this up.
+// The lines are kept in an array of pointers, so that the number of
+// items in the browser and size of those items is unlimited, and a line
+// can be found by its number in constant time. Every line remembers its
+// index in the array. After a line was inserted or removed in the middle,
+// the indexes below it are renumbered when one of them is needed.
+
+// The browser also caches the height of every line and the sum of the
+// heights above every line, so that the line at a scroll position and the
+// position of a line can be found without adding up all heights above it.
+// The sums are recomputed from the first line whose height changed.
 
 // Also added the ability to "hide" a line. This sets its height to
 // zero, so the Fl_Browser_ cannot pick it.
 
-struct FL_BLINE {       // data is in a linked list of these
-  FL_BLINE* prev;
-  FL_BLINE* next;
+struct FL_BLINE {       // data is in an array of these
   void* data;
   Fl_Image* icon;
+  int index;            // index in the array, valid if less than indexed_
+  int height;           // cached item_height(), or -1 if unknown
   short length;         // allocated size of txt[] (excl. null terminator); current string may be shorter
   char flags;           // selected, displayed
   char txt[1];          // start of allocated array
@@ -90,6 +95,72 @@ short Fl_Browser::bline_length(const FL_BLINE* b) const {
   return b->length;
 }
 
+// Returns the 0-based index of item, renumbering the lines if needed.
+int Fl_Browser::line_index(const FL_BLINE *item) const {
+  if (item->index < indexed_ && items_[item->index] == item)
+    return item->index;
+  for (; indexed_ < lines; indexed_++)
+    items_[indexed_]->index = indexed_;
+  return item->index;
+}
+
+// Returns the cached item_height() of line i (0-based).
+int Fl_Browser::line_height(int i) const {
+  FL_BLINE *l = items_[i];
+  if (l->height < 0) l->height = item_height(l);
+  return l->height;
+}
+
+// Recomputes the cached heights of all lines, full_height_, and drops tops_.
+void Fl_Browser::update_heights() const {
+  full_height_ = 0;
+  for (int i = 0; i < lines; i++) {
+    FL_BLINE *l = items_[i];
+    l->height = item_height(l);
+    if (!(l->flags & BLINE_NOTDISPLAYED))
+      full_height_ += l->height + linespacing();
+  }
+  tops_font_ = textfont();
+  tops_spacing_ = linespacing();
+  changed_from(0);
+}
+
+// Updates the cached heights if textfont() or linespacing() was changed.
+void Fl_Browser::check_heights() const {
+  if (tops_font_ != textfont() || tops_spacing_ != linespacing())
+    update_heights();
+}
+
+// Makes sure that the first n entries of tops_ are valid.
+// Hidden lines have no height and no spacing.
+void Fl_Browser::update_tops(int n) const {
+  check_heights();
+  if ((int)tops_.size() < lines + 1)
+    tops_.resize(lines + 1);
+  tops_[0] = 0;
+  for (; tops_valid_ < n; tops_valid_++) {
+    int h = line_height(tops_valid_-1);
+    tops_[tops_valid_] = tops_[tops_valid_-1] + (h ? h + tops_spacing_ : 0);
+  }
+}
+
+// Drops the indexes and positions of the lines from i (0-based) on.
+void Fl_Browser::changed_from(int i) const {
+  if (indexed_ > i) indexed_ = i;
+  if (tops_valid_ > i + 1) tops_valid_ = i + 1;
+}
+
+/**
+  Recomputes the cached heights of all lines and full_height().
+  A subclass must call this when it changes something that item_height()
+  depends on, other than the text, icon, and visibility of a line,
+  textfont(), textsize(), linespacing(), format_char(), column_char(),
+  and column_widths().
+*/
+void Fl_Browser::recalc_heights() {
+  update_heights();
+}
+
 
 /**
   Returns the very first item in the list.
@@ -103,7 +174,7 @@ short Fl_Browser::bline_length(const FL_BLINE* b) const {
   \returns The first item, or NULL if list is empty.
   \see item_first(), item_last(), item_next(), item_prev()
 */
-void* Fl_Browser::item_first() const {return first;}
+void* Fl_Browser::item_first() const {return lines ? items_[0] : 0;}
 
 /**
   Returns the next item after \p item.
@@ -111,7 +182,10 @@ void* Fl_Browser::item_first() const {return first;}
   \returns The next item after \p item, or NULL if there are none after this one.
   \see item_first(), item_last(), item_next(), item_prev()
 */
-void* Fl_Browser::item_next(void* item) const {return ((FL_BLINE*)item)->next;}
+void* Fl_Browser::item_next(void* item) const {
+  int i = line_index((FL_BLINE*)item) + 1;
+  return i < lines ? items_[i] : 0;
+}
 
 /**
   Returns the previous item before \p item.
@@ -119,7 +193,10 @@ void* Fl_Browser::item_next(void* item) const {return ((FL_BLINE*)item)->next;}
   \returns The previous item before \p item, or NULL if there are none before this one.
   \see item_first(), item_last(), item_next(), item_prev()
 */
-void* Fl_Browser::item_prev(void* item) const {return ((FL_BLINE*)item)->prev;}
+void* Fl_Browser::item_prev(void* item) const {
+  int i = line_index((FL_BLINE*)item) - 1;
+  return i >= 0 ? items_[i] : 0;
+}
 
 /**
   Returns the very last item in the list.
@@ -133,7 +210,7 @@ void* Fl_Browser::item_prev(void* item) const {return ((FL_BLINE*)item)->prev;}
   \returns The last item, or NULL if list is empty.
   \see item_first(), item_last(), item_next(), item_prev()
 */
-void* Fl_Browser::item_last() const {return last;}
+void* Fl_Browser::item_last() const {return lines ? items_[lines-1] : 0;}
 
 /**
   See if \p item is selected.
@@ -167,13 +244,7 @@ const char *Fl_Browser::item_text(void *item) const {
 /**
   Returns the item for specified \p line.
 
-  Note: This call is slow. It's fine for e.g. responding to user
-  clicks, but slow if called often, such as in a tight sorting loop.
-  Finding an item 'by line' involves a linear lookup on the internal
-  linked list. The performance hit can be significant if the browser's
-  contents is large, and the method is called often (e.g. during a sort).
-  If you're writing a subclass, use the protected methods item_first(),
-  item_next(), etc. to access the internal linked list more efficiently.
+  Lines are kept in an array, so this call takes constant time.
 
   \param[in] line The line number of the item to return. (1 based)
   \retval item that was found.
@@ -181,25 +252,17 @@ const char *Fl_Browser::item_text(void *item) const {
   \see item_at(), find_line(), lineno()
 */
 FL_BLINE* Fl_Browser::find_line(int line) const {
-  int n; FL_BLINE* l;
-  if (line == cacheline) return cache;
-  if (cacheline && line > (cacheline/2) && line < ((cacheline+lines)/2)) {
-    n = cacheline; l = cache;
-  } else if (line <= (lines/2)) {
-    n = 1; l = first;
-  } else {
-    n = lines; l = last;
-  }
-  for (; n < line && l; n++) l = l->next;
-  for (; n > line && l; n--) l = l->prev;
-  ((Fl_Browser*)this)->cacheline = line;
-  ((Fl_Browser*)this)->cache = l;
-  return l;
+  if (line < 1 || line > lines) return 0;
+  return items_[line-1];
 }
 
 /**
   Returns line number corresponding to \p item, or zero if not found.
-  Caveat: See efficiency note in find_line().
+
+  This call takes constant time, except for the first call after a line
+  was inserted or removed in the middle of the browser, which renumbers
+  the lines below it.
+
   \param[in] item The item to be found
   \returns The line number of the item, or 0 if not found.
   \see item_at(), find_line(), lineno()
@@ -207,33 +270,13 @@ FL_BLINE* Fl_Browser::find_line(int line) const {
 int Fl_Browser::lineno(void *item) const {
   FL_BLINE* l = (FL_BLINE*)item;
   if (!l) return 0;
-  if (l == cache) return cacheline;
-  if (l == first) return 1;
-  if (l == last) return lines;
-  if (!cache) {
-    ((Fl_Browser*)this)->cache = first;
-    ((Fl_Browser*)this)->cacheline = 1;
-  }
-  // assume it is near cache, search both directions:
-  FL_BLINE* b = cache->prev;
-  int bnum = cacheline-1;
-  FL_BLINE* f = cache->next;
-  int fnum = cacheline+1;
-  int n = 0;
-  for (;;) {
-    if (b == l) {n = bnum; break;}
-    if (f == l) {n = fnum; break;}
-    if (b) {b = b->prev; bnum--;}
-    if (f) {f = f->next; fnum++;}
-  }
-  ((Fl_Browser*)this)->cache = l;
-  ((Fl_Browser*)this)->cacheline = n;
-  return n;
+  int i = line_index(l);
+  if (i < 0 || i >= lines || items_[i] != l) return 0;
+  return i+1;
 }
 
 /**
   Removes the item at the specified \p line.
-  Caveat: See efficiency note in find_line().
   You must call redraw() to make any changes visible.
   \param[in] line The line number to be removed. (1 based) Must be in range!
   \returns Pointer to browser item that was removed (and is no longer valid).
@@ -243,14 +286,11 @@ FL_BLINE* Fl_Browser::_remove(int line) {
   FL_BLINE* ttt = find_line(line);
   deleting(ttt);
 
-  cacheline = line-1;
-  cache = ttt->prev;
+  if (!(ttt->flags & BLINE_NOTDISPLAYED))
+    full_height_ -= item_height(ttt) + linespacing();
+  items_.erase(items_.begin() + (line-1));
   lines--;
-  full_height_ -= item_height(ttt) + linespacing();
-  if (ttt->prev) ttt->prev->next = ttt->next;
-  else first = ttt->next;
-  if (ttt->next) ttt->next->prev = ttt->prev;
-  else last = ttt->prev;
+  changed_from(line-1);
 
   return(ttt);
 }
@@ -277,32 +317,18 @@ void Fl_Browser::remove(int line) {
   \param[in] item  The item to be added.
 */
 void Fl_Browser::insert(int line, FL_BLINE* item) {
-  if (!first) {
-    item->prev = item->next = 0;
-    first = last = item;
-  } else if (line <= 1) {
-    inserting(first, item);
-    item->prev = 0;
-    item->next = first;
-    item->next->prev = item;
-    first = item;
-  } else if (line > lines) {
-    item->prev = last;
-    item->prev->next = item;
-    item->next = 0;
-    last = item;
-  } else {
-    FL_BLINE* n = find_line(line);
-    inserting(n, item);
-    item->next = n;
-    item->prev = n->prev;
-    item->prev->next = item;
-    n->prev = item;
-  }
-  cacheline = line;
-  cache = item;
+  if (line < 1) line = 1;
+  if (line > lines) line = lines+1;
+  if (line <= lines) inserting(items_[line-1], item);
+  items_.insert(items_.begin() + (line-1), item);
   lines++;
-  full_height_ += item_height(item) + linespacing();
+  item->index = line-1;
+  // appending a line keeps the other indexes and positions valid:
+  if (line < lines) changed_from(line-1);
+  else if (indexed_ == line-1) indexed_ = line;
+  item->height = item_height(item);
+  if (!(item->flags & BLINE_NOTDISPLAYED))
+    full_height_ += item->height + linespacing();
   redraw_line(item);
 }
 
@@ -328,6 +354,7 @@ void Fl_Browser::insert(int line, const char* newtext, void* d) {
   strcpy(t->txt, newtext);
   t->data = d;
   t->icon = 0;
+  t->height = -1;
   insert(line, t);
 }
 
@@ -357,23 +384,27 @@ void Fl_Browser::text(int line, const char* newtext) {
   if (line < 1 || line > lines) return;
   FL_BLINE* t = find_line(line);
   if (!newtext) newtext = "";           // STR #3269
+  int old_h = t->height >= 0 ? t->height : item_height(t);
   int l = (int) strlen(newtext);
   if (l > t->length) {
     FL_BLINE* n = (FL_BLINE*)malloc(sizeof(FL_BLINE)+l);
     replacing(t, n);
-    cache = n;
     n->data = t->data;
     n->icon = t->icon;
+    n->index = line-1;
     n->length = (short)l;
     n->flags = t->flags;
-    n->prev = t->prev;
-    if (n->prev) n->prev->next = n; else first = n;
-    n->next = t->next;
-    if (n->next) n->next->prev = n; else last = n;
+    items_[line-1] = n;
     free(t);
     t = n;
   }
   strcpy(t->txt, newtext);
+  // keep the cached positions if the height did not change:
+  t->height = item_height(t);
+  if (t->height != old_h) {
+    full_height_ += t->height - old_h;
+    changed_from(line-1);
+  }
   redraw_line(t);
 }
 
@@ -516,6 +547,7 @@ int Fl_Browser::item_width(void *item) const {
        incr_height(), full_height()
 */
 int Fl_Browser::full_height() const {
+  check_heights();
   return full_height_;
 }
 
@@ -639,10 +671,47 @@ Fl_Browser::Fl_Browser(int X, int Y, int W, int H, const char *L)
   column_widths_ = no_columns;
   lines = 0;
   full_height_ = 0;
-  cacheline = 0;
+  indexed_ = 0;
+  tops_valid_ = 1;
+  tops_font_ = textfont();
+  tops_spacing_ = linespacing();
   format_char_ = '@';
   column_char_ = '\t';
-  first = last = cache = 0;
+}
+
+/**
+  Returns the line at the vertical position \p pos and its position.
+  This uses the cached heights of all lines and takes logarithmic time.
+  \param[in] pos The vertical position in pixels, 0 is the top of the list.
+  \param[out] item_pos The position of the top of the returned line.
+  \returns The line that contains \p pos, or the last line if \p pos is
+           below the list, or NULL if the browser is empty.
+  \see item_position()
+*/
+void *Fl_Browser::item_at_position(int pos, int *item_pos) const {
+  if (!lines) return 0;
+  update_tops(lines);
+  // find the last line whose top is at or above pos:
+  int lo = 0, hi = lines - 1;
+  while (lo < hi) {
+    int mid = (lo + hi + 1) / 2;
+    if (tops_[mid] <= pos) lo = mid;
+    else hi = mid - 1;
+  }
+  *item_pos = tops_[lo];
+  return items_[lo];
+}
+
+/**
+  Returns the vertical position of the top of \p item in pixels.
+  \param[in] item The item whose position is returned.
+  \returns The position, 0 is the top of the list.
+  \see item_at_position()
+*/
+int Fl_Browser::item_position(void *item) const {
+  int i = line_index((FL_BLINE*)item);
+  update_tops(i + 1);
+  return tops_[i];
 }
 
 /**
@@ -656,11 +725,11 @@ void Fl_Browser::lineposition(int line, Fl_Line_Position pos) {
   if (line>lines) line = lines;
   int p = 0;
 
-  FL_BLINE* l;
-  for (l=first; l && line>1; l = l->next) {
-    line--; p += item_height(l) + linespacing();
+  if (lines) {
+    if (pos == BOTTOM) line++;
+    update_tops(line);
+    p = tops_[line-1];
   }
-  if (l && (pos == BOTTOM)) p += item_height(l) + linespacing();
 
   int final = p, X, Y, W, H;
   bbox(X, Y, W, H);
@@ -705,11 +774,7 @@ void Fl_Browser::textsize(Fl_Fontsize newSize) {
     return; // avoid recalculation
   Fl_Browser_::textsize(newSize);
   new_list();
-  full_height_ = 0;
-  if (lines == 0) return;
-  for (FL_BLINE* itm=(FL_BLINE *)item_first(); itm; itm=(FL_BLINE *)item_next(itm)) {
-    full_height_ += item_height(itm) + linespacing();
-  }
+  recalc_heights();
 }
 
 /**
@@ -717,15 +782,13 @@ void Fl_Browser::textsize(Fl_Fontsize newSize) {
   \see add(), insert(), remove(), swap(int,int), clear()
 */
 void Fl_Browser::clear() {
-  for (FL_BLINE* l = first; l;) {
-    FL_BLINE* n = l->next;
-    free(l);
-    l = n;
-  }
+  for (int i = 0; i < lines; i++)
+    free(items_[i]);
+  items_.clear();
+  tops_.clear();
   full_height_ = 0;
-  first = 0;
-  last = 0;
   lines = 0;
+  changed_from(0);
   new_list();
 }
 
@@ -807,7 +870,9 @@ void Fl_Browser::show(int line) {
   FL_BLINE* t = find_line(line);
   if (t->flags & BLINE_NOTDISPLAYED) {
     t->flags &= ~BLINE_NOTDISPLAYED;
-    full_height_ += item_height(t) + linespacing();
+    t->height = item_height(t);
+    full_height_ += t->height + linespacing();
+    changed_from(line-1);
     if (Fl_Browser_::displayed(t)) redraw();
   }
 }
@@ -826,6 +891,8 @@ void Fl_Browser::hide(int line) {
   if (!(t->flags & BLINE_NOTDISPLAYED)) {
     full_height_ -= item_height(t) + linespacing();
     t->flags |= BLINE_NOTDISPLAYED;
+    t->height = 0;
+    changed_from(line-1);
     if (Fl_Browser_::displayed(t)) redraw();
   }
 }
@@ -871,39 +938,13 @@ void Fl_Browser::swap(FL_BLINE *a, FL_BLINE *b) {
 
   if ( a == b || !a || !b) return;          // nothing to do
   swapping(a, b);
-  FL_BLINE *aprev  = a->prev;
-  FL_BLINE *anext  = a->next;
-  FL_BLINE *bprev  = b->prev;
-  FL_BLINE *bnext  = b->next;
-  if ( b->prev == a ) {                 // A ADJACENT TO B
-     if ( aprev ) aprev->next = b; else first = b;
-     b->next = a;
-     a->next = bnext;
-     b->prev = aprev;
-     a->prev = b;
-     if ( bnext ) bnext->prev = a; else last = a;
-  } else if ( a->prev == b ) {          // B ADJACENT TO A
-     if ( bprev ) bprev->next = a; else first = a;
-     a->next = b;
-     b->next = anext;
-     a->prev = bprev;
-     b->prev = a;
-     if ( anext ) anext->prev = b; else last = b;
-  } else {                              // A AND B NOT ADJACENT
-     // handle prev's
-     b->prev = aprev;
-     if ( anext ) anext->prev = b; else last = b;
-     a->prev = bprev;
-     if ( bnext ) bnext->prev = a; else last = a;
-     // handle next's
-     if ( aprev ) aprev->next = b; else first = b;
-     b->next = anext;
-     if ( bprev ) bprev->next = a; else first = a;
-     a->next = bnext;
-  }
-  // Disable cache -- we played around with positions
-  cacheline = 0;
-  cache = 0;
+  int ai = line_index(a);
+  int bi = line_index(b);
+  items_[ai] = b; b->index = ai;
+  items_[bi] = a; a->index = bi;
+  // the lines between a and b move if their heights differ
+  if (a->height < 0 || a->height != b->height)
+    changed_from(ai < bi ? ai : bi);
 }
 
 /**
@@ -943,6 +984,8 @@ void Fl_Browser::icon(int line, Fl_Image* icon) {
   full_height_ += dh;                           // do this *always*
 
   bl->icon = icon;                              // set new icon
+  bl->height = -1;
+  changed_from(line-1);
   if (dh>0) {
     redraw();                                   // icon larger than item? must redraw widget
   } else {
@@ -20,6 +20,7 @@
 #include <FL/Fl.H>
 #include <FL/Fl_Widget.H>
 #include <FL/Fl_Browser_.H>
+#include <FL/Fl_Window.H>
 #include <FL/fl_draw.H>
 #include <FL/fl_utf8.h>
 
@@ -57,6 +58,11 @@ static void hscrollbar_callback(Fl_Widget* s, void*) {
   ((Fl_Browser_*)(s->parent()))->hposition(int(((Fl_Scrollbar*)s)->value()));
 }
 
+// height of an item including the line spacing, hidden items take no space:
+static inline int spaced(int h, int linespacing) {
+  return h > 0 ? h + linespacing : 0;
+}
+
 // return where to draw the actual box:
 /**
   Returns the bounding box for the interior of the list's display window, inside
@@ -125,18 +131,32 @@ void Fl_Browser_::resize(int X, int Y, int W, int H) {
 void Fl_Browser_::redraw_line(void* item) {
   if (!redraw1 || redraw1 == item) {redraw1 = item; damage(FL_DAMAGE_EXPOSE);}
   else if (!redraw2 || redraw2 == item) {redraw2 = item; damage(FL_DAMAGE_EXPOSE);}
-  else damage(FL_DAMAGE_SCROLL);
+  else redraw_lines();
+}
+
+/*
+ Request a redraw after the list was scrolled. If nothing else changed since
+ the list was drawn, draw() moves the lines that stay visible.
+ */
+void Fl_Browser_::damage_scroll() {
+  if (!(damage() & (FL_DAMAGE_ALL|FL_DAMAGE_SCROLL))) scroll_pending_ = 1;
+  damage(FL_DAMAGE_SCROLL);
 }
 
 // Figure out top() based on position():
 void Fl_Browser_::update_top() {
+  // without a known top item, the drawn lines can not be reused
+  bool reuse = top_ != 0;
   if (!top_) top_ = item_first();
   if (position_ != real_position_) {
     void* l;
     int ly;
     int yy = position_;
-    // start from either head or current position, whichever is closer:
-    if (!top_ || yy <= (real_position_/2)) {
+    // ask the subclass, or start from either head or current position,
+    // whichever is closer:
+    if ((l = item_at_position(yy, &ly)) != 0) {
+      // found it without walking the list
+    } else if (!top_ || yy <= (real_position_/2)) {
       l = item_first();
       ly = 0;
     } else {
@@ -148,13 +168,13 @@ void Fl_Browser_::update_top() {
       offset_ = 0;
       real_position_ = 0;
     } else {
-      int hh = item_quick_height(l) + linespacing();
+      int hh = spaced(item_quick_height(l), linespacing());
       // step through list until we find line containing this point:
       while (ly > yy) {
         void* l1 = item_prev(l);
         if (!l1) {ly = 0; break;} // hit the top
         l  = l1;
-        hh = item_quick_height(l) + linespacing();
+        hh = spaced(item_quick_height(l), linespacing());
         ly -= hh;
       }
       while ((ly+hh) <= yy) {
@@ -162,23 +182,24 @@ void Fl_Browser_::update_top() {
         if (!l1) {yy = ly+hh-1; break;}
         l = l1;
         ly += hh;
-        hh = item_quick_height(l) + linespacing();
+        hh = spaced(item_quick_height(l), linespacing());
       }
       // top item must *really* be visible, use slow height:
       for (;;) {
-        hh = item_height(l) + linespacing();
+        hh = spaced(item_height(l), linespacing());
         if ((ly+hh) > yy) break; // it is big enough to see
         // go up to top of previous item:
         void* l1 = item_prev(l);
         if (!l1) {ly = yy = 0; break;} // hit the top
-        l = l1; yy = position_ = ly = ly-item_quick_height(l) + linespacing();
+        l = l1; yy = position_ = ly = ly-spaced(item_quick_height(l), linespacing());
       }
       // use it:
       top_ = l;
       offset_ = yy-ly;
       real_position_ = yy;
     }
-    damage(FL_DAMAGE_SCROLL);
+    if (reuse) damage_scroll();
+    else redraw_lines();
   }
 }
 
@@ -196,7 +217,7 @@ void Fl_Browser_::vposition(int pos) {
   if (pos < 0) pos = 0;
   if (pos == position_) return;
   position_ = pos;
-  if (pos != real_position_) redraw_lines();
+  if (pos != real_position_) damage_scroll();
 }
 
 /**
@@ -211,7 +232,7 @@ void Fl_Browser_::hposition(int pos) {
   if (pos < 0) pos = 0;
   if (pos == hposition_) return;
   hposition_ = pos;
-  if (pos != real_hposition_) redraw_lines();
+  if (pos != real_hposition_) damage_scroll();
 }
 
 // Tell whether item is currently displayed:
@@ -229,7 +250,7 @@ int Fl_Browser_::displayed(void* item) const {
   int yy = H+offset_;
   for (void* l = top_; l && yy > 0; l = item_next(l)) {
     if (l == item) return 1;
-    yy -= item_height(l) + linespacing();
+    yy -= spaced(item_height(l), linespacing());
   }
   return 0;
 }
@@ -257,7 +278,26 @@ void Fl_Browser_::display(void* item) {
 
   // 3rd special case - want to display item just above top of browser?
   void* lp = item_prev(l);
-  if (lp == item) { vposition(real_position_+Y-item_quick_height(lp)-linespacing()); return; }
+  if (lp == item) { vposition(real_position_+Y-spaced(item_quick_height(lp), linespacing())); return; }
+
+  // if the subclass knows the position of the item, there's no need to search:
+  int p = item_position(item);
+  if (p >= 0) {
+    h1 = spaced(item_quick_height(item), linespacing());
+    Y = p - real_position_;
+    if (Y >= -offset_) {
+      if (Y <= H) { // it is visible or right at bottom
+        Y = Y+h1-H; // find where bottom edge is
+        if (Y > 0) vposition(real_position_+Y); // scroll down a bit
+      } else {
+        vposition(real_position_+Y-(H-h1)/2); // center it
+      }
+    } else {
+      if ((Y + h1) >= 0) vposition(real_position_+Y);
+      else vposition(real_position_+Y-(H-h1)/2);
+    }
+    return;
+  }
 
 #ifdef DISPLAY_SEARCH_BOTH_WAYS_AT_ONCE
   // search for item.  We search both up and down the list at the same time,
@@ -265,7 +305,7 @@ void Fl_Browser_::display(void* item) {
   // much slower for going up than for going down.
   while (l || lp) {
     if (l) {
-      h1 = item_quick_height(l) + linespacing();
+      h1 = spaced(item_quick_height(l), linespacing());
       if (l == item) {
         if (Y <= H) { // it is visible or right at bottom
           Y = Y+h1-H; // find where bottom edge is
@@ -279,7 +319,7 @@ void Fl_Browser_::display(void* item) {
       l = item_next(l);
     }
     if (lp) {
-      h1 = item_quick_height(lp) + linespacing();
+      h1 = spaced(item_quick_height(lp), linespacing());
       Yp -= h1;
       if (lp == item) {
         if ((Yp + h1) >= 0) vposition(real_position_+Yp);
@@ -294,7 +334,7 @@ void Fl_Browser_::display(void* item) {
   // search forward for it:
   l = top_;
   for (; l; l = item_next(l)) {
-    h1 = item_quick_height(l) + linespacing();
+    h1 = spaced(item_quick_height(l), linespacing());
     if (l == item) {
       if (Y <= H) { // it is visible or right at bottom
         Y = Y+h1-H; // find where bottom edge is
@@ -310,7 +350,7 @@ void Fl_Browser_::display(void* item) {
   l = lp;
   Y = -offset_;
   for (; l; l = item_prev(l)) {
-    h1 = item_quick_height(l) + linespacing();
+    h1 = spaced(item_quick_height(l), linespacing());
     Y -= h1;
     if (l == item) {
       if ((Y + h1) >= 0) position(real_position_+Y);
@@ -351,6 +391,7 @@ J1:
     if (scrollbar.visible()) {
       scrollbar.clear_visible();
       clear_damage((uchar)(damage()|FL_DAMAGE_SCROLL));
+      scroll_pending_ = 0;
     }
   }
 
@@ -366,6 +407,7 @@ J1:
     if (hscrollbar.visible()) {
       hscrollbar.clear_visible();
       clear_damage((uchar)(damage()|FL_DAMAGE_SCROLL));
+      scroll_pending_ = 0;
     }
   }
 
@@ -384,44 +426,29 @@ J1:
     if (scrollbar.visible()) {
       scrollbar.clear_visible();
       clear_damage((uchar)(damage()|FL_DAMAGE_SCROLL));
+      scroll_pending_ = 0;
     }
   }
 
   bbox(X, Y, W, H);
 
-  fl_push_clip(X, Y, W, H);
-  // for each line, draw it if full redraw or scrolled.  Erase background
-  // if not a full redraw or if it is selected:
-  void* l = top();
-  int yy = -offset_;
-  for (; l && yy < H; l = item_next(l)) {
-    int hh = item_height(l) + linespacing();
-    if (hh <= 0) continue;
-    if ((damage()&(FL_DAMAGE_SCROLL|FL_DAMAGE_ALL)) || l == redraw1 || l == redraw2) {
-      if (item_selected(l)) {
-        fl_color(active_r() ? selection_color() : fl_inactive(selection_color()));
-        fl_rectf(X, yy+Y, W, hh);
-      } else if (!(damage()&FL_DAMAGE_ALL)) {
-        fl_push_clip(X, yy+Y, W, hh);
-        draw_box(box() ? box() : FL_DOWN_BOX, x(), y(), w(), h(), color());
-        fl_pop_clip();
-      }
-      item_draw(l, X-hposition_, yy+Y, W+hposition_, hh);
-      if (l == selection_ && Fl::focus() == this) {
-        draw_box(FL_BORDER_FRAME, X, yy+Y, W, hh, color());
-        draw_focus(FL_NO_BOX, X, yy+Y, W+1, hh+1);
-      }
-      int ww = item_width(l);
-      if (ww > max_width) {max_width = ww; max_width_item = l;}
+  // If the list was only scrolled, move the lines that stay visible and
+  // draw the exposed area, unless the scaling factor is fractional and
+  // moving pixels would not be exact. Otherwise FL_DAMAGE_SCROLL draws
+  // all lines.
+  uchar d = damage();
+  if (scroll_pending_ && !(d & FL_DAMAGE_ALL)) {
+    float scale = Fl_Surface_Device::surface()->driver()->scale();
+    if (Fl_Surface_Device::surface() == Fl_Display_Device::display_device() &&
+        Fl_Window::current() && scale == int(scale)) {
+      fl_scroll(X, Y, W, H, real_hposition_ - hposition_,
+                drawn_position_ - real_position_, draw_area_cb, this);
+      d &= ~FL_DAMAGE_SCROLL;
     }
-    yy += hh;
-  }
-  // erase the area below last line:
-  if (!(damage()&FL_DAMAGE_ALL) && yy < H) {
-    fl_push_clip(X, yy+Y, W, H-yy);
-    draw_box(box() ? box() : FL_DOWN_BOX, x(), y(), w(), h(), color());
-    fl_pop_clip();
   }
+
+  fl_push_clip(X, Y, W, H);
+  draw_items(X, Y, W, H, d);
   fl_pop_clip();
 
   fl_push_clip(x(),y(),w(),h());                // STR# 2886
@@ -448,7 +475,7 @@ J1:
 
   // update the scrollbars and redraw them:
   int scrollsize = scrollbar_size_ ? scrollbar_size_ : Fl::scrollbar_size();
-  int dy = top_ ? item_quick_height(top_) + linespacing() : 0; if (dy < 10) dy = 10;
+  int dy = top_ ? spaced(item_quick_height(top_), linespacing()) : 0; if (dy < 10) dy = 10;
   if (scrollbar.visible()) {
     scrollbar.damage_resize(
         scrollbar.align()&FL_ALIGN_LEFT ? X-scrollsize : X+W,
@@ -475,6 +502,62 @@ J1:
   }
 
   real_hposition_ = hposition_;
+  drawn_position_ = real_position_;
+  scroll_pending_ = 0;
+  fl_pop_clip();
+}
+
+/*
+ Draw the lines of the list. With FL_DAMAGE_ALL or FL_DAMAGE_SCROLL in \p d
+ all lines are drawn, otherwise only the lines that need a redraw. Lines
+ outside the clip region are skipped.
+ */
+void Fl_Browser_::draw_items(int X, int Y, int W, int H, uchar d) {
+  // for each line, draw it if full redraw or scrolled.  Erase background
+  // if not a full redraw or if it is selected:
+  void* l = top();
+  int yy = -offset_;
+  for (; l && yy < H; l = item_next(l)) {
+    int hh = spaced(item_height(l), linespacing());
+    if (hh <= 0) continue;
+    if ((d&(FL_DAMAGE_SCROLL|FL_DAMAGE_ALL)) || l == redraw1 || l == redraw2) {
+      if (fl_not_clipped(X, yy+Y, W, hh)) {
+        if (item_selected(l)) {
+          fl_color(active_r() ? selection_color() : fl_inactive(selection_color()));
+          fl_rectf(X, yy+Y, W, hh);
+        } else if (!(d&FL_DAMAGE_ALL)) {
+          fl_push_clip(X, yy+Y, W, hh);
+          draw_box(box() ? box() : FL_DOWN_BOX, x(), y(), w(), h(), color());
+          fl_pop_clip();
+        }
+        item_draw(l, X-hposition_, yy+Y, W+hposition_, hh);
+        if (l == selection_ && Fl::focus() == this) {
+          draw_box(FL_BORDER_FRAME, X, yy+Y, W, hh, color());
+          draw_focus(FL_NO_BOX, X, yy+Y, W+1, hh+1);
+        }
+      }
+      int ww = item_width(l);
+      if (ww > max_width) {max_width = ww; max_width_item = l;}
+    }
+    yy += hh;
+  }
+  // erase the area below last line:
+  if (!(d&FL_DAMAGE_ALL) && yy < H) {
+    fl_push_clip(X, yy+Y, W, H-yy);
+    draw_box(box() ? box() : FL_DOWN_BOX, x(), y(), w(), h(), color());
+    fl_pop_clip();
+  }
+}
+
+/*
+ Draw the lines in an area that was exposed by fl_scroll().
+ */
+void Fl_Browser_::draw_area_cb(void *data, int X, int Y, int W, int H) {
+  Fl_Browser_ *b = (Fl_Browser_ *)data;
+  int bx, by, bw, bh;
+  b->bbox(bx, by, bw, bh);
+  fl_push_clip(X, Y, W, H);
+  b->draw_items(bx, by, bw, bh, FL_DAMAGE_SCROLL);
   fl_pop_clip();
 }
 
@@ -488,7 +571,8 @@ J1:
 */
 void Fl_Browser_::new_list() {
   top_ = 0;
-  position_ = real_position_ = 0;
+  position_ = real_position_ = drawn_position_ = 0;
+  scroll_pending_ = 0;
   hposition_ = real_hposition_ = 0;
   selection_ = 0;
   offset_ = 0;
@@ -990,7 +1074,8 @@ Fl_Browser_::Fl_Browser_(int X, int Y, int W, int H, const char* L)
 {
   box(FL_NO_BOX);
   align(FL_ALIGN_BOTTOM);
-  position_ = real_position_ = 0;
+  position_ = real_position_ = drawn_position_ = 0;
+  scroll_pending_ = 0;
   hposition_ = real_hposition_ = 0;
   offset_ = 0;
   top_ = 0;
@@ -1088,6 +1173,36 @@ int Fl_Browser_::incr_height() const {
   return item_quick_height(item_first()) + linespacing();
 }
 
+/**
+  This method may be provided by the subclass to find the item at a vertical
+  position of the list without stepping through all items above it.
+  The position of an item is the sum of item_quick_height() + linespacing()
+  of all items before it, hidden items with a height of 0 have no spacing.
+  The default implementation returns NULL, which means "not supported".
+  \param[in] pos The vertical position in pixels, 0 is the top of the list.
+  \param[out] item_pos The position of the top of the returned item.
+  \returns The item that contains \p pos, the last item if \p pos is below
+           the list, or NULL.
+  \see item_position()
+*/
+void *Fl_Browser_::item_at_position(int pos, int *item_pos) const {
+  (void)pos; (void)item_pos;
+  return 0L;
+}
+
+/**
+  This method may be provided by the subclass to return the vertical position
+  of \p item without stepping through all items above it.
+  The default implementation returns -1, which means "not supported".
+  \param[in] item The item whose position is returned.
+  \returns The position of the top of \p item in pixels, or -1.
+  \see item_at_position()
+*/
+int Fl_Browser_::item_position(void *item) const {
+  (void)item;
+  return -1;
+}
+
 /**
   This method may be provided by the subclass to indicate the full height
   of the item list, in pixels.
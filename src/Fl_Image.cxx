@@ -21,6 +21,7 @@
 #include <FL/Fl_Menu_Item.H>
 #include <FL/Fl_Image.H>
 #include "flstring.h"
+#include "fl_image_scale.h"
 
 #include <stdlib.h>
 #include <cstdint>
@@ -33,6 +34,8 @@ Fl_RGB_Scaling Fl_Image::RGB_scaling_ = FL_RGB_SCALING_NEAREST;
 
 Fl_RGB_Scaling Fl_Image::scaling_algorithm_ = FL_RGB_SCALING_BILINEAR;
 
+static int RGB_scaling_threads_ = 1;
+
 /**
  The constructor creates an empty image with the specified
  width, height, and depth. The width and height are in pixels.
@@ -251,6 +254,11 @@ Fl_Image::measure(const Fl_Label *lo,           // I - Label
 
 /** Sets the RGB image scaling method used for copy(int, int).
     Applies to all RGB images, defaults to FL_RGB_SCALING_NEAREST.
+
+    FL_RGB_SCALING_AREA averages all source pixels that are covered by a
+    pixel of the copy. This gives the best results when scaling down by
+    large factors, e.g. for thumbnails. Copies that are larger than the
+    source image in either direction are made with FL_RGB_SCALING_BILINEAR.
 */
 void Fl_Image::RGB_scaling(Fl_RGB_Scaling method) {
   RGB_scaling_ = method;
@@ -261,6 +269,32 @@ Fl_RGB_Scaling Fl_Image::RGB_scaling() {
   return RGB_scaling_;
 }
 
+/** Sets the maximum number of threads used by copy(int, int) to scale
+    RGB images with FL_RGB_SCALING_BILINEAR or FL_RGB_SCALING_AREA.
+
+    The rows of the copy are split into bands that are computed at the same
+    time. Only large images are split, smaller images are always scaled in
+    the calling thread. The default is 1, i.e. no additional threads are
+    started. Values less than 1 are treated as 1. The setting has no effect
+    on platforms without thread support.
+
+    \note copy(int, int) blocks until all bands are done. Different images
+      can be scaled in several application threads at the same time.
+
+    \version 1.5
+*/
+void Fl_Image::RGB_scaling_threads(int n) {
+  RGB_scaling_threads_ = n < 1 ? 1 : n;
+}
+
+/** Returns the maximum number of threads used to scale RGB images.
+    \see RGB_scaling_threads(int)
+    \version 1.5
+*/
+int Fl_Image::RGB_scaling_threads() {
+  return RGB_scaling_threads_;
+}
+
 /** Sets the drawing size of the image.
  This function controls the values returned by member functions w() and h()
  which in turn control how the image is drawn: the full image data (whose size
@@ -550,6 +584,47 @@ Fl_RGB_Image *Fl_RGB_Image::copy_nearest_neighbor_(int W, int H) const {
   return new_image;
 }
 
+// Source and destination of a scaling function that runs in row bands
+struct Fl_Scale_Job {
+  const uchar *src;
+  int sw, sh, sld, d;
+  uchar *dst;
+  int w, h;
+};
+
+static void scale_area_cb(void *data, int y0, int y1) {
+  Fl_Scale_Job *j = (Fl_Scale_Job *)data;
+  fl_scale_area(j->src, j->sw, j->sh, j->sld, j->d, j->dst, j->w, j->h, y0, y1);
+}
+
+static void scale_bilinear_cb(void *data, int y0, int y1) {
+  Fl_Scale_Job *j = (Fl_Scale_Job *)data;
+  fl_scale_bilinear(j->src, j->sw, j->sh, j->sld, j->d, j->dst, j->w, j->h, y0, y1);
+}
+
+static void scale_halve_h_cb(void *data, int y0, int y1) {
+  Fl_Scale_Job *j = (Fl_Scale_Job *)data;
+  fl_scale_halve_h(j->src, j->sw, j->sld, j->d, j->dst, y0, y1);
+}
+
+static void scale_halve_v_cb(void *data, int y0, int y1) {
+  Fl_Scale_Job *j = (Fl_Scale_Job *)data;
+  fl_scale_halve_v(j->src, j->sw, j->sld, j->d, j->dst, y0, y1);
+}
+
+// Creates the new image and computes its rows with fn, see RGB_scaling_threads()
+static Fl_RGB_Image *scale_rgb(const Fl_RGB_Image *img, int W, int H,
+                               void (*fn)(void *, int, int)) {
+  const int D = img->d();
+  uchar *new_array = new uchar[((long)W) * H * D];
+  Fl_RGB_Image *new_image = new Fl_RGB_Image(new_array, W, H, D);
+  new_image->alloc_array = 1;
+  Fl_Scale_Job job = { img->array, img->data_w(), img->data_h(),
+                       img->ld() ? img->ld() : img->data_w() * D, D, new_array, W, H };
+  fl_scale_bands(H, (long)job.sh * job.sld, Fl_Image::RGB_scaling_threads(), fn, &job);
+  return new_image;
+}
+
 /**
   Create a scaled up or down copy of this image using bilinear interpolation.
 
@@ -561,209 +636,37 @@ Fl_RGB_Image *Fl_RGB_Image::copy_nearest_neighbor_(int W, int H) const {
 
   RGB or gray must not be premultiplied if alpha is used.
 
-  Yes, this function is relatively slow. It may be worth looking to host OS
-  support for scaling images.
-
   \param[in] W, H  Requested width and height of the new image
   \returns  A new image object with the requested size. The caller is responsible
            for deleting the returned image object when it is no longer needed.
 */
 Fl_RGB_Image *Fl_RGB_Image::copy_bilinear_(uint32_t W, uint32_t H) const {
-  const uint32_t D = d();
-  const uint32_t SW = data_w();
-  const uint32_t SH = data_h();
-  const uint32_t SLD = ld() ? ld() : SW * D;
-
-  uint8_t *new_array = new uint8_t[((long)W) * H * D];
-  Fl_RGB_Image *new_image = new Fl_RGB_Image(new_array, W, H, D);
-  new_image->alloc_array = 1;
-
-  // Precompute X and Y coordinate maps and weights (8-bit fixed point: 0..256).
-  uint32_t *x0_off = new uint32_t[W];
-  uint32_t *x1_off = new uint32_t[W];
-  uint32_t *wx1 = new uint32_t[W];
-
-  uint32_t *y0_off = new uint32_t[H];
-  uint32_t *y1_off = new uint32_t[H];
-  uint32_t *wy1 = new uint32_t[H];
-
-  // Pixel-center mapping works for both upscaling and downscaling.
-  for (uint32_t x = 0; x < W; ++x) {
-    float sx = ((x + 0.5f) * SW) / (float)W - 0.5f;
-    int32_t x0 = (int32_t)sx;
-    if (sx < 0.0f && (float)x0 != sx) x0--; // floor for negatives
-
-    float fx = sx - x0;
-
-    if (x0 < 0) {
-      x0 = 0;
-      fx = 0.0f;
-    } else if (x0 >= (int32_t)SW - 1) {
-      x0 = SW - 1;
-      fx = 0.0f;
-    }
-
-    uint32_t x1 = (x0 < (int32_t)SW - 1) ? (x0 + 1) : x0;
-    int32_t w = (int32_t)(fx * 256.0f + 0.5f);
-    if (w < 0) w = 0;
-    else if (w > 256) w = 256;
-
-    x0_off[x] = x0 * D;
-    x1_off[x] = x1 * D;
-    wx1[x] = w;
-  }
-
-  for (uint32_t y = 0; y < H; ++y) {
-    float sy = ((y + 0.5f) * SH) / (float)H - 0.5f;
-    int32_t y0 = (int32_t)sy;
-    if (sy < 0.0f && (float)y0 != sy) y0--; // floor for negatives
-
-    float fy = sy - y0;
-
-    if (y0 < 0) {
-      y0 = 0;
-      fy = 0.0f;
-    } else if (y0 >= (int32_t)SH - 1) {
-      y0 = SH - 1;
-      fy = 0.0f;
-    }
-
-    uint32_t y1 = (y0 < (int32_t)SH - 1) ? (y0 + 1) : y0;
-    int32_t w = (int32_t)(fy * 256.0f + 0.5f);
-    if (w < 0) w = 0;
-    else if (w > 256) w = 256;
-
-    y0_off[y] = y0 * SLD;
-    y1_off[y] = y1 * SLD;
-    wy1[y] = w;
-  }
-
-  for (uint32_t y = 0; y < H; ++y) {
-    const uint8_t *row0 = array + y0_off[y];
-    const uint8_t *row1 = array + y1_off[y];
-    uint8_t *dst = new_array + y * W * D;
-
-    const uint32_t wy = wy1[y];
-    const uint32_t wy0 = 256 - wy;
-
-    for (uint32_t x = 0; x < W; ++x) {
-      const uint8_t *p00 = row0 + x0_off[x];
-      const uint8_t *p10 = row0 + x1_off[x];
-      const uint8_t *p01 = row1 + x0_off[x];
-      const uint8_t *p11 = row1 + x1_off[x];
-
-      const uint32_t wx = wx1[x];
-      const uint32_t wx0 = 256 - wx;
+  return scale_rgb(this, W, H, scale_bilinear_cb);
+}
 
-      for (uint32_t c = 0; c < D; ++c) {
-        const uint32_t top = p00[c] * wx0 + p10[c] * wx;
-        const uint32_t bot = p01[c] * wx0 + p11[c] * wx;
-        dst[c] = (uint8_t)((top * wy0 + bot * wy + 32768) >> 16);
-      }
-      dst += D;
-    }
-  }
+/**
+  Create a scaled down copy of this image using area averaging.
 
-  delete[] x0_off;
-  delete[] x1_off;
-  delete[] wx1;
-  delete[] y0_off;
-  delete[] y1_off;
-  delete[] wy1;
+  Every pixel of the copy is the weighted mean of all source pixels that it
+  covers, in a single pass for any scale factor.
 
-  return new_image;
+  RGB or gray must not be premultiplied if alpha is used.
+*/
+Fl_RGB_Image *Fl_RGB_Image::copy_area_(int W, int H) const {
+  return scale_rgb(this, W, H, scale_area_cb);
 }
 
 /**
   Create a scaled down copy of this image by a factor of 2 in the horizontal direction.
  */
 Fl_RGB_Image *Fl_RGB_Image::copy_scale_down_2h_() const {
-  int W = data_w()/2;
-  int H = data_h();
-  int D = d();
-  int LD = ld() ? ld() : data_w()*D;
-  if ((W==0) || (H==0) || (D==0)) return nullptr;
-  uchar *data = (uchar*)malloc(W*H*D);
-  uchar *dst = data;
-  for (int y = 0; y < H; y++) {
-    const uchar *src = array + y*LD;
-    switch (D) {
-      case 1:
-        for (int x=0; x<W; ++x) {
-          *dst++ = ((uchar) ( ( ((unsigned)src[0]) + ((unsigned)src[1]) ) >> 1 ));
-          src += 2;
-        }
-        break;
-      case 2:
-        for (int x=0; x<W; ++x) {
-          *dst++ = ((uchar) ( ( ((unsigned)src[0]) + ((unsigned)src[2]) ) >> 1 ));
-          *dst++ = ((uchar) ( ( ((unsigned)src[1]) + ((unsigned)src[3]) ) >> 1 ));
-          src += 4;
-        }
-        break;
-      case 3:
-        for (int x=0; x<W; ++x) {
-          *dst++ = ((uchar) ( ( ((unsigned)src[0]) + ((unsigned)src[3]) ) >> 1 ));
-          *dst++ = ((uchar) ( ( ((unsigned)src[1]) + ((unsigned)src[4]) ) >> 1 ));
-          *dst++ = ((uchar) ( ( ((unsigned)src[2]) + ((unsigned)src[5]) ) >> 1 ));
-          src += 6;
-        }
-        break;
-      case 4:
-        for (int x=0; x<W; ++x) {
-          *dst++ = ((uchar) ( ( ((unsigned)src[0]) + ((unsigned)src[4]) ) >> 1 ));
-          *dst++ = ((uchar) ( ( ((unsigned)src[1]) + ((unsigned)src[5]) ) >> 1 ));
-          *dst++ = ((uchar) ( ( ((unsigned)src[2]) + ((unsigned)src[6]) ) >> 1 ));
-          *dst++ = ((uchar) ( ( ((unsigned)src[3]) + ((unsigned)src[7]) ) >> 1 ));
-          src += 8;
-        }
-        break;
-    }
-  }
-  return new Fl_RGB_Image(data, W, H, D);
+  if ((data_w() / 2 == 0) || (data_h() == 0) || (d() == 0)) return nullptr;
+  return scale_rgb(this, data_w() / 2, data_h(), scale_halve_h_cb);
 }
 
 Fl_RGB_Image *Fl_RGB_Image::copy_scale_down_2v_() const {
-  int W = data_w();
-  int H = data_h()/2;
-  int D = d();
-  int LD = ld() ? ld() : data_w()*D;
-  if ((W==0) || (H==0) || (D==0)) return nullptr;
-  uchar *data = (uchar*)malloc(W*H*D);
-  uchar *dst = data;
-  for (int y = 0; y < H; y++) {
-    const uchar *s0 = array + 2*y*LD;
-    const uchar *s1 = s0 + LD;
-    switch (D) {
-      case 1:
-        for (int x=0; x<W; ++x) {
-          *dst++ = ((uchar) ( ( ((unsigned)*s0++) + ((unsigned)*s1++) ) >> 1 ));
-        }
-        break;
-      case 2:
-        for (int x=0; x<W; ++x) {
-          *dst++ = ((uchar) ( ( ((unsigned)*s0++) + ((unsigned)*s1++) ) >> 1 ));
-          *dst++ = ((uchar) ( ( ((unsigned)*s0++) + ((unsigned)*s1++) ) >> 1 ));
-        }
-        break;
-      case 3:
-        for (int x=0; x<W; ++x) {
-          *dst++ = ((uchar) ( ( ((unsigned)*s0++) + ((unsigned)*s1++) ) >> 1 ));
-          *dst++ = ((uchar) ( ( ((unsigned)*s0++) + ((unsigned)*s1++) ) >> 1 ));
-          *dst++ = ((uchar) ( ( ((unsigned)*s0++) + ((unsigned)*s1++) ) >> 1 ));
-        }
-        break;
-      case 4:
-        for (int x=0; x<W; ++x) {
-          *dst++ = ((uchar) ( ( ((unsigned)*s0++) + ((unsigned)*s1++) ) >> 1 ));
-          *dst++ = ((uchar) ( ( ((unsigned)*s0++) + ((unsigned)*s1++) ) >> 1 ));
-          *dst++ = ((uchar) ( ( ((unsigned)*s0++) + ((unsigned)*s1++) ) >> 1 ));
-          *dst++ = ((uchar) ( ( ((unsigned)*s0++) + ((unsigned)*s1++) ) >> 1 ));
-        }
-        break;
-    }
-  }
-  return new Fl_RGB_Image(data, W, H, D);
+  if ((data_w() == 0) || (data_h() / 2 == 0) || (d() == 0)) return nullptr;
+  return scale_rgb(this, data_w(), data_h() / 2, scale_halve_v_cb);
 }
 
 
@@ -777,6 +680,8 @@ Fl_Image *Fl_RGB_Image::copy(int W, int H) const {
   if (W <= 0 || H <= 0) return nullptr;
   if (Fl_Image::RGB_scaling() == FL_RGB_SCALING_NEAREST) {
     return copy_nearest_neighbor_(W, H);
+  } else if (Fl_Image::RGB_scaling() == FL_RGB_SCALING_AREA && W <= data_w() && H <= data_h()) {
+    return copy_area_(W, H);
   } else {
     // Bilinear scaling only scales down between 100% and 50%. If our image is
     // much larger, divide it by two in either direction first. This is not
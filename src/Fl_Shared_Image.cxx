@@ -1,7 +1,7 @@
 //
 // Shared image code for the Fast Light Tool Kit (FLTK).
 //
-// Copyright 1998-2025 by Bill Spitzak and others.
+// Copyright 1998-2026 by Bill Spitzak and others.
 //
 // This library is free software. Distribution and use rights are outlined in
 // the file "COPYING" which should have been included with this file.  If this
@@ -26,6 +26,11 @@
 #include <FL/Fl_Preferences.H>
 #include <FL/fl_draw.H>
 
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
 //
 // Global class vars...
 //
@@ -40,18 +45,58 @@ int     Fl_Shared_Image::alloc_handlers_ = 0;   // Allocated format handlers
 
 
 //
-// Typedef the C API sort function type the only way I know how...
+// Index of the shared image pool.
+//
+// Images are looked up by name, then by size among the few images that
+// share a name. Released images that are kept in the cache are listed in
+// the order they were released, see Fl_Shared_Image::cache_budget().
 //
 
-extern "C" {
-  typedef int (*compare_func_t)(const void *, const void *);
+namespace {
+
+struct Pool_Entry {
+  int    index;                                 // position in images_[]
+  size_t bytes;                                 // memory used by the image data
+  std::list<Fl_Shared_Image *>::iterator idle;  // position in idle list, or end()
+  bool   cacheable;                             // false if the name can't be requested again
+};
+
+struct Pool {
+  std::unordered_map<std::string, std::vector<Fl_Shared_Image *> > names;
+  std::unordered_map<const Fl_Shared_Image *, Pool_Entry> entries;
+  std::list<Fl_Shared_Image *> idle;            // released images, least recently used first
+  size_t budget;                                // memory budget, 0 = keep no released images
+  size_t bytes;                                 // memory used by all images in the pool
+  unsigned long hits, misses;                   // get() statistics
+  bool trimming;                                // trim_cache_() is running
+  Pool() : budget(0), bytes(0), hits(0), misses(0), trimming(false) { }
+};
+
+} // namespace
+
+// The pool index is never destroyed: images may be released in static destructors.
+static Pool &pool() {
+  static Pool *p = new Pool;
+  return *p;
+}
+
+// Approximate memory used by the data of a shared image
+static size_t image_bytes(const Fl_Shared_Image *shared) {
+  const Fl_Image *img = shared->image();
+  if (!img) return 0;
+  size_t pixels = (size_t)img->data_w() * img->data_h();
+  if (img->d() > 0) return pixels * img->d();   // RGB image
+  return img->count() > 1 ? pixels : (pixels + 7) / 8; // pixmap or bitmap
 }
 
 
 /**
  Returns the Fl_Shared_Image* array.
 
- \return a pointer to an array of shared image pointers, sorted by name and size
+ The array contains all shared images, including released images that are
+ kept in the cache (refcount() is 0), see cache_budget().
+
+ \return a pointer to an array of shared image pointers, in no particular order
  \see Fl_Shared_Image::num_images()
  */
 Fl_Shared_Image **Fl_Shared_Image::images() {
@@ -77,13 +122,8 @@ int Fl_Shared_Image::num_images() {
     -# Image width
     -# Image height
 
-  Binary search in a sorted array works only if we search for the same
-  parameters that were also used for sorting. No special cases are possible
-  here.
-
-  Fl_Shared_Image::find() requires a search for an element with a matching name
-  and the original_ flags set. This is not implemented via binary search, but
-  by a simple run of the array inside Fl_Shared_Image::find().
+  \note The pool of shared images is no longer sorted, so this method is
+    not used by FLTK anymore.
 
   \param[in] i0, i1 image pointer pointer for sorting
   \returns      Whether the images match or their relative sort order (see text).
@@ -148,9 +188,9 @@ Fl_Shared_Image::Fl_Shared_Image(const char *n,
 /**
   Adds a shared image to the image pool.
 
-  This \b protected method adds an image to the pool, an ordered list
-  of shared images. The pool is searched for a matching image whenever
-  one is requested, for instance with Fl_Shared_Image::get() or
+  This \b protected method adds an image to the pool of shared images,
+  which is indexed by image name. The pool is searched for a matching image
+  whenever one is requested, for instance with Fl_Shared_Image::get() or
   Fl_Shared_Image::find().
 
  This method does not increase or decrease reference counts!
@@ -161,7 +201,8 @@ Fl_Shared_Image::add() {
 
   if (num_images_ >= alloc_images_) {
     // Allocate more memory...
-    temp = new Fl_Shared_Image *[alloc_images_ + 32];
+    int alloc = alloc_images_ ? 2 * alloc_images_ : 32;
+    temp = new Fl_Shared_Image *[alloc];
 
     if (alloc_images_) {
       memcpy(temp, images_, alloc_images_ * sizeof(Fl_Shared_Image *));
@@ -170,16 +211,20 @@ Fl_Shared_Image::add() {
     }
 
     images_       = temp;
-    alloc_images_ += 32;
+    alloc_images_ = alloc;
   }
 
+  Pool &p = pool();
+  Pool_Entry &e = p.entries[this];
+  e.index = num_images_;
+  e.bytes = image_bytes(this);
+  e.idle  = p.idle.end();
+  e.cacheable = true;
+  p.bytes += e.bytes;
+  p.names[name_].push_back(this);
+
   images_[num_images_] = this;
   num_images_ ++;
-
-  if (num_images_ > 1) {
-    qsort(images_, num_images_, sizeof(Fl_Shared_Image *),
-          (compare_func_t)compare);
-  }
 }
 
 /**
@@ -196,6 +241,14 @@ Fl_Shared_Image::update() {
     d(image_->d());
     data(image_->data(), image_->count());
     if (W && H) scale(W, H, 0, 1);
+    // Update the memory used by the pool
+    Pool &p = pool();
+    std::unordered_map<const Fl_Shared_Image *, Pool_Entry>::iterator it = p.entries.find(this);
+    if (it != p.entries.end()) {
+      p.bytes -= it->second.bytes;
+      it->second.bytes = image_bytes(this);
+      p.bytes += it->second.bytes;
+    }
   }
 }
 
@@ -214,13 +267,13 @@ Fl_Shared_Image::~Fl_Shared_Image() {
 /**
   Releases and possibly destroys (if refcount <= 0) a shared image.
 
-  In the latter case, it will reorganize the shared image array
-  so that no hole will occur.
+  If a memory budget is set with cache_budget(), an image that owns its
+  image data is not destroyed when its refcount drops to 0, but kept in
+  the cache until it's requested again or evicted to stay within the
+  budget. Images created with get(Fl_RGB_Image*, int) and their copies
+  are always destroyed, because their names can't be requested again.
 */
 void Fl_Shared_Image::release() {
-  int   i;      // Looping var...
-  Fl_Shared_Image *the_original = NULL;
-
 #ifdef SHIM_DEBUG
   printf("----> Fl_Shared_Image::release() %d %s %d %d\n", original_, name_, w(), h());
   print_pool();
@@ -230,6 +283,30 @@ void Fl_Shared_Image::release() {
   refcount_ --;
   if (refcount_ > 0) return;
 
+  // Keep the image in the cache?
+  Pool &p = pool();
+  if (p.budget && alloc_image_) {
+    std::unordered_map<const Fl_Shared_Image *, Pool_Entry>::iterator it = p.entries.find(this);
+    if (it != p.entries.end() && it->second.cacheable) {
+      it->second.idle = p.idle.insert(p.idle.end(), this);
+      trim_cache_();
+      return;
+    }
+  }
+
+  destroy_();
+}
+
+/**
+  Destroys a shared image whose refcount dropped to 0, and removes it from
+  the pool.
+
+  In the pool, the last image takes the place of the removed image so that
+  no hole will occur.
+*/
+void Fl_Shared_Image::destroy_() {
+  Fl_Shared_Image *the_original = NULL;
+
   // If this image is not the original, find the original image and make sure
   // to delete its reference counter as well at the end of this method.
   if (!original()) {
@@ -241,16 +318,24 @@ void Fl_Shared_Image::release() {
     }
   }
 
-  for (i = 0; i < num_images_; i ++) {
-    if (images_[i] == this) {
-      num_images_ --;
-
-      if (i < num_images_) {
-        memmove(images_ + i, images_ + i + 1,
-                (num_images_ - i) * sizeof(Fl_Shared_Image *));
-      }
-
-      break;
+  Pool &p = pool();
+  std::unordered_map<const Fl_Shared_Image *, Pool_Entry>::iterator it = p.entries.find(this);
+  if (it != p.entries.end()) {
+    int i = it->second.index;
+    num_images_ --;
+    if (i < num_images_) {                      // move last image into the hole
+      images_[i] = images_[num_images_];
+      p.entries[images_[i]].index = i;
+    }
+    if (it->second.idle != p.idle.end()) p.idle.erase(it->second.idle);
+    p.bytes -= it->second.bytes;
+    p.entries.erase(it);
+    std::unordered_map<std::string, std::vector<Fl_Shared_Image *> >::iterator n = p.names.find(name_);
+    if (n != p.names.end()) {
+      std::vector<Fl_Shared_Image *> &v = n->second;
+      for (size_t k = 0; k < v.size(); k++)
+        if (v[k] == this) { v.erase(v.begin() + k); break; }
+      if (v.empty()) p.names.erase(n);
     }
   }
 
@@ -467,7 +552,7 @@ void Fl_Shared_Image::uncache()
 
 /** Finds a shared image from its name and size specifications.
 
-  This uses a binary search in the image cache.
+  This uses a hash table lookup by name in the image cache.
 
   If the image \p name exists with the exact width \p W and height \p H,
   then it is returned.
@@ -477,16 +562,13 @@ void Fl_Shared_Image::uncache()
 
   In either case the refcount of the returned image is increased.
   The found image should be released with Fl_Shared_Image::release()
-  when no longer needed.
+  when no longer needed. A released image that was kept in the cache
+  is taken out of the cache again.
 
   An image is marked \p original if it was directly loaded from a file or
   from memory as opposed to copied and resized images.
 
-  This comparison is used in Fl_Shared_Image::find() to find an image that
-  matches the requested one or to find the position where a new image
-  should be entered into the sorted list of shared images.
-
-  It is used in two steps by Fl_Shared_Image::add():
+  Fl_Shared_Image::get() uses this method in two steps:
 
   -# search with exact width and height
   -# if not found, search again with width = 0 (and height = 0)
@@ -496,44 +578,20 @@ void Fl_Shared_Image::uncache()
   marked \p original with the same name, regardless of width and height.
 */
 Fl_Shared_Image* Fl_Shared_Image::find(const char *name, int W, int H) {
-  if (num_images_) {
-    if (W) {
-      Fl_Shared_Image *key;     // Image key
-      Fl_Shared_Image **match;  // Matching image
-
-      key = new Fl_Shared_Image();
-      key->name_ = new char[strlen(name) + 1];
-      strcpy((char *)key->name_, name);
-      key->w(W);
-      key->h(H);
-
-      match = (Fl_Shared_Image **)bsearch(&key, images_, num_images_,
-                                          sizeof(Fl_Shared_Image *),
-                                          (compare_func_t)compare);
-
-      delete key;
-
-      if (match) {
-        (*match)->refcount_ ++;
-        return *match;
-      }
-    } else {
-      // if no width was given we need to find the original. The list is sorted
-      // by name, width, and height, but we need to find the item by name with
-      // the original_ flags set, no matter how wide, so binary search does not
-      // work here.
-      int i;
-      for (i = 0; i < num_images_; ++i) {
-        // If there are thousands of images and running the array becomes
-        // inefficient, we can hand implement a binary search by name, and then
-        // search back and forth from that location for the member with the
-        // original_ flag set.
-        Fl_Shared_Image *img = images_[i];
-        if (img->original_ && img->name_ && (strcmp(img->name_, name) == 0)) {
-          img->refcount_++;
-          return img;
-        }
+  if (!num_images_ || !name) return NULL;
+  Pool &p = pool();
+  std::unordered_map<std::string, std::vector<Fl_Shared_Image *> >::iterator n = p.names.find(name);
+  if (n == p.names.end()) return NULL;
+  const std::vector<Fl_Shared_Image *> &v = n->second;
+  for (size_t k = 0; k < v.size(); k++) {
+    Fl_Shared_Image *img = v[k];
+    if (W ? (img->data_w() == W && img->data_h() == H) : img->original_) {
+      if (img->refcount_++ == 0) {              // kept in cache? take it out
+        Pool_Entry &e = p.entries[img];
+        p.idle.erase(e.idle);
+        e.idle = p.idle.end();
       }
+      return img;
     }
   }
   return NULL;
@@ -582,8 +640,11 @@ Fl_Shared_Image* Fl_Shared_Image::get(const char *name, int W, int H) {
 
   // Find an image by the requested size
   // ::find() increments the ref count for us
-  if ((temp = find(name, W, H)) != NULL)
+  if ((temp = find(name, W, H)) != NULL) {
+    pool().hits++;
     return temp;
+  }
+  pool().misses++;
 
   // Find the original image, size does not matter
   temp = find(name);
@@ -612,9 +673,12 @@ Fl_Shared_Image* Fl_Shared_Image::get(const char *name, int W, int H) {
       temp->refcount_++;
     // add the newly created image to the pool and return it
     new_temp->add();
+    pool().entries[new_temp].cacheable = pool().entries[temp].cacheable;
+    trim_cache_();
     return new_temp;
   }
 
+  trim_cache_();
   return temp;
 }
 
@@ -631,9 +695,108 @@ Fl_Shared_Image *Fl_Shared_Image::get(Fl_RGB_Image *rgb, int own_it)
   Fl_Shared_Image *shared = new Fl_Shared_Image(Fl_Preferences::newUUID(), rgb);
   shared->alloc_image_ = own_it;
   shared->add();
+  // nobody knows the name, so the image is never kept after release()
+  pool().entries[shared].cacheable = false;
   return shared;
 }
 
+/**
+  Sets the memory budget for images that are kept in the cache after they
+  were released.
+
+  If \p bytes is 0, the default, shared images are destroyed as soon as
+  their refcount() drops to 0.
+
+  Otherwise, an image that owns its image data (i.e. not images created
+  from memory with a named constructor of Fl_PNG_Image, Fl_JPEG_Image or
+  Fl_SVG_Image) stays in the cache after its last release(), unless it was
+  created with get(Fl_RGB_Image*, int) or is a copy of such an image. When
+  all shared images take more than \p bytes of memory, the least recently
+  released images are destroyed until they fit, or until no released
+  images are left. Images that are in use are never destroyed.
+
+  The memory of an image is estimated from its size and depth, see
+  cache_bytes().
+
+  \param[in] bytes  the memory budget in bytes
+  \see cache_bytes(), cache_hits(), cache_misses()
+  \since 1.5.0
+*/
+void Fl_Shared_Image::cache_budget(size_t bytes) {
+  pool().budget = bytes;
+  trim_cache_();
+}
+
+/**
+  Returns the memory budget for released images, 0 if released images are
+  destroyed immediately.
+  \see cache_budget(size_t)
+  \since 1.5.0
+*/
+size_t Fl_Shared_Image::cache_budget() {
+  return pool().budget;
+}
+
+/**
+  Returns the memory used by the data of all shared images in bytes,
+  including the released images that are kept in the cache.
+
+  This is an estimate: data_w() * data_h() * d() bytes per color image,
+  data_w() * data_h() bytes per pixmap, and 1 bit per pixel for bitmaps.
+  \since 1.5.0
+*/
+size_t Fl_Shared_Image::cache_bytes() {
+  return pool().bytes;
+}
+
+/**
+  Returns the number of get() calls that found the requested image in
+  the cache, at the requested size.
+  \see cache_misses(), cache_reset_stats()
+  \since 1.5.0
+*/
+unsigned long Fl_Shared_Image::cache_hits() {
+  return pool().hits;
+}
+
+/**
+  Returns the number of get() calls that had to load the requested image,
+  or to make a resized copy of it.
+  \see cache_hits(), cache_reset_stats()
+  \since 1.5.0
+*/
+unsigned long Fl_Shared_Image::cache_misses() {
+  return pool().misses;
+}
+
+/**
+  Resets the counters of cache_hits() and cache_misses() to 0.
+  \since 1.5.0
+*/
+void Fl_Shared_Image::cache_reset_stats() {
+  pool().hits = pool().misses = 0;
+}
+
+/**
+  Destroys the least recently released images until the shared images fit
+  into cache_budget(), or no released images are left.
+
+  Destroying a resized copy releases its original image, which may be
+  kept in the cache itself and destroyed in turn.
+*/
+void Fl_Shared_Image::trim_cache_() {
+  Pool &p = pool();
+  if (p.trimming) return;                       // destroy_() may release more images
+  p.trimming = true;
+  while (!p.idle.empty() && (p.budget == 0 || p.bytes > p.budget)) {
+    Fl_Shared_Image *img = p.idle.front();
+    p.idle.pop_front();
+    p.entries[img].idle = p.idle.end();
+    img->destroy_();
+  }
+  p.trimming = false;
+}
+
 /** Adds a shared image handler, which is basically a test function
   for adding new image formats.
 
@@ -702,7 +865,8 @@ void Fl_Shared_Image::remove_handler(Fl_Shared_Handler f) {
  Print the contents of the shared image pool.
  */
 void Fl_Shared_Image::print_pool() {
-  printf("Fl_Shared_Image: %d images stored in a pool of %d\n", num_images_, alloc_images_);
+  printf("Fl_Shared_Image: %d images stored in a pool of %d, %lu bytes\n",
+         num_images_, alloc_images_, (unsigned long)pool().bytes);
   for (int i=0; i<num_images_; i++) {
     Fl_Shared_Image *img = images_[i];
     printf("%3d: %3d(%c) %4dx%4d: %s\n",
@@ -1,7 +1,7 @@
 //
 // A base class for platform specific system calls.
 //
-// Copyright 1998-2025 by Bill Spitzak and others.
+// Copyright 1998-2026 by Bill Spitzak and others.
 //
 // This library is free software. Distribution and use rights are outlined in
 // the file "COPYING" which should have been included with this file.  If this
@@ -334,6 +334,14 @@ void Fl_System_Driver::gettime(time_t *sec, int *usec) {
   *usec = 0;
 }
 
+// Get time in seconds for measuring intervals.
+double Fl_System_Driver::monotonic_time() {
+  time_t sec;
+  int usec;
+  gettime(&sec, &usec);
+  return sec + usec / 1000000.0;
+}
+
 /**
   Execute platform independent parts of Fl::wait(double).
 
@@ -29,11 +29,14 @@
 #include <stdarg.h>     // va_list
 #include <assert.h>
 #include <string>
+#include <map>
+#include <vector>
 
 #include <FL/Fl.H>
 #include <FL/Fl_Terminal.H>
 
 #include "flstring.h"
+#include "fl_text_scan.h"   // fl_text_printable_prefix()
 
 #include <FL/fl_utf8.h> // fl_utf8len1
 #include <FL/fl_draw.H>
@@ -688,6 +691,269 @@ Fl_Color Fl_Terminal::Utf8Char::attr_bg_color(const Fl_Widget *grp) const {
 ///// RingBuffer Class Methods /////
 ////////////////////////////////////
 
+// Packed history rows
+//
+//    A history row is packed into a string: a flag byte, the number of
+//    style runs, each run as the number of chars and the style's index
+//    in 'styles', then the UTF-8 text of the row without trailing spaces.
+//    Numbers are stored 7 bits per byte, low bits first. If the flag is 1,
+//    each char's text is preceded by its length in bytes; the flag is 0 if
+//    all lengths follow from the UTF-8 lead bytes.
+//
+//    An empty string is a row of default Utf8Char's.
+//
+struct Fl_Terminal::RingBuffer::PackedHistory {
+  // The style of a run of chars
+  struct Style {
+    uchar    attrib, charflags;
+    Fl_Color fgcolor, bgcolor;
+    bool operator<(const Style& o) const {
+      if (fgcolor != o.fgcolor)     return fgcolor < o.fgcolor;
+      if (bgcolor != o.bgcolor)     return bgcolor < o.bgcolor;
+      if (attrib != o.attrib)       return attrib < o.attrib;
+      return charflags < o.charflags;
+    }
+  };
+  std::vector<std::string> rows;          // per ring row: packed history row
+  std::vector<Style> styles;              // styles used by all rows, in order of first use
+  std::map<Style, unsigned> style_index;  // index of each style in styles[]
+  Style last_style;                       // style of last intern() call..
+  unsigned last_index;                    // ..and its index, or ~0 if none
+  size_t compact_at;                      // compact() when styles[] reaches this size
+  // Cache of unpacked rows
+  std::vector<Utf8Char> cache;            // unpacked rows, ring_cols() chars each
+  std::vector<int> cache_row;             // per cache entry: ring row, -1 if unused
+  std::vector<int> row_cache;             // per ring row: cache entry, -1 if not cached
+  int cache_next;                         // next cache entry to reuse
+
+  PackedHistory(int ring_rows) : rows(ring_rows), last_index(~0u), compact_at(size_t(min_compact)),
+                                 row_cache(ring_rows, -1), cache_next(0) { }
+
+  // styles[] never shrinks below this size, see compact()
+  static const size_t min_compact = 1024;
+  void compact();
+
+  // Return index of style 's' in styles[], adding it if new
+  unsigned intern(const Style& s) {
+    if (last_index != ~0u && !(s < last_style) && !(last_style < s)) return last_index;
+    std::map<Style, unsigned>::iterator it = style_index.find(s);
+    if (it != style_index.end()) {
+      last_index = it->second;
+    } else {
+      styles.push_back(s);
+      last_index = style_index[s] = unsigned(styles.size() - 1);
+    }
+    last_style = s;
+    return last_index;
+  }
+  // Drop the cached copy of ring row 'row', if any
+  void uncache(int row) {
+    int e = row_cache[row];
+    if (e >= 0) { cache_row[e] = -1; row_cache[row] = -1; }
+  }
+  // Discard ring row 'row', keep its memory if 'keep' is true
+  void discard(int row, bool keep=false) {
+    if (keep) rows[row].clear();
+    else      std::string().swap(rows[row]);
+    uncache(row);
+  }
+  // Allocate 'entries' cache entries of 'cols' chars each
+  void reset_cache(int entries, int cols) {
+    cache.assign(size_t(entries) * cols, Utf8Char());
+    cache_row.assign(entries, -1);
+    row_cache.assign(rows.size(), -1);
+    cache_next = 0;
+  }
+};
+
+// Write 'val' to 'out', 7 bits per byte. Returns #bytes written (at most 5).
+static int put_packed_uint(char *out, unsigned val) {
+  int n = 0;
+  while (val >= 0x80) { out[n++] = char((val & 0x7f) | 0x80); val >>= 7; }
+  out[n++] = char(val);
+  return n;
+}
+
+// Read a number written by put_packed_uint(), advance 'p'
+static unsigned get_packed_uint(const char *&p) {
+  unsigned val = 0;
+  for (int shift=0; ; shift+=7) {
+    uchar c = uchar(*p++);
+    val |= unsigned(c & 0x7f) << shift;
+    if (!(c & 0x80)) return val;
+  }
+}
+
+// Remove the styles that no row uses anymore from styles[], e.g. those of
+// rows that scrolled out of the history, and renumber the style runs.
+// Runs when styles[] has doubled since the last time, so a long log with
+// many colors doesn't grow styles[] without limit.
+void Fl_Terminal::RingBuffer::PackedHistory::compact() {
+  std::vector<unsigned> remap(styles.size(), ~0u);
+  std::vector<Style> used;
+  std::string packed;
+  for (size_t row=0; row<rows.size(); row++) {
+    std::string& in = rows[row];
+    if (in.empty()) continue;
+    // Rewrite the head and the runs, the text follows unchanged
+    const char *p = in.data();
+    char flag = *p++;
+    unsigned nruns = get_packed_uint(p);
+    char num[5];
+    packed.assign(1, flag);
+    packed.append(num, put_packed_uint(num, nruns));
+    for (unsigned i=0; i<nruns; i++) {
+      unsigned n = get_packed_uint(p);
+      unsigned s = get_packed_uint(p);
+      if (remap[s] == ~0u) { remap[s] = unsigned(used.size()); used.push_back(styles[s]); }
+      packed.append(num, put_packed_uint(num, n));
+      packed.append(num, put_packed_uint(num, remap[s]));
+    }
+    packed.append(p, in.data() + in.size() - p);
+    in.swap(packed);
+  }
+  styles.swap(used);
+  style_index.clear();
+  for (size_t i=0; i<styles.size(); i++) style_index[styles[i]] = unsigned(i);
+  last_index = ~0u;
+  compact_at = MAX(styles.size() * 2, size_t(min_compact));
+}
+
+// Pack the 'cols' chars 'u8c' into ring row 'row' of 'hist'
+void Fl_Terminal::RingBuffer::pack_chars(PackedHistory& hist, const Utf8Char *u8c,
+                                         int cols, int row) {
+  std::string& out = hist.rows[row];
+  out.clear();
+  hist.uncache(row);
+  if (hist.styles.size() >= hist.compact_at) hist.compact();
+  // Text ends at the last non-space char
+  int tcols = cols;
+  while (tcols > 0 && u8c[tcols-1].len_ == 1 && u8c[tcols-1].text_[0] == ' ') tcols--;
+  char flag = 0;
+  size_t tlen = 0;
+  for (int col=0; col<tcols; col++) {
+    if (uchar(u8c[col].text_[0]) < 0x80 ? u8c[col].len_ != 1
+                                        : fl_utf8len1(u8c[col].text_[0]) != u8c[col].len_) flag = 1;
+    tlen += u8c[col].len_;
+  }
+  // Style runs
+  char runs[64];                                  // most rows have a few runs
+  std::string more_runs;
+  int nrunbytes = 0;
+  unsigned nruns = 0;
+  for (int col=0; col<cols; ) {
+    PackedHistory::Style s = { u8c[col].attrib_, u8c[col].charflags_,
+                               u8c[col].fgcolor_, u8c[col].bgcolor_ };
+    int n = 1;
+    while (col + n < cols &&
+           u8c[col+n].attrib_  == s.attrib  && u8c[col+n].charflags_ == s.charflags &&
+           u8c[col+n].fgcolor_ == s.fgcolor && u8c[col+n].bgcolor_   == s.bgcolor) n++;
+    if (nrunbytes > int(sizeof(runs)) - 10) {     // 2 numbers take up to 10 bytes
+      more_runs.append(runs, nrunbytes);
+      nrunbytes = 0;
+    }
+    nrunbytes += put_packed_uint(runs + nrunbytes, n);
+    nrunbytes += put_packed_uint(runs + nrunbytes, hist.intern(s));
+    nruns++;
+    col += n;
+  }
+  char head[6];
+  int nhead = 0;
+  head[nhead++] = flag;
+  nhead += put_packed_uint(head + nhead, nruns);
+  out.append(head, nhead);
+  out += more_runs;
+  out.append(runs, nrunbytes);
+  // Text
+  size_t pos = out.size();
+  out.resize(pos + tlen + (flag ? tcols : 0));
+  char *p = &out[pos];
+  for (int col=0; col<tcols; col++) {
+    if (flag) *p++ = char(u8c[col].len_);
+    if (u8c[col].len_ == 1) *p++ = u8c[col].text_[0];
+    else { memcpy(p, u8c[col].text_, u8c[col].len_); p += u8c[col].len_; }
+  }
+}
+
+// Unpack ring row 'row' of 'hist' into the 'cols' chars 'u8c'
+void Fl_Terminal::RingBuffer::unpack_chars(const PackedHistory& hist, int row,
+                                           Utf8Char *u8c, int cols) {
+  const std::string& in = hist.rows[row];
+  int col = 0;
+  if (!in.empty()) {
+    const char *p   = in.data();
+    const char *end = p + in.size();
+    char flag       = *p++;
+    unsigned nruns  = get_packed_uint(p);
+    // Text follows the runs
+    const char *text = p;
+    for (unsigned i=0; i<nruns; i++) { get_packed_uint(text); get_packed_uint(text); }
+    for (unsigned i=0; i<nruns; i++) {
+      int n = int(get_packed_uint(p));
+      const PackedHistory::Style& s = hist.styles[get_packed_uint(p)];
+      for (; n>0 && col<cols; n--, col++) {
+        Utf8Char& c = u8c[col];
+        if (text < end) {
+          int len = flag ? int(uchar(*text++)) : fl_utf8len1(*text);
+          c.text_utf8_(text, len);
+          text += len;
+        } else {
+          c.text_utf8_(" ", 1);
+        }
+        c.attrib_    = s.attrib;
+        c.charflags_ = s.charflags;
+        c.fgcolor_   = s.fgcolor;
+        c.bgcolor_   = s.bgcolor;
+      }
+    }
+  }
+  for (; col<cols; col++) u8c[col] = Utf8Char();
+}
+
+// Return the chars of history row 'row', unpacked into the cache
+const Fl_Terminal::Utf8Char* Fl_Terminal::RingBuffer::hist_chars(int row) const {
+  PackedHistory& hist = *packed_;
+  int e = hist.row_cache[row];
+  if (e < 0) {
+    e = hist.cache_next;                          // reuse oldest cache entry
+    hist.cache_next = (e + 1) % int(hist.cache_row.size());
+    if (hist.cache_row[e] >= 0) hist.row_cache[hist.cache_row[e]] = -1;
+    hist.cache_row[e]   = row;
+    hist.row_cache[row] = e;
+    unpack_chars(hist, row, &hist.cache[size_t(e) * ring_cols_], ring_cols_);
+  }
+  return &hist.cache[size_t(e) * ring_cols_];
+}
+
+// Return the chars of ring row 'row' for writing, unpacking it if needed.
+//    An unpacked history row stays unpacked until it's scrolled into the
+//    display again, or until sync_rows().
+//
+Fl_Terminal::Utf8Char* Fl_Terminal::RingBuffer::unpacked_chars(int row) {
+  if (!row_chars_[row]) {
+    row_chars_[row] = new Utf8Char[ring_cols_];
+    unpack_chars(*packed_, row, row_chars_[row], ring_cols_);
+    packed_->discard(row);
+  }
+  return row_chars_[row];
+}
+
+// Unpack display rows and pack history rows,
+// e.g. after the display/history ratio changed. Resets the cache.
+//
+void Fl_Terminal::RingBuffer::sync_rows(void) {
+  for (int row=0; row<ring_rows_; row++) {
+    if (is_disp_ring_row(row)) {
+      unpacked_chars(row);                        // history row became display row?
+    } else if (row_chars_[row]) {                 // unpacked history row?
+      pack_chars(*packed_, row_chars_[row], ring_cols_, row);
+      delete[] row_chars_[row];
+      row_chars_[row] = 0;
+    }
+  }
+  packed_->reset_cache(MAX(disp_rows_, 16), ring_cols_);
+}
+
 // Handle adjusting 'offset_' specified number of rows to do "scrolling".
 //    rows can be +/-: positive effectively scrolls "up", negative scrolls "down".
 //    rows will be clamped
@@ -734,41 +1000,51 @@ void Fl_Terminal::RingBuffer::new_copy(int drows, int dcols, int hrows, const Ch
   int addhist       = disp_rows() - drows;                  // adjust history use
   int new_ring_rows = (drows+hrows);
   int new_hist_use  = clamp(hist_use_ + addhist, 0, hrows); // clamp in case new_hist_rows smaller than old
-  int new_nchars    = (new_ring_rows * dcols);
-  Utf8Char *new_ring_chars = new Utf8Char[new_nchars];      // Create new ring buffer (†)
+  Utf8Char **new_row_chars = new Utf8Char*[new_ring_rows];  // Create new ring buffer (†)
+  PackedHistory *new_packed = new PackedHistory(new_ring_rows);
+  for (int row=0; row<new_ring_rows; row++)
+    new_row_chars[row] = (row >= hrows) ? new Utf8Char[dcols] : 0;
   // Preserve old contents in new buffer
-  int dst_cols      = dcols;
+  const RingBuffer& old = *this;                            // read history rows w/out unpacking them
+  Utf8Char *tmp     = new Utf8Char[dcols];                  // history row being repacked
   int src_stop_row  = hist_use_srow();
   int tcols         = MIN(ring_cols(), dcols);
   int src_row       = hist_use_srow() + hist_use_ + disp_rows_ - 1; // use row#s relative to hist_use_srow()
   int dst_row       = new_ring_rows - 1;
   // Copy rows: working up from bottom of disp, stop at top of hist
   while ((src_row >= src_stop_row) && (dst_row >= 0)) {
-    Utf8Char *src = u8c_ring_row(src_row);
-    Utf8Char *dst = new_ring_chars + (dst_row*dst_cols);
+    const Utf8Char *src = old.u8c_ring_row(src_row);
+    Utf8Char *dst = new_row_chars[dst_row] ? new_row_chars[dst_row] : tmp;
     for (int col=0; col<tcols; col++ ) *dst++ = *src++;
+    if (!new_row_chars[dst_row]) pack_chars(*new_packed, tmp, dcols, dst_row);
     --src_row;
     --dst_row;
   }
+  delete[] tmp;
   // Install new buffer: dump old, install new, adjust internals
-  if (ring_chars_) delete[] ring_chars_;
-  ring_chars_ = new_ring_chars;
+  clear();
+  row_chars_  = new_row_chars;
+  packed_     = new_packed;
   ring_rows_  = new_ring_rows;
   ring_cols_  = dcols;
-  nchars_     = new_nchars;
   hist_rows_  = hrows;
   hist_use_   = new_hist_use;
   disp_rows_  = drows;
   offset_     = 0;        // for new buffer, we used a zero offset
+  packed_->reset_cache(MAX(disp_rows_, 16), ring_cols_);
 }
 
 // Clear the class, delete previous ring if any
 void Fl_Terminal::RingBuffer::clear(void) {
-  if (ring_chars_) delete[] ring_chars_; // dump our ring
-  ring_chars_ = 0;
+  if (row_chars_) {                      // dump our ring
+    for (int row=0; row<ring_rows_; row++) delete[] row_chars_[row];
+    delete[] row_chars_;
+  }
+  delete packed_;
+  row_chars_  = 0;
+  packed_     = 0;
   ring_rows_  = 0;
   ring_cols_  = 0;
-  nchars_     = 0;
   hist_rows_  = 0;
   hist_use_   = 0;
   disp_rows_  = 0;
@@ -776,20 +1052,32 @@ void Fl_Terminal::RingBuffer::clear(void) {
 }
 
 // Clear history
+//    Unused history rows are never shown, so just drop their contents.
+//
 void Fl_Terminal::RingBuffer::clear_hist(void) {
   hist_use_ = 0;
+  for (int hrow=0; hrow<hist_rows_; hrow++) {
+    int row = (hrow + offset_) % ring_rows_;
+    delete[] row_chars_[row];
+    row_chars_[row] = 0;
+    packed_->discard(row);
+  }
 }
 
 // Default ctor
 Fl_Terminal::RingBuffer::RingBuffer(void) {
-  ring_chars_ = 0;
+  row_chars_  = 0;
+  packed_     = 0;
+  ring_rows_  = 0;
   clear();
 }
 
 // Ctor with specific sizes
 Fl_Terminal::RingBuffer::RingBuffer(int drows, int dcols, int hrows) {
   // Start with cleared buffer first..
-  ring_chars_ = 0;
+  row_chars_  = 0;
+  packed_     = 0;
+  ring_rows_  = 0;
   clear();
   // ..then create.
   create(drows, dcols, hrows);
@@ -797,8 +1085,7 @@ Fl_Terminal::RingBuffer::RingBuffer(int drows, int dcols, int hrows) {
 
 // Dtor
 Fl_Terminal::RingBuffer::~RingBuffer(void) {
-  if (ring_chars_) delete[] ring_chars_;
-  ring_chars_ = NULL;
+  clear();
 }
 
 // See if 'grow' is within the history buffer
@@ -834,10 +1121,12 @@ void Fl_Terminal::RingBuffer::move_disp_row(int src_row, int dst_row) {
 
 // Clear the display rows 'sdrow' thru 'edrow' inclusive using specified CharStyle 'style'
 void Fl_Terminal::RingBuffer::clear_disp_rows(int sdrow, int edrow, const CharStyle& style) {
+  Utf8Char blank;
+  blank.clear(style);
   for (int drow=sdrow; drow<=edrow; drow++) {
     int row = hist_rows_ + drow + offset_;
     Utf8Char *u8c = u8c_ring_row(row);
-    for (int col=0; col<disp_cols(); col++) u8c++->clear(style);
+    for (int col=0; col<disp_cols(); col++) u8c[col] = blank;
   }
 }
 
@@ -871,6 +1160,18 @@ void Fl_Terminal::RingBuffer::scroll(int rows, const CharStyle& style) {
     //                                   Simple
     //                                   Offset
     rows = clamp(rows, 1, disp_rows());                        // sanity
+    // Pack the rows going into history, reuse their chars for the
+    // history rows that become display rows.
+    for (int i=0; i<rows; i++) {
+      int src = (hist_rows_ + i + offset_) % ring_rows_;       // display row -> history
+      int dst = (i + offset_) % ring_rows_;                    // history row -> display
+      if (src == dst) continue;                                // no history
+      pack_chars(*packed_, row_chars_[src], ring_cols_, src);
+      delete[] row_chars_[dst];
+      row_chars_[dst] = row_chars_[src];
+      row_chars_[src] = 0;
+      packed_->discard(dst, true);                             // reused when it's history again
+    }
     // Scroll up into history
     offset_adjust(rows);
     // Adjust hist_use, clamp to max
@@ -921,7 +1222,7 @@ void Fl_Terminal::RingBuffer::scroll(int rows, const CharStyle& style) {
 const Fl_Terminal::Utf8Char* Fl_Terminal::RingBuffer::u8c_ring_row(int row) const {
   row = normalize(row, ring_rows());
   assert(row >= 0 && row < ring_rows_);
-  return &ring_chars_[row * ring_cols()];
+  return row_chars_[row] ? row_chars_[row] : hist_chars(row);
 }
 
 // Return UTF-8 char for beginning of 'row' in the history buffer.
@@ -936,7 +1237,7 @@ const Fl_Terminal::Utf8Char* Fl_Terminal::RingBuffer::u8c_hist_row(int hrow) con
   int rowi = normalize(hrow, hist_rows());
   rowi = (rowi + offset_) % ring_rows_;
   assert(rowi >= 0 && rowi <= ring_rows_);
-  return &ring_chars_[rowi * ring_cols()];
+  return row_chars_[rowi] ? row_chars_[rowi] : hist_chars(rowi);
 }
 
 // Special case to walk the "in use" rows of the history
@@ -951,9 +1252,9 @@ const Fl_Terminal::Utf8Char* Fl_Terminal::RingBuffer::u8c_hist_use_row(int hurow
   if (hist_use_ == 0) return 0;             // history is empty! (caller is dumb to ask)
   hurow = hurow % hist_use_;                // normalize indexing within history in use
   hurow = hist_rows_ - hist_use_ + hurow;   // index hist_use rows from end history
-  hurow = (hurow + offset_) % ring_rows_;   // convert to absolute index in ring_chars_[]
-  assert(hurow >= 0 && hurow <= hist_use());
-  return &ring_chars_[hurow * ring_cols()];
+  hurow = (hurow + offset_) % ring_rows_;   // convert to absolute index in ring
+  assert(hurow >= 0 && hurow <= ring_rows_);
+  return row_chars_[hurow] ? row_chars_[hurow] : hist_chars(hurow);
 }
 
 // Return UTF-8 char for beginning of 'row' in the display buffer
@@ -968,10 +1269,11 @@ const Fl_Terminal::Utf8Char* Fl_Terminal::RingBuffer::u8c_disp_row(int drow) con
   int rowi = normalize(drow, disp_rows());
   rowi = (hist_rows_ + rowi + offset_) % ring_rows_; // display starts at end of history
   assert(rowi >= 0 && rowi <= ring_rows_);
-  return &ring_chars_[rowi * ring_cols()];
+  return row_chars_[rowi];
 }
 
 // non-const versions of the above ////////////////////////////////////////////////
+//    These unpack history rows for good, see unpacked_chars().
 
 // Return UTF-8 char for 'row' in the ring.
 // Scrolling offset is NOT applied; this is raw access to the ring's rows.
@@ -983,13 +1285,15 @@ const Fl_Terminal::Utf8Char* Fl_Terminal::RingBuffer::u8c_disp_row(int drow) con
 //   }
 //
 Fl_Terminal::Utf8Char* Fl_Terminal::RingBuffer::u8c_ring_row(int row)
-  { return const_cast<Utf8Char*>(const_cast<const RingBuffer*>(this)->u8c_ring_row(row)); }
+  { return unpacked_chars(normalize(row, ring_rows())); }
 
 Fl_Terminal::Utf8Char* Fl_Terminal::RingBuffer::u8c_hist_row(int hrow)
-  { return const_cast<Utf8Char*>(const_cast<const RingBuffer*>(this)->u8c_hist_row(hrow)); }
+  { return unpacked_chars((normalize(hrow, hist_rows()) + offset_) % ring_rows_); }
 
-Fl_Terminal::Utf8Char* Fl_Terminal::RingBuffer::u8c_hist_use_row(int hurow)
-  { return const_cast<Utf8Char*>(const_cast<const RingBuffer*>(this)->u8c_hist_use_row(hurow)); }
+Fl_Terminal::Utf8Char* Fl_Terminal::RingBuffer::u8c_hist_use_row(int hurow) {
+  if (hist_use_ == 0) return 0;             // history is empty! (caller is dumb to ask)
+  return unpacked_chars((hist_rows_ - hist_use_ + hurow % hist_use_ + offset_) % ring_rows_);
+}
 
 // Return UTF-8 char for beginning of 'row' in the display buffer
 // Example:
@@ -1017,8 +1321,10 @@ void Fl_Terminal::RingBuffer::create(int drows, int dcols, int hrows) {
   // Ring buffer
   ring_rows_  = hist_rows_ + disp_rows_;
   ring_cols_  = dcols;
-  nchars_     = ring_rows_ * ring_cols_;
-  ring_chars_ = new Utf8Char[nchars_];
+  row_chars_  = new Utf8Char*[ring_rows_];
+  for (int row=0; row<ring_rows_; row++) row_chars_[row] = 0;
+  packed_     = new PackedHistory(ring_rows_);
+  sync_rows();              // unpack display rows
 }
 
 // Resize the buffer, preserve previous contents as much as possible
@@ -1037,6 +1343,7 @@ void Fl_Terminal::RingBuffer::resize(int drows, int dcols, int hrows, const Char
     hist_rows_  = hrows;                          // adj hist rows for new value
     disp_rows_  = drows;                          // adj disp rows for new value
     hist_use_   = clamp(hist_use_ + addhist, 0, hrows);
+    sync_rows();                                  // (un)pack rows that changed sides
   }
 }
 
@@ -1048,19 +1355,70 @@ void Fl_Terminal::RingBuffer::change_disp_rows(int drows, const CharStyle& style
 void Fl_Terminal::RingBuffer::change_disp_cols(int dcols, const CharStyle& style)
   { resize(disp_rows(), dcols, hist_rows(), style); }
 
+///////////////////////////////////
+///// DirtyRows Class Methods /////
+///////////////////////////////////
+
+// Display scrolled up 'nrows': move the modified rows up with it,
+// the rows cleared at the bottom are modified.
+//
+void Fl_Terminal::DirtyRows::scroll(int nrows) {
+  int drows = (int)rows_.size();
+  if (all_ || nrows <= 0) return;
+  if (scrolled_ + nrows >= drows) { all_ = true; return; }
+  for (int drow=0; drow<drows; drow++)
+    rows_[drow] = (drow + nrows < drows) ? rows_[drow + nrows] : 1;
+  scrolled_ += nrows;
+}
+
+// All rows were drawn: clear the modified rows, and remember the
+// #display rows, the view and the cursor row for the next draw()
+//
+void Fl_Terminal::DirtyRows::drawn(int drows, const std::vector<long>& view, int cursor_row) {
+  rows_.assign(drows, 0);
+  view_       = view;
+  all_        = false;
+  scrolled_   = 0;
+  cursor_row_ = cursor_row;
+}
+
 /////////////////////////////////////
 ///// Fl_Terminal Class Methods /////
 /////////////////////////////////////
 
-/// See docs for non-const version of u8c_ring_row(int)
+/**
+  Return UTF-8 char for row \p grow in the ring buffer, for reading only.
+
+  History rows are kept packed; this returns an unpacked copy that is
+  only valid until other history rows are read, so don't keep the pointer
+  around while walking other rows. Display rows stay valid.
+
+  \see the non-const version of u8c_ring_row(int) for details and example use.
+*/
 const Fl_Terminal::Utf8Char* Fl_Terminal::u8c_ring_row(int grow) const
   { return ring_.u8c_ring_row(grow); }
 
-/// See docs for non-const version of u8c_hist_row(int)
+/**
+  Return u8c for beginning of a row inside the scrollback history, for reading only.
+
+  The returned chars are an unpacked copy of the row that is only valid
+  until other history rows are read.
+
+  \see the non-const version of u8c_hist_row(int) for details.
+*/
 const Fl_Terminal::Utf8Char* Fl_Terminal::u8c_hist_row(int hrow) const
   { return ring_.u8c_hist_row(hrow); }
 
-/// See docs for non-const version of u8c_hist_use_row(int)
+/**
+  Return u8c for beginning of row \p hurow inside the 'in use' part
+  of the scrollback history, for reading only.
+
+  The returned chars are an unpacked copy of the row that is only valid
+  until other history rows are read. Walking the rows one at a time,
+  as in the example of the non-const version, is fine.
+
+  \see the non-const version of u8c_hist_use_row(int) for details and example use.
+*/
 const Fl_Terminal::Utf8Char* Fl_Terminal::u8c_hist_use_row(int hurow) const
   { return ring_.u8c_hist_use_row(hurow); }
 
@@ -1096,17 +1454,33 @@ const Fl_Terminal::Utf8Char* Fl_Terminal::u8c_disp_row(int drow) const
       }
   }
   \endcode
+
+  The non-const methods that return rows flag the rows as modified,
+  so that the next draw() redraws them.
+
+  History rows are kept packed to save memory. The non-const methods
+  unpack them for good, so the rows use the full Utf8Char memory until
+  they're scrolled into the display again or the terminal is resized.
+  Code that only reads the rows should use the const methods.
 */
-Fl_Terminal::Utf8Char* Fl_Terminal::u8c_ring_row(int grow)
-  { return const_cast<Utf8Char*>(const_cast<const Fl_Terminal*>(this)->u8c_ring_row(grow)); }
+Fl_Terminal::Utf8Char* Fl_Terminal::u8c_ring_row(int grow) {
+  if (is_disp_ring_row(grow)) dirty_.set(normalize(grow - disp_srow(), ring_rows()));
+  else                        dirty_.set_all();     // history row: may be on screen
+  return ring_.u8c_ring_row(grow);
+}
 
 /**
   Return u8c for beginning of a row inside the scrollback history.
   'hrow' is indexed relative to the beginning of the scrollback history buffer.
+
+  Unpacks the row for good, see u8c_ring_row(int); use the const
+  version to only read it.
   \see u8c_disp_row(int) for example use.
 */
-Fl_Terminal::Utf8Char* Fl_Terminal::u8c_hist_row(int hrow)
-  { return const_cast<Utf8Char*>(const_cast<const Fl_Terminal*>(this)->u8c_hist_row(hrow)); }
+Fl_Terminal::Utf8Char* Fl_Terminal::u8c_hist_row(int hrow) {
+  dirty_.set_all();
+  return ring_.u8c_hist_row(hrow);
+}
 
 /**
   Return u8c for beginning of row \p hurow inside the 'in use' part
@@ -1118,23 +1492,29 @@ Fl_Terminal::Utf8Char* Fl_Terminal::u8c_hist_row(int hrow)
   aren't many (or any) rows in the history buffer that have been
   populated with scrollback text yet.
 
-  Example to walk all "in use" lines of the history buffer:
+  Unpacks the row for good, see u8c_ring_row(int); use the const
+  version to only read it, as in this example to walk all "in use"
+  lines of the history buffer:
   \code
   // Walk the entire screen history ("in use") and display to stdout
-  for (int row=0; row<hist_use(); row++) {
-      const Utf8Char *u8c = u8c_hist_use_row(row);            // first char in row
-      for (int col=0; col<hist_cols(); col++,u8c++) {         // walk columns left-to-right
-          // ..Do things here with each u8c char..
-          ::printf("%.*s", u8c->length(), u8c->text_utf8());  // show each utf8 char to stdout
+  void MyTerminal::print_history() const {
+      for (int row=0; row<hist_use(); row++) {
+          const Utf8Char *u8c = u8c_hist_use_row(row);            // first char in row
+          for (int col=0; col<hist_cols(); col++,u8c++) {         // walk columns left-to-right
+              // ..Do things here with each u8c char..
+              ::printf("%.*s", u8c->length(), u8c->text_utf8());  // show each utf8 char to stdout
+          }
+          ::printf("\n"); // end of each line
       }
-      ::printf("\n"); // end of each line
   }
   \endcode
 
   \see u8c_disp_row(int) for example use.
 */
-Fl_Terminal::Utf8Char* Fl_Terminal::u8c_hist_use_row(int hurow)
-  { return const_cast<Utf8Char*>(const_cast<const Fl_Terminal*>(this)->u8c_hist_use_row(hurow)); }
+Fl_Terminal::Utf8Char* Fl_Terminal::u8c_hist_use_row(int hurow) {
+  dirty_.set_all();
+  return ring_.u8c_hist_use_row(hurow);
+}
 
 /**
   Return pointer to the first u8c character in row \p drow of the display.
@@ -1166,8 +1546,10 @@ Fl_Terminal::Utf8Char* Fl_Terminal::u8c_hist_use_row(int hurow)
 
   \see u8c_hist_use_row() for examples of walking the screen history
 */
-Fl_Terminal::Utf8Char* Fl_Terminal::u8c_disp_row(int drow)
-  { return const_cast<Utf8Char*>(const_cast<const Fl_Terminal*>(this)->u8c_disp_row(drow)); }
+Fl_Terminal::Utf8Char* Fl_Terminal::u8c_disp_row(int drow) {
+  dirty_.set(drow);
+  return const_cast<Utf8Char*>(const_cast<const Fl_Terminal*>(this)->u8c_disp_row(drow));
+}
 
 // Create ring buffer.
 // Input:
@@ -2191,7 +2573,7 @@ bool Fl_Terminal::selection_extend(int X,int Y) {
 void Fl_Terminal::select_word(int grow, int gcol) {
   int i, c0, c1;
   int r = grow, c = gcol;
-  Utf8Char *row = u8c_ring_row(r);
+  const Utf8Char *row = utf8_char_at_glob(r, 0);
   int n = ring_cols();
   if (c >= n) return;
   if (row[c].text_utf8()[0]==' ') {
@@ -2224,6 +2606,8 @@ void Fl_Terminal::select_line(int grow) {
 void Fl_Terminal::scroll(int rows) {
   // Scroll the ring
   ring_.scroll(rows, *current_style_);
+  if (rows > 0) dirty_.scroll(clamp(rows, 1, disp_rows()));
+  else          dirty_.set_all();
   if (rows > 0) update_scrollbar();      // scroll up? changes hist, so scrollbar affected
   else          clear_mouse_selection(); // scroll dn? clear mouse select; it might wrap ring
 }
@@ -2341,13 +2725,7 @@ void Fl_Terminal::clear_history(void) {
   // Adjust history use
   ring_.clear_hist();
   scrollbar->value(0);   // zero scroll position
-  // Clear entire history buffer
-  for (int hrow=0; hrow<hist_rows(); hrow++) {
-    Utf8Char *u8c = u8c_hist_row(hrow);          // walk history rows..
-    for (int hcol=0; hcol<hist_cols(); hcol++) { // ..and history cols
-      (u8c++)->clear(*current_style_);
-    }
-  }
+  dirty_.set_all();
   // Adjust scrollbar (hist_use changed)
   update_scrollbar();
 }
@@ -2975,7 +3353,8 @@ void Fl_Terminal::display_modified(void) {
   } else if (is_redraw_style(PER_WRITE)) {
     if (!redraw_modified_) {
       redraw_modified_ = true;
-      redraw();                      // only call redraw once
+      rows_dirty_only_ = true;       // only call redraw once; modified rows only
+      damage(FL_DAMAGE_SCROLL);
     }
   } else {                           // NO_REDRAW?
     // do nothing
@@ -3136,6 +3515,24 @@ void Fl_Terminal::print_char(char c) {
   }
 }
 
+// Print the printable ASCII chars s[0..len) at the cursor, and advance the cursor.
+//    Same as calling print_char() for each char when no ESC sequence is in
+//    progress, but fills each display row in one go.
+//
+void Fl_Terminal::print_printable(const char *s, int len) {
+  while (len > 0) {
+    int col = cursor_col();
+    int n   = MIN(len, disp_cols() - col);           // chars that fit on cursor's row
+    if (n <= 0) { cursor_crlf(1); continue; }        // cursor beyond right edge?
+    Utf8Char *u8c = u8c_disp_row(cursor_row()) + col;
+    for (int i=0; i<n; i++) u8c[i].text_utf8(s + i, 1, *current_style_);
+    s   += n;
+    len -= n;
+    if (col + n >= disp_cols()) cursor_crlf(1);      // hit right edge? wrap, same as cursor_right()
+    else                        cursor_.col(col + n);
+  }
+}
+
 // Clear the Partial UTF-8 Buffer cache
 void Fl_Terminal::utf8_cache_clear(void) {
   pub_.clear();
@@ -3185,6 +3582,16 @@ void Fl_Terminal::append_utf8(const char *buf, int len/*=-1*/) {
   // For sure buf is now pointing at a valid char, so walk to end of buffer
   const char *p = buf;                      // ptr to walk buffer
   while (len>0) {
+    if (!escseq.parse_in_progress()) {      // plain text? print printable ASCII run at once
+      int n = fl_text_printable_prefix(p, len);
+      if (n > 0) {
+        print_printable(p, n);
+        p   += n;
+        len -= n;
+        mod |= 1;
+        continue;
+      }
+    }
     const int clen = fl_utf8len(*p);        // save byte length of char
     if (clen == -1) {                       // Encountered invalid UTF-8?
       if (ansi_) escseq.reset();            //   ..reset escseq
@@ -3218,7 +3625,14 @@ void Fl_Terminal::append_utf8(const char *buf, int len/*=-1*/) {
 */
 void Fl_Terminal::append_ascii(const char *s) {
   if (!s) return;
-  while ( *s ) print_char(*s++);            // handles display_modified()
+  int len = int(strlen(s));
+  while (len > 0) {
+    int n = escseq.parse_in_progress() ? 0 : fl_text_printable_prefix(s, len);
+    if (n > 0) print_printable(s, n);       // plain text? print run at once
+    else     { print_char(*s); n = 1; }
+    s   += n;
+    len -= n;
+  }
   display_modified();
 }
 
@@ -3377,7 +3791,8 @@ void Fl_Terminal::autoscroll_timer_cb(void *udata) {
 void Fl_Terminal::redraw_timer_cb2(void) {
   //DRAWDEBUG ::printf("--- UPDATE TICK %.02f\n", redraw_rate_); fflush(stdout);
   if (redraw_modified_) {
-    redraw();                                                // Timer triggered redraw
+    rows_dirty_only_ = true;                                 // Timer triggered redraw of modified rows
+    damage(FL_DAMAGE_SCROLL);
     redraw_modified_ = false;                                // acknowledge modified flag
     Fl::repeat_timeout(redraw_rate_, redraw_timer_cb, this); // restart timer
   } else {
@@ -3466,6 +3881,7 @@ void Fl_Terminal::init_(int X,int Y,int W,int H,const char*L,int rows,int cols,i
   redraw_rate_     = 0.10f;             // maximum rate in seconds (1/10=10fps)
   redraw_modified_ = false;             // display 'modified' flag
   redraw_timer_    = false;
+  rows_dirty_only_ = false;
   autoscroll_dir_  = 0;
   autoscroll_amt_  = 0;
 
@@ -3599,6 +4015,7 @@ void  Fl_Terminal::hscrollbar_style(ScrollbarStyle val) {
 
   Note we may be called to draw display, or even history if we're scrolled back.
   If there's any change in bg color, we draw the filled rects here.
+  Adjacent chars with the same bg color are filled with a single rect.
 
   If the bg color for a character is the special "see through" color 0xffffffff,
   no pixels are drawn.
@@ -3615,6 +4032,8 @@ void Fl_Terminal::draw_row_bg(int grow, int X, int Y) const {
   int end_col   = disp_cols();
   const Utf8Char *u8c = u8c_ring_row(grow) + start_col;   // start of spec'd row
   uchar lastattr      = u8c->attrib();
+  Fl_Color span_col   = 0xffffffff;                       // color of current span
+  int span_x = X, span_w = 0;                             // position of current span
   for (int gcol=start_col; gcol<end_col; gcol++,u8c++) {  // walk columns
     // Attribute changed since last char?
     if (gcol==0 || u8c->attrib() != lastattr) {
@@ -3627,19 +4046,47 @@ void Fl_Terminal::draw_row_bg(int grow, int X, int Y) const {
                : (u8c->attrib() & Fl_Terminal::INVERSE)   // Inverse mode?
                  ? u8c->attr_fg_color(this)               // ..use fg color for bg
                  : u8c->attr_bg_color(this);              // ..use bg color for bg
-    // Draw only if color != 0xffffffff ('see through' color) or widget's own color().
-    if (bg_col != 0xffffffff && bg_col != Fl_Group::color()) {
-      fl_color(bg_col);
-      fl_rectf(X, bg_y, pwidth, bg_h);
+    // Don't draw 'see through' color 0xffffffff or widget's own color()
+    if (bg_col == Fl_Group::color()) bg_col = 0xffffffff;
+    if (bg_col != span_col) {                             // color changed? end span
+      if (span_col != 0xffffffff && span_w > 0) {
+        fl_color(span_col);
+        fl_rectf(span_x, bg_y, span_w, bg_h);
+      }
+      span_col = bg_col;
+      span_x   = X;
+      span_w   = 0;
     }
+    span_w += pwidth;
     X += pwidth;                                          // advance X to next char
   }
+  if (span_col != 0xffffffff && span_w > 0) {             // draw last span
+    fl_color(span_col);
+    fl_rectf(span_x, bg_y, span_w, bg_h);
+  }
+}
+
+// Draws a run of chars that share font and color with a single fl_draw(),
+// and the run's underline and strikeout.
+//
+static void draw_text_run(const char *text, int len, bool has_text, uchar attrib,
+                          int X, int W, int baseline, int underline_y, int strikeout_y) {
+  if (len <= 0) return;
+  if (has_text) fl_draw(text, len, X, baseline);
+  if (W <= 0) return;
+  if (attrib & Fl_Terminal::UNDERLINE) fl_line(X, underline_y, X+W, underline_y);
+  if (attrib & Fl_Terminal::STRIKEOUT) fl_line(X, strikeout_y, X+W, strikeout_y);
 }
 
 /**
   Draw the specified global row, which is the row in ring_chars[].
   The global row includes history + display buffers.
 
+  Adjacent chars with the same attributes and colors are drawn as one string.
+  A char whose width is not a whole number of pixels ends the string, so that
+  the following chars are positioned at the same pixel columns as the
+  background and the cursor.
+
  \param[in] grow row number
  \param[in] Y top position of characters in the row in FLTK coordinates
 */
@@ -3662,6 +4109,14 @@ void Fl_Terminal::draw_row(int grow, int Y) const {
   uchar lastattr = -1;
   bool  is_cursor;
   Fl_Color fg;
+  // The run of chars drawn with the current font and color
+  char     run[256];                                      // UTF-8 text of run
+  int      run_len  = 0;                                  // bytes in run[]
+  int      run_x    = X;                                  // left edge of run
+  int      run_w    = 0;                                  // width of run in pixels
+  bool     run_text = false;                              // run has non-space chars?
+  uchar    run_attr = 0;                                  // attributes of run
+  Fl_Color run_fg   = 0;                                  // fg color of run
   int start_col = hscrollbar->visible() ? hscrollbar->value() : 0;
   int end_col   = disp_cols();
   const Utf8Char *u8c = u8c_ring_row(grow) + start_col;
@@ -3669,12 +4124,35 @@ void Fl_Terminal::draw_row(int grow, int Y) const {
     const int &dcol = gcol;                               // dcol and gcol are the same
     // Are we drawing the cursor? Only if inside display
     is_cursor = inside_display ? cursor_.is_rowcol(drow-scrollval, dcol) : 0;
-    // Attribute changed since last char?
+    // 1) Color for text
+    if (is_cursor) fg = cursorfgcolor();                     // color for text under cursor
+    else fg = is_inside_selection(grow, gcol)                // text in mouse selection?
+      ? select_.selectionfgcolor()                           // ..use selection FG color
+      : (u8c->attrib() & Fl_Terminal::INVERSE)               // Inverse attrib?
+        ? u8c->attr_bg_color(this)                           // ..use char's bg color for fg
+        : u8c->attr_fg_color(this);                          // ..use char's fg color for fg
+    // End the run if font or color change, the cursor is drawn, or run[] is full
+    if (is_cursor || u8c->attrib() != lastattr || fg != run_fg ||
+        run_len + u8c->length() > (int)sizeof(run)) {
+      draw_text_run(run, run_len, run_text, run_attr, run_x, run_w,
+                    baseline, underline_y, strikeout_y);
+      run_len  = 0;
+      run_x    = X;
+      run_w    = 0;
+      run_text = false;
+    }
+    // 2) Font for text. Attribute changed since last char?
     if (u8c->attrib() != lastattr) {
-      u8c->fl_font_set(*current_style_);                  // pwidth_int() needs fl_font set
+      u8c->fl_font_set(*current_style_);                  // pwidth() needs fl_font set
       lastattr = u8c->attrib();
     }
-    int pwidth = u8c->pwidth_int();
+    double fwidth = u8c->pwidth();
+    int    pwidth = int(fwidth + 0.5);
+    if (run_len == 0) {                                   // new run? set its color
+      run_attr = u8c->attrib();
+      run_fg   = fg;
+      fl_color(fg);
+    }
     // DRAW CURSOR BLOCK - TODO: support other cursor types?
     if (is_cursor) {
       int cx = X;
@@ -3684,29 +4162,29 @@ void Fl_Terminal::draw_row(int grow, int Y) const {
       fl_color(cursorbgcolor());
       if (Fl::focus() == this) fl_rectf(cx, cy, cw, ch);
       else                     fl_rect(cx, cy, cw, ch);
-    }
-    // DRAW TEXT
-    // 1) Color for text
-    if (is_cursor) fg = cursorfgcolor();                     // color for text under cursor
-    else fg = is_inside_selection(grow, gcol)                // text in mouse selection?
-      ? select_.selectionfgcolor()                           // ..use selection FG color
-      : (u8c->attrib() & Fl_Terminal::INVERSE)               // Inverse attrib?
-        ? u8c->attr_bg_color(this)                           // ..use char's bg color for fg
-        : u8c->attr_fg_color(this);                          // ..use char's fg color for fg
-    fl_color(fg);
-    // 2) Font for text - already set by u8c->fl_font_set() in the above
-    if (is_cursor) {
+      fl_color(fg);
       fl_font(fl_font()|FL_BOLD, fl_size());      // force text under cursor BOLD
       lastattr = -1;                              // (ensure font reset on next iter)
     }
-    // 3) Draw text for UTF-8 char. No need to draw spaces
-    if (!u8c->is_char(' ')) fl_draw(u8c->text_utf8(), u8c->length(), X, baseline);
-    // 4) Strike or underline?
-    if (u8c->attrib() & Fl_Terminal::UNDERLINE) fl_line(X, underline_y, X+pwidth, underline_y);
-    if (u8c->attrib() & Fl_Terminal::STRIKEOUT) fl_line(X, strikeout_y, X+pwidth, strikeout_y);
+    // 3) Add text for UTF-8 char to the run. No need to draw spaces
+    memcpy(run + run_len, u8c->text_utf8(), u8c->length());
+    run_len += u8c->length();
+    run_w   += pwidth;
+    if (!u8c->is_char(' ')) run_text = true;
+    // 4) Cursor or char with fractional width? Draw now, next char starts at X+pwidth
+    if (is_cursor || fwidth != pwidth) {
+      draw_text_run(run, run_len, run_text, run_attr, run_x, run_w,
+                    baseline, underline_y, strikeout_y);
+      run_len  = 0;
+      run_w    = 0;
+      run_text = false;
+      run_x    = X + pwidth;
+    }
     // Move to next char pixel position
     X += pwidth;
   }
+  draw_text_run(run, run_len, run_text, run_attr, run_x, run_w,
+                baseline, underline_y, strikeout_y);
 }
 
 /**
@@ -3730,10 +4208,102 @@ void Fl_Terminal::draw_buff(int Y) const {
   }
 }
 
+/**
+  Draws the part \p X, \p Y, \p W, \p H of the terminal screen: fills the
+  background, then draws the rows that intersect the area, clipped to it.
+*/
+void Fl_Terminal::draw_screen_area(int X, int Y, int W, int H) const {
+  fl_push_clip(X, Y, W, H);
+  {
+    if (is_frame(box())) {
+      fl_color(Fl_Group::color());              // flat field, see draw()
+      fl_rectf(X, Y, W, H);
+    } else {
+      draw_box();                               // box() background, clipped
+    }
+    const int rowheight = current_style_->fontheight();
+    int first = (Y - scrn_.y()) / rowheight;
+    int last  = (Y + H - 1 - scrn_.y()) / rowheight;
+    if (first < 0) first = 0;
+    if (last >= disp_rows()) last = disp_rows() - 1;
+    int srow = disp_srow() - scrollbar->value();
+    for (int row=first; row<=last; row++)
+      draw_row(srow + row, scrn_.y() + row * rowheight);
+  }
+  fl_pop_clip();
+}
+
+// fl_scroll() callback: draws the screen area exposed by scrolling
+void Fl_Terminal::draw_scrolled_cb(void *data, int X, int Y, int W, int H) {
+  ((Fl_Terminal*)data)->draw_screen_area(X, Y, W, H);
+}
+
+// Returns the values that affect how all rows are drawn in 'view'.
+//    If any of them changed since the last draw(), all rows are redrawn.
+//
+void Fl_Terminal::view_state(std::vector<long>& view) const {
+  int srow = 0, scol = 0, erow = 0, ecol = 0;
+  bool is_sel = get_selection(srow, scol, erow, ecol);
+  long vals[] = {
+    scrn_.x(), scrn_.y(), scrn_.w(), scrn_.h(), (long)box(),
+    scrollbar->value(), hscrollbar->visible() ? hscrollbar->value() : -1,
+    disp_rows(), disp_cols(), hist_rows(),
+    (long)current_style_->fontface(), (long)current_style_->fontsize(),
+    current_style_->fontheight(), (long)Fl_Group::color(),
+    (long)cursor_.fgcolor(), (long)cursor_.bgcolor(), cursor_.h(), Fl::focus() == this,
+    (long)select_.selectionfgcolor(), (long)select_.selectionbgcolor(),
+    is_sel, srow, scol, erow, ecol
+  };
+  view.assign(vals, vals + sizeof(vals) / sizeof(vals[0]));
+}
+
+/**
+  Redraws only the rows modified since the last draw(), if possible.
+
+  If the display scrolled up since the last draw(), the rows still visible
+  are moved up with fl_scroll() rather than redrawn.
+
+  Returns false if all rows need to be drawn instead, e.g. if the widget
+  was resized, scrolled back into the history, or the colors or the mouse
+  selection changed.
+*/
+bool Fl_Terminal::draw_modified_rows(void) {
+  view_state(view_);
+  if (dirty_.all() || !dirty_.is_view(view_)) return false;
+  // Scrollbars changed? Update them without drawing the group's box
+  if (damage() & FL_DAMAGE_CHILD) {
+    update_child(*scrollbar);
+    update_child(*hscrollbar);
+  }
+  const int rowheight = current_style_->fontheight();
+  const int sv        = scrollbar->value();     // screen row = display row + sv
+  const int scrolled  = dirty_.scrolled();
+  fl_push_clip(scrn_.x(), scrn_.y(), scrn_.w(), scrn_.h());
+  {
+    if (scrolled > 0)
+      fl_scroll(scrn_.x(), scrn_.y(), scrn_.w(), scrn_.h(),
+                0, -scrolled * rowheight, draw_scrolled_cb, this);
+    // Cursor moved? Redraw its old and new rows
+    int old_cursor = dirty_.cursor_row() - scrolled;
+    for (int drow=0; drow<disp_rows(); drow++) {
+      if (!dirty_.is_set(drow) && drow != old_cursor && drow != cursor_.row()) continue;
+      int Y = scrn_.y() + (drow + sv) * rowheight;
+      if (Y >= scrn_.b()) break;
+      draw_screen_area(scrn_.x(), Y, scrn_.w(), rowheight);
+    }
+  }
+  fl_pop_clip();
+  dirty_.drawn(disp_rows(), view_, cursor_.row());
+  return true;
+}
+
 /**
   Draws the entire Fl_Terminal.
   Lets the group draw itself first (scrollbars should be only members),
   followed by the terminal's screen contents.
+
+  If only text was added or changed since the last draw(), just the
+  modified rows are drawn, see draw_modified_rows().
 */
 void Fl_Terminal::draw(void) {
   // First time shown? Force deferred font size calculations here (issue 837)
@@ -3748,6 +4318,12 @@ void Fl_Terminal::draw(void) {
        (hscrollbar->visible() && hscrollbar->h() != Fl::scrollbar_size()))) {
     update_scrollbar();
   }
+  // Only text modified? (rows_dirty_only_ from display_modified())
+  bool dirty_only = rows_dirty_only_;
+  rows_dirty_only_ = false;
+  if (dirty_only && !(damage() & ~(FL_DAMAGE_SCROLL|FL_DAMAGE_CHILD)) &&
+      draw_modified_rows())
+    return;
   // Draw group first, terminal last
   Fl_Group::draw();
   // Draw that little square between the scrollbars:
@@ -3781,6 +4357,8 @@ void Fl_Terminal::draw(void) {
     draw_buff(Y);
   }
   fl_pop_clip();
+  view_state(view_);
+  dirty_.drawn(disp_rows(), view_, cursor_.row());
 }
 
 /**
@@ -16,12 +16,17 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <limits.h>
+#include <sys/stat.h>
 #include <FL/fl_utf8.h>
 #include <FL/fl_string_functions.h>
 #include "flstring.h"
 #include <FL/Fl.H>
 #include <FL/Fl_Text_Buffer.H>
 #include <FL/fl_ask.H>
+#include "Fl_Text_Piece_Table.H"
+#include "Fl_System_Driver.H"
+#include "fl_text_scan.h"
 
 
 /*
@@ -51,6 +56,21 @@
  */
 
 
+// Number of bytes that are loaded per idle callback if lazy loading is enabled
+static const int load_chunk = 4 * 1024 * 1024;
+
+/*
+ State of a mapped file that is being loaded by an idle callback.
+ */
+struct Fl_Text_Buffer::Loader {
+  const char *data;     // the mapped file
+  size_t size;          // size of the mapped file
+  size_t done;          // number of bytes of the file that were processed
+  int pos;              // buffer position where the next text is inserted
+  int transcoded;       // true if some text needed transcoding
+};
+
+
 #ifndef min
 
 static int max(int i1, int i2)
@@ -203,13 +223,25 @@ static void def_transcoding_warning_action(Fl_Text_Buffer *text)
 /*
  Initialize all variables.
  */
-Fl_Text_Buffer::Fl_Text_Buffer(int requestedSize, int preferredGapSize)
+Fl_Text_Buffer::Fl_Text_Buffer(int requestedSize, int preferredGapSize,
+                               Storage storage)
 {
   mLength = 0;
   mPreferredGapSize = preferredGapSize;
-  mBuf = (char *) malloc(requestedSize + mPreferredGapSize);
-  mGapStart = 0;
-  mGapEnd = requestedSize + mPreferredGapSize;
+  if (storage == PIECE_TABLE) {
+    mPieces = new Fl_Text_Piece_Table();
+    mBuf = NULL;
+    mGapStart = mGapEnd = 0;
+  } else {
+    mPieces = NULL;
+    mBuf = (char *) malloc(requestedSize + mPreferredGapSize);
+    mGapStart = 0;
+    mGapEnd = requestedSize + mPreferredGapSize;
+  }
+  mNewlines = NULL;
+  mNewlineGapStart = mNewlineGapEnd = mNewlineCapacity = 0;
+  mLazyLoading = false;
+  mLoader = NULL;
   mTabDist = 8;
   mPrimary.mSelected = 0;
   mPrimary.mStart = mPrimary.mEnd = 0;
@@ -238,7 +270,10 @@ Fl_Text_Buffer::Fl_Text_Buffer(int requestedSize, int preferredGapSize)
  */
 Fl_Text_Buffer::~Fl_Text_Buffer()
 {
+  cancel_loading();
   free(mBuf);
+  free(mNewlines);
+  delete mPieces;
   if (mNModifyProcs != 0) {
     delete[]mModifyProcs;
     delete[]mCbArgs;
@@ -259,8 +294,7 @@ Fl_Text_Buffer::~Fl_Text_Buffer()
  */
 char *Fl_Text_Buffer::text() const {
   char *t = (char *) malloc(mLength + 1);
-  memcpy(t, mBuf, mGapStart);
-  memcpy(t+mGapStart, mBuf+mGapEnd, mLength - mGapStart);
+  copy_bytes_(0, mLength, t);
   t[mLength] = '\0';
   return t;
 }
@@ -273,9 +307,8 @@ char *Fl_Text_Buffer::text() const {
 std::string Fl_Text_Buffer::text_str() const {
   std::string t;
   if (mLength) {
-    t.reserve(mLength);
-    t.insert(0, mBuf, mGapStart);
-    t.insert(mGapStart, mBuf+mGapEnd, mLength - mGapStart);
+    t.resize(mLength);
+    copy_bytes_(0, mLength, &t[0]);
   }
   return t;
 }
@@ -292,20 +325,32 @@ void Fl_Text_Buffer::text(const char *t)
   // then don't return so that internal cleanup can happen
   if (!t) t="";
 
+  cancel_loading();
   call_predelete_callbacks(0, length());
 
   /* Save information for redisplay, and get rid of the old buffer */
   const char *deletedText = text();
   int deletedLength = mLength;
-  free((void *) mBuf);
-
-  /* Start a new buffer with a gap of mPreferredGapSize at the end */
   int insertedLength = (int) strlen(t);
-  mBuf = (char *) malloc(insertedLength + mPreferredGapSize);
+
+  if (mPieces) {
+    /* Release all pieces and start over with a single run of text */
+    mPieces->clear();
+    mPieces->insert(0, t, insertedLength);
+  } else {
+    /* Start a new buffer with a gap of mPreferredGapSize at the end */
+    free((void *) mBuf);
+    mBuf = (char *) malloc(insertedLength + mPreferredGapSize);
+    mGapStart = insertedLength;
+    mGapEnd = mGapStart + mPreferredGapSize;
+    memcpy(mBuf, t, insertedLength);
+    /* Rebuild the newline index */
+    mLength = 0;
+    mNewlineGapStart = 0;
+    mNewlineGapEnd = mNewlineCapacity;
+    index_insert_(0, t, insertedLength);
+  }
   mLength = insertedLength;
-  mGapStart = insertedLength;
-  mGapEnd = mGapStart + mPreferredGapSize;
-  memcpy(mBuf, t, insertedLength);
 
   /* Zero all of the existing selections */
   update_selections(0, deletedLength, 0);
@@ -350,15 +395,7 @@ char *Fl_Text_Buffer::text_range(int start, int end) const {
   s = (char *) malloc(copiedLength + 1);
 
   /* Copy the text from the buffer to the returned string */
-  if (end <= mGapStart) {
-    memcpy(s, mBuf + start, copiedLength);
-  } else if (start >= mGapStart) {
-    memcpy(s, mBuf + start + (mGapEnd - mGapStart), copiedLength);
-  } else {
-    int part1Length = mGapStart - start;
-    memcpy(s, mBuf + start, part1Length);
-    memcpy(s + part1Length, mBuf + mGapEnd, copiedLength - part1Length);
-  }
+  copy_bytes_(start, end, s);
   s[copiedLength] = '\0';
   return s;
 }
@@ -542,6 +579,16 @@ void Fl_Text_Buffer::copy(Fl_Text_Buffer * fromBuf, int fromStart,
 
   int copiedLength = fromEnd - fromStart;
 
+  if (mPieces) {
+    char *t = (char *) malloc(copiedLength);
+    fromBuf->copy_bytes_(fromStart, fromEnd, t);
+    mPieces->insert(toPos, t, copiedLength);
+    free(t);
+    mLength += copiedLength;
+    update_selections(toPos, 0, copiedLength);
+    return;
+  }
+
   /* Prepare the buffer to receive the new text.  If the new text fits in
    the current buffer, just move the gap (if necessary) to where
    the text should be inserted.  If the new text is too large, reallocate
@@ -553,18 +600,8 @@ void Fl_Text_Buffer::copy(Fl_Text_Buffer * fromBuf, int fromStart,
     move_gap(toPos);
 
   /* Insert the new text (toPos now corresponds to the start of the gap) */
-  if (fromEnd <= fromBuf->mGapStart) {
-    memcpy(&mBuf[toPos], &fromBuf->mBuf[fromStart], copiedLength);
-  } else if (fromStart >= fromBuf->mGapStart) {
-    memcpy(&mBuf[toPos],
-           &fromBuf->mBuf[fromStart + (fromBuf->mGapEnd - fromBuf->mGapStart)],
-           copiedLength);
-  } else {
-    int part1Length = fromBuf->mGapStart - fromStart;
-    memcpy(&mBuf[toPos], &fromBuf->mBuf[fromStart], part1Length);
-    memcpy(&mBuf[toPos + part1Length],
-           &fromBuf->mBuf[fromBuf->mGapEnd], copiedLength - part1Length);
-  }
+  fromBuf->copy_bytes_(fromStart, fromEnd, &mBuf[toPos]);
+  index_insert_(toPos, &mBuf[toPos], copiedLength);
   mGapStart += copiedLength;
   mLength += copiedLength;
   update_selections(toPos, 0, copiedLength);
@@ -1055,9 +1092,12 @@ char *Fl_Text_Buffer::line_text(int pos) const {
  */
 int Fl_Text_Buffer::line_start(int pos) const
 {
-  if (!findchar_backward(pos, '\n', &pos))
+  if (pos <= 0)
     return 0;
-  return pos + 1;
+  int index = newlines_before_(pos);
+  if (index == 0)
+    return 0;
+  return newline_position_(index - 1) + 1;
 }
 
 
@@ -1065,9 +1105,35 @@ int Fl_Text_Buffer::line_start(int pos) const
  Find the end of the line.
  */
 int Fl_Text_Buffer::line_end(int pos) const {
-  if (!findchar_forward(pos, '\n', &pos))
-    pos = mLength;
-  return pos;
+  if (pos < 0)
+    pos = 0;
+  if (pos >= mLength)
+    return mLength;
+  pos = newline_position_(newlines_before_(pos));
+  return pos < 0 ? mLength : pos;
+}
+
+
+/*
+ Return the line number that contains pos.
+ */
+int Fl_Text_Buffer::line_of_position(int pos) const
+{
+  if (pos <= 0)
+    return 0;
+  return newlines_before_(pos);
+}
+
+
+/*
+ Return the position of the start of a line.
+ */
+int Fl_Text_Buffer::position_of_line(int line) const
+{
+  if (line <= 0)
+    return 0;
+  int pos = newline_position_(line - 1);
+  return pos < 0 ? mLength : pos + 1;
 }
 
 
@@ -1154,30 +1220,17 @@ int Fl_Text_Buffer::skip_displayed_characters(int lineStartPos, int nChars) cons
 /*
  Count the number of newline characters between start and end.
  startPos and endPos must be at a character boundary.
- This function is optimized for speed by not using UTF-8 calls.
+ The newline index makes this an O(log n) operation.
  */
 int Fl_Text_Buffer::count_lines(int startPos, int endPos) const {
   IS_UTF8_ALIGNED2(this, (startPos))
   IS_UTF8_ALIGNED2(this, (endPos))
 
-  int gapLen = mGapEnd - mGapStart;
-  int lineCount = 0;
-
-  int pos = startPos;
-  while (pos < mGapStart)
-  {
-    if (pos == endPos)
-      return lineCount;
-    if (mBuf[pos++] == '\n')
-      lineCount++;
-  }
-  while (pos < mLength) {
-    if (pos == endPos)
-      return lineCount;
-    if (mBuf[pos++ + gapLen] == '\n')
-      lineCount++;
-  }
-  return lineCount;
+  if (endPos < startPos || endPos > mLength)
+    endPos = mLength;
+  if (startPos >= endPos)
+    return 0;
+  return newlines_before_(endPos) - newlines_before_(startPos);
 }
 
 /**
@@ -1195,6 +1248,26 @@ int Fl_Text_Buffer::estimate_lines(int startPos, int endPos, int lineLen) const
   int softLineBreaks = 0, softLineBreakCount = lineLen;
 
   int pos = startPos;
+  if (mPieces) {
+    while (pos < mLength) {
+      int segLen;
+      const char *seg = mPieces->segment(pos, &segLen);
+      for (int i = 0; i < segLen; i++) {
+        if (pos == endPos)
+          return lineCount + softLineBreaks;
+        pos++;
+        if (seg[i] == '\n') {
+          softLineBreakCount = lineLen;
+          lineCount++;
+        }
+        if (--softLineBreakCount == 0) {
+          softLineBreakCount = lineLen;
+          softLineBreaks++;
+        }
+      }
+    }
+    return lineCount + softLineBreaks;
+  }
   while (pos < mGapStart)
   {
     if (pos == endPos)
@@ -1226,7 +1299,7 @@ int Fl_Text_Buffer::estimate_lines(int startPos, int endPos, int lineLen) const
 /*
  Skip to the first character, n lines ahead.
  StartPos must be at a character boundary.
- This function is optimized for speed by not using UTF-8 calls.
+ The newline index makes this an O(log n) operation.
  */
 int Fl_Text_Buffer::skip_lines(int startPos, int nLines) const
 {
@@ -1235,66 +1308,134 @@ int Fl_Text_Buffer::skip_lines(int startPos, int nLines) const
   if (nLines == 0)
     return startPos;
 
-  int gapLen = mGapEnd - mGapStart;
-  int pos = startPos;
-  int lineCount = 0;
-  while (pos < mGapStart) {
-    if (mBuf[pos++] == '\n') {
-      lineCount++;
-      if (lineCount == nLines) {
-        IS_UTF8_ALIGNED2(this, (pos))
-        return pos;
-      }
-    }
-  }
-  while (pos < mLength) {
-    if (mBuf[pos++ + gapLen] == '\n') {
-      lineCount++;
-      if (lineCount >= nLines) {
-        IS_UTF8_ALIGNED2(this, (pos))
-        return pos;
-      }
-    }
-  }
-  IS_UTF8_ALIGNED2(this, (pos))
-  return pos;
+  int pos = newline_position_(newlines_before_(startPos) + nLines - 1);
+  if (pos < 0 || pos < startPos)
+    return mLength;
+  IS_UTF8_ALIGNED2(this, (pos+1))
+  return pos + 1;
 }
 
 
 /*
  Skip to the first character, n lines back.
  StartPos must be at a character boundary.
- This function is optimized for speed by not using UTF-8 calls.
+ The newline index makes this an O(log n) operation.
  */
 int Fl_Text_Buffer::rewind_lines(int startPos, int nLines) const
 {
   IS_UTF8_ALIGNED2(this, (startPos))
 
-  int pos = startPos - 1;
-  if (pos <= 0)
+  if (startPos - 1 <= 0)
     return 0;
 
-  int gapLen = mGapEnd - mGapStart;
-  int lineCount = -1;
-  while (pos >= mGapStart) {
-    if (mBuf[pos + gapLen] == '\n') {
-      if (++lineCount >= nLines) {
-        IS_UTF8_ALIGNED2(this, (pos+1))
-        return pos + 1;
-      }
+  int pos = newline_position_(newlines_before_(startPos) - 1 - nLines);
+  if (pos < 0)
+    return 0;
+  IS_UTF8_ALIGNED2(this, (pos+1))
+  return pos + 1;
+}
+
+
+/*
+ Return true if a case insensitive search for an ASCII needle can compare
+ bytes instead of characters. This is not the case if the needle contains a
+ letter which is also the lower case version of a non-ASCII character, for
+ instance 'k' and U+212A KELVIN SIGN.
+ */
+static bool ascii_fold_is_exact(const char *s)
+{
+  static char foreign[128];
+  static bool initialized = false;
+  if (!initialized) {
+    for (unsigned u = 0; u < 0x10000; u++) {
+      unsigned l = (unsigned) fl_tolower(u);
+      if (u < 0x80 && l != (unsigned) fl_ascii_tolower(u))
+        foreign[fl_ascii_tolower(u)] = 1;
+      else if (u >= 0x80 && l < 0x80)
+        foreign[l] = 1;
     }
-    pos--;
+    initialized = true;
   }
-  while (pos >= 0) {
-    if (mBuf[pos] == '\n') {
-      if (++lineCount >= nLines) {
-        IS_UTF8_ALIGNED2(this, (pos+1))
-        return pos + 1;
-      }
+  for (; *s; s++) {
+    unsigned char c = (unsigned char) *s;
+    if (c >= 0x80 || foreign[fl_ascii_tolower(c)])
+      return false;
+  }
+  return true;
+}
+
+
+/*
+ Return true if pos is the start of a character, taking into account that
+ prev_char() and next_char() step over composed characters.
+ */
+bool Fl_Text_Buffer::char_start_(int pos) const
+{
+  return pos <= 0 || pos >= mLength || next_char(prev_char(pos)) == pos;
+}
+
+
+/*
+ Return the first position at or after pos where the bytes in needle match,
+ or -1. The search runs on the contiguous runs of bytes around the gap or in
+ the pieces, and checks matches that span two runs separately.
+ */
+int Fl_Text_Buffer::find_bytes_(int pos, const char *needle, int m, bool fold) const
+{
+  char tmp[256];
+  while (pos + m <= mLength) {
+    int len;
+    const char *seg = segment_(pos, &len);
+    int k = fl_text_search(seg, len, needle, m, fold);
+    if (k >= 0)
+      return pos + k;
+    int next = pos + len;
+    if (next >= mLength)
+      return -1;
+    if (m > 1) {
+      int a = max(pos, next - m + 1), b = min(mLength, next + m - 1);
+      char *t = (b - a <= (int) sizeof(tmp)) ? tmp : (char *) malloc(b - a);
+      copy_bytes_(a, b, t);
+      k = fl_text_search(t, b - a, needle, m, fold);
+      if (t != tmp) free(t);
+      if (k >= 0 && a + k < next)
+        return a + k;
     }
-    pos--;
+    pos = next;
   }
-  return 0;
+  return -1;
+}
+
+
+/*
+ Return the last position at or before pos where the bytes in needle match,
+ or -1. See find_bytes_().
+ */
+int Fl_Text_Buffer::rfind_bytes_(int pos, const char *needle, int m, bool fold) const
+{
+  char tmp[256];
+  int end = min(mLength, pos + m);
+  while (end >= m) {
+    int len;
+    const char *seg = segment_before_(end, &len);
+    int k = fl_text_rsearch(seg, len, needle, m, fold);
+    if (k >= 0)
+      return end - len + k;
+    int prev = end - len;
+    if (prev <= 0)
+      return -1;
+    if (m > 1) {
+      int a = max(0, prev - m + 1), b = min(end, prev + m - 1);
+      char *t = (b - a <= (int) sizeof(tmp)) ? tmp : (char *) malloc(b - a);
+      copy_bytes_(a, b, t);
+      k = fl_text_rsearch(t, b - a, needle, m, fold);
+      if (t != tmp) free(t);
+      if (k >= 0 && a + k + m > prev)
+        return a + k;
+    }
+    end = prev;
+  }
+  return -1;
 }
 
 
@@ -1309,46 +1450,46 @@ int Fl_Text_Buffer::search_forward(int startPos, const char *searchString,
 
   if (!searchString)
     return 0;
-  int bp;
-  const char *sp;
-  if (matchCase) {
-    while (startPos < length()) {
-      bp = startPos;
-      sp = searchString;
-      for (;;) {
-        char c = *sp;
-        // we reached the end of the "needle", so we found the string!
-        if (!c) {
-          *foundPos = startPos;
-          return 1;
-        }
-        int len = fl_utf8len1(c);
-        if (memcmp(sp, address(bp), len))
-          break;
-        sp += len; bp += len;
+  if (startPos < 0)
+    startPos = 0;
+  if (matchCase || ascii_fold_is_exact(searchString)) {
+    // fast path: compare bytes using the vectorized scanning functions
+    int m = (int) strlen(searchString);
+    if (!m) {
+      if (startPos >= length()) return 0;
+      *foundPos = startPos;
+      return 1;
+    }
+    for (int pos = startPos; ; pos++) {
+      pos = find_bytes_(pos, searchString, m, !matchCase);
+      if (pos < 0)
+        return 0;
+      if (pos == startPos || char_start_(pos)) {
+        *foundPos = pos;
+        return 1;
       }
-      startPos = next_char(startPos);
     }
-  } else {
-    while (startPos < length()) {
-      bp = startPos;
-      sp = searchString;
-      for (;;) {
-        // we reached the end of the "needle", so we found the string!
-        if (!*sp) {
-          *foundPos = startPos;
-          return 1;
-        }
-        int len;
-        unsigned int b = char_at(bp);
-        unsigned int s = fl_utf8decode(sp, 0, &len);
-        if (fl_tolower(b)!=fl_tolower(s))
-          break;
-        sp += len;
-        bp = next_char(bp);
+  }
+  int bp;
+  const char *sp;
+  while (startPos < length()) {
+    bp = startPos;
+    sp = searchString;
+    for (;;) {
+      // we reached the end of the "needle", so we found the string!
+      if (!*sp) {
+        *foundPos = startPos;
+        return 1;
       }
-      startPos = next_char(startPos);
+      int len;
+      unsigned int b = char_at(bp);
+      unsigned int s = fl_utf8decode(sp, 0, &len);
+      if (fl_tolower(b)!=fl_tolower(s))
+        break;
+      sp += len;
+      bp = next_char(bp);
     }
+    startPos = next_char(startPos);
   }
   return 0;
 }
@@ -1361,46 +1502,44 @@ int Fl_Text_Buffer::search_backward(int startPos, const char *searchString,
 
   if (!searchString)
     return 0;
-  int bp;
-  const char *sp;
-  if (matchCase) {
-    while (startPos >= 0) {
-      bp = startPos;
-      sp = searchString;
-      for (;;) {
-        char c = *sp;
-        // we reached the end of the "needle", so we found the string!
-        if (!c) {
-          *foundPos = startPos;
-          return 1;
-        }
-        int len = fl_utf8len1(c);
-        if (memcmp(sp, address(bp), len))
-          break;
-        sp += len; bp += len;
+  if (matchCase || ascii_fold_is_exact(searchString)) {
+    // fast path: compare bytes using the vectorized scanning functions
+    int m = (int) strlen(searchString);
+    if (!m) {
+      if (startPos < 0) return 0;
+      *foundPos = startPos;
+      return 1;
+    }
+    for (int pos = startPos; ; pos--) {
+      pos = rfind_bytes_(pos, searchString, m, !matchCase);
+      if (pos < 0)
+        return 0;
+      if (pos == startPos || char_start_(pos)) {
+        *foundPos = pos;
+        return 1;
       }
-      startPos = prev_char(startPos);
     }
-  } else {
-    while (startPos >= 0) {
-      bp = startPos;
-      sp = searchString;
-      for (;;) {
-        // we reached the end of the "needle", so we found the string!
-        if (!*sp) {
-          *foundPos = startPos;
-          return 1;
-        }
-        int len;
-        unsigned int b = char_at(bp);
-        unsigned int s = fl_utf8decode(sp, 0, &len);
-        if (fl_tolower(b)!=fl_tolower(s))
-          break;
-        sp += len;
-        bp = next_char(bp);
+  }
+  int bp;
+  const char *sp;
+  while (startPos >= 0) {
+    bp = startPos;
+    sp = searchString;
+    for (;;) {
+      // we reached the end of the "needle", so we found the string!
+      if (!*sp) {
+        *foundPos = startPos;
+        return 1;
       }
-      startPos = prev_char(startPos);
+      int len;
+      unsigned int b = char_at(bp);
+      unsigned int s = fl_utf8decode(sp, 0, &len);
+      if (fl_tolower(b)!=fl_tolower(s))
+        break;
+      sp += len;
+      bp = next_char(bp);
     }
+    startPos = prev_char(startPos);
   }
   return 0;
 }
@@ -1418,21 +1557,28 @@ int Fl_Text_Buffer::insert_(int pos, const char *text, int insertedLength)
 
   if (insertedLength == -1) insertedLength = (int) strlen(text);
 
-  /* Prepare the buffer to receive the new text.  If the new text fits in
-   the current buffer, just move the gap (if necessary) to where
-   the text should be inserted.  If the new text is too large, reallocate
-   the buffer with a gap large enough to accomodate the new text and a
-   gap of mPreferredGapSize */
-  if (insertedLength > mGapEnd - mGapStart)
-    reallocate_with_gap(pos, insertedLength + mPreferredGapSize);
-  else if (pos != mGapStart)
-    move_gap(pos);
-
-  /* Insert the new text (pos now corresponds to the start of the gap) */
-  memcpy(&mBuf[pos], text, insertedLength);
-  mGapStart += insertedLength;
+  if (mPieces) {
+    mPieces->insert(pos, text, insertedLength);
+  } else {
+    /* Prepare the buffer to receive the new text.  If the new text fits in
+     the current buffer, just move the gap (if necessary) to where
+     the text should be inserted.  If the new text is too large, reallocate
+     the buffer with a gap large enough to accomodate the new text and a
+     gap of mPreferredGapSize */
+    if (insertedLength > mGapEnd - mGapStart)
+      reallocate_with_gap(pos, insertedLength + mPreferredGapSize);
+    else if (pos != mGapStart)
+      move_gap(pos);
+
+    /* Insert the new text (pos now corresponds to the start of the gap) */
+    memcpy(&mBuf[pos], text, insertedLength);
+    mGapStart += insertedLength;
+    index_insert_(pos, text, insertedLength);
+  }
   mLength += insertedLength;
   update_selections(pos, 0, insertedLength);
+  if (mLoader && pos <= mLoader->pos)
+    mLoader->pos += insertedLength;
 
   if (mCanUndo) {
     if (mUndo->undoat == pos && mUndo->undoinsert) {
@@ -1486,6 +1632,17 @@ void Fl_Text_Buffer::remove_(int start, int end)
     mUndo->undoyankcut = 0;
   }
 
+  if (mPieces) {
+    if (mCanUndo)
+      mPieces->copy_out(start, end, mUndo->undobuffer);
+    mPieces->remove(start, end);
+    mLength -= end - start;
+    update_selections(start, end - start, 0);
+    if (mLoader)
+      mLoader->pos -= max(0, min(end, mLoader->pos) - start);
+    return;
+  }
+
   if (start > mGapStart) {
     if (mCanUndo)
       memcpy(mUndo->undobuffer, mBuf + (mGapEnd - mGapStart) + start,
@@ -1506,12 +1663,15 @@ void Fl_Text_Buffer::remove_(int start, int end)
   /* expand the gap to encompass the deleted characters */
   mGapEnd += end - mGapStart;
   mGapStart = start;
+  index_remove_(start, end);
 
   /* update the length */
   mLength -= end - start;
 
   /* fix up any selections which might be affected by the change */
   update_selections(start, end - start, 0);
+  if (mLoader)
+    mLoader->pos -= max(0, min(end, mLoader->pos) - start);
 }
 
 
@@ -1725,6 +1885,8 @@ void Fl_Text_Buffer::redisplay_selection(Fl_Text_Selection *
  */
 void Fl_Text_Buffer::move_gap(int pos)
 {
+  if (mPieces)
+    return;
   int gapLen = mGapEnd - mGapStart;
 
   if (pos > mGapStart)
@@ -1742,6 +1904,8 @@ void Fl_Text_Buffer::move_gap(int pos)
  */
 void Fl_Text_Buffer::reallocate_with_gap(int newGapStart, int newGapLen)
 {
+  if (mPieces)
+    return;
   char *newBuf = (char *) malloc(mLength + newGapLen);
   int newGapEnd = newGapStart + newGapLen;
 
@@ -1765,6 +1929,167 @@ void Fl_Text_Buffer::reallocate_with_gap(int newGapStart, int newGapLen)
 }
 
 
+/*
+ Copy a range of bytes around the gap or from the piece table.
+ */
+void Fl_Text_Buffer::copy_bytes_(int start, int end, char *dst) const
+{
+  if (mPieces) {
+    mPieces->copy_out(start, end, dst);
+  } else if (end <= mGapStart) {
+    memcpy(dst, mBuf + start, end - start);
+  } else if (start >= mGapStart) {
+    memcpy(dst, mBuf + start + (mGapEnd - mGapStart), end - start);
+  } else {
+    int part1Length = mGapStart - start;
+    memcpy(dst, mBuf + start, part1Length);
+    memcpy(dst + part1Length, mBuf + mGapEnd, end - start - part1Length);
+  }
+}
+
+
+const char *Fl_Text_Buffer::piece_address_(int pos) const
+{
+  return mPieces->address(pos);
+}
+
+
+/*
+ Return the contiguous run of bytes starting at pos, and its length.
+ */
+const char *Fl_Text_Buffer::segment_(int pos, int *len) const
+{
+  if (mPieces)
+    return mPieces->segment(pos, len);
+  if (pos < mGapStart) {
+    *len = mGapStart - pos;
+    return mBuf + pos;
+  }
+  *len = mLength - pos;
+  return mBuf + pos + (mGapEnd - mGapStart);
+}
+
+
+/*
+ Return the start of the contiguous run of bytes that ends at pos, and its
+ length.
+ */
+const char *Fl_Text_Buffer::segment_before_(int pos, int *len) const
+{
+  if (mPieces)
+    return mPieces->segment_before(pos, len);
+  if (pos <= mGapStart) {
+    *len = pos;
+    return mBuf;
+  }
+  *len = pos - mGapStart;
+  return mBuf + mGapEnd;
+}
+
+
+/*
+ Count the newlines before pos, using a binary search in the newline index.
+ Entries after the index gap are stored relative to the end of the text.
+ */
+int Fl_Text_Buffer::newlines_before_(int pos) const
+{
+  if (mPieces)
+    return mPieces->count_newlines(pos);
+  int lo = 0, hi = mNewlineGapStart;
+  if (hi > 0 && mNewlines[hi - 1] >= pos) {
+    while (lo < hi) {
+      int mid = (lo + hi) / 2;
+      if (mNewlines[mid] < pos) lo = mid + 1;
+      else hi = mid;
+    }
+    return lo;
+  }
+  lo = mNewlineGapEnd;
+  hi = mNewlineCapacity;
+  int rel = pos - mLength;
+  while (lo < hi) {
+    int mid = (lo + hi) / 2;
+    if (mNewlines[mid] < rel) lo = mid + 1;
+    else hi = mid;
+  }
+  return mNewlineGapStart + (lo - mNewlineGapEnd);
+}
+
+
+/*
+ Return the position of the newline with the given index, or -1.
+ */
+int Fl_Text_Buffer::newline_position_(int index) const
+{
+  if (mPieces)
+    return mPieces->newline_position(index);
+  if (index < 0)
+    return -1;
+  if (index < mNewlineGapStart)
+    return mNewlines[index];
+  index += mNewlineGapEnd - mNewlineGapStart;
+  if (index >= mNewlineCapacity)
+    return -1;
+  return mNewlines[index] + mLength;
+}
+
+
+/*
+ Move the gap of the newline index, converting the moved entries between
+ absolute positions and positions relative to the end of the text.
+ Must be called before mLength is changed.
+ */
+void Fl_Text_Buffer::index_move_gap_(int index)
+{
+  while (mNewlineGapStart > index)
+    mNewlines[--mNewlineGapEnd] = mNewlines[--mNewlineGapStart] - mLength;
+  while (mNewlineGapStart < index)
+    mNewlines[mNewlineGapStart++] = mNewlines[mNewlineGapEnd++] + mLength;
+}
+
+
+/*
+ Add the newlines of text that is about to be inserted at pos.
+ Must be called before mLength is changed.
+ */
+void Fl_Text_Buffer::index_insert_(int pos, const char *text, int len)
+{
+  if (mPieces)
+    return;
+  // all newlines after pos must be behind the gap to follow the edit
+  index_move_gap_(newlines_before_(pos));
+  int n = fl_text_count_byte(text, len, '\n');
+  if (!n)
+    return;
+  const char *p, *e = text + len;
+  if (n > mNewlineGapEnd - mNewlineGapStart) {
+    int tail = mNewlineCapacity - mNewlineGapEnd;
+    int newCapacity = mNewlineGapStart + tail + n;
+    newCapacity += newCapacity / 2 + 256;
+    mNewlines = (int *) realloc(mNewlines, newCapacity * sizeof(int));
+    memmove(mNewlines + newCapacity - tail, mNewlines + mNewlineGapEnd, tail * sizeof(int));
+    mNewlineGapEnd = newCapacity - tail;
+    mNewlineCapacity = newCapacity;
+  }
+  for (p = text; (p = (const char *) memchr(p, '\n', e - p)) != NULL; p++)
+    mNewlines[mNewlineGapStart++] = pos + (int) (p - text);
+}
+
+
+/*
+ Remove the newlines of the text between start and end that is about to be
+ removed. Must be called before mLength is changed.
+ */
+void Fl_Text_Buffer::index_remove_(int start, int end)
+{
+  if (mPieces)
+    return;
+  index_move_gap_(newlines_before_(start));
+  while (mNewlineGapEnd < mNewlineCapacity && mNewlines[mNewlineGapEnd] + mLength < end)
+    mNewlineGapEnd++;
+}
+
+
 /*
  Update selection range if characters were inserted.
  Unicode safe. Pos must be at a character boundary.
@@ -1826,9 +2151,14 @@ int Fl_Text_Buffer::findchar_forward(int startPos, unsigned searchChar,
   if (startPos<0)
     startPos = 0;
 
-  for ( ; startPos<mLength; startPos = next_char(startPos)) {
-    if (searchChar == char_at(startPos)) {
-      *foundPos = startPos;
+  char c[8];
+  int m = fl_utf8encode(searchChar, c);
+  for (int pos = startPos; ; pos++) {
+    pos = find_bytes_(pos, c, m, false);
+    if (pos < 0)
+      break;
+    if (pos == startPos || char_start_(pos)) {
+      *foundPos = pos;
       return 1;
     }
   }
@@ -1852,9 +2182,14 @@ int Fl_Text_Buffer::findchar_backward(int startPos, unsigned int searchChar,
   if (startPos > mLength)
     startPos = mLength;
 
-  for (startPos = prev_char(startPos); startPos>=0; startPos = prev_char(startPos)) {
-    if (searchChar == char_at(startPos)) {
-      *foundPos = startPos;
+  char c[8];
+  int m = fl_utf8encode(searchChar, c);
+  for (int pos = startPos - 1; ; pos--) {
+    pos = rfind_bytes_(pos, c, m, false);
+    if (pos < 0)
+      break;
+    if (char_start_(pos)) {
+      *foundPos = pos;
       return 1;
     }
   }
@@ -2013,6 +2348,132 @@ const char *Fl_Text_Buffer::file_encoding_warning_message =
     "of the input file which was not UTF-8 encoded.\n"
     "Some changes may have occurred.";
 
+/*
+ Return the number of bytes at the start of p[0..len) that utf8_input_filter()
+ would copy without changes. Stops at NUL bytes, at characters that need
+ transcoding, and at characters that continue beyond p[len-1].
+ */
+static int utf8_valid_prefix(const char *p, int len)
+{
+  char multibyte[5];
+  int i = 0;
+  for (;;) {
+    i += fl_text_ascii_prefix(p + i, len - i);
+    if (i >= len || !p[i])
+      return i;
+    int n = fl_utf8len1(p[i]), lp;
+    if (i + n > len)
+      return i;
+    unsigned u = fl_utf8decode(p + i, p + i + n, &lp);
+    if (lp != n || fl_utf8encode(u, multibyte) != n)
+      return i;
+    i += n;
+  }
+}
+
+/*
+ Transcode the len bytes of a single UTF-8 sequence, or of what looks like
+ the start of one, in the same way as utf8_input_filter(). Returns the number
+ of bytes written to q, at most 4 * len.
+ */
+static int utf8_transcode(const char *p, int len, char *q)
+{
+  char *q0 = q;
+  while (len > 0) {
+    int lp;
+    unsigned u = fl_utf8decode(p, p + len, &lp);
+    q += fl_utf8encode(u, q);
+    p += lp;
+    len -= lp;
+  }
+  return (int) (q - q0);
+}
+
+/*
+ Insert the next part of the mapped file. Runs of valid UTF-8 text are
+ inserted directly from the mapped memory, a piece table keeps pointing
+ into it. Short runs and transcoded characters are collected in a local
+ buffer first to avoid tiny insertions. NUL bytes are skipped, because the
+ buffer can't store them. insertfile() without lazy loading differs here:
+ insert() stops at the first NUL byte of each block read by fread().
+ */
+bool Fl_Text_Buffer::load_step_(int maxBytes)
+{
+  Loader *ld = mLoader;
+  char buf[4096];
+  int nbuf = 0;
+  size_t stop = ld->size - ld->done > (size_t) maxBytes ? ld->done + maxBytes : ld->size;
+  while (ld->done < stop) {
+    const char *p = ld->data + ld->done;
+    size_t left = ld->size - ld->done;
+    // allow a character to extend beyond stop
+    int n = utf8_valid_prefix(p, (int) (left < stop - ld->done + 4 ? left : stop - ld->done + 4));
+    int need = n ? n : 4 * fl_utf8len1(*p);
+    if (nbuf && (n >= 256 || nbuf + need > (int) sizeof(buf))) {
+      insert(ld->pos, buf, nbuf);
+      nbuf = 0;
+      if (mLoader != ld) return false; // canceled by a modify callback
+    }
+    if (n >= 256) {
+      insert(ld->pos, p, n);
+      ld->done += n;
+      if (mLoader != ld) return false;
+    } else if (n > 0) {
+      memcpy(buf + nbuf, p, n);
+      nbuf += n;
+      ld->done += n;
+    } else {
+      int len = fl_utf8len1(*p);
+      if ((size_t) len > left) {
+        // an incomplete sequence at the end of the file is dropped
+        ld->done = ld->size;
+        break;
+      }
+      ld->transcoded = 1;
+      if (*p) // skip NUL bytes
+        nbuf += utf8_transcode(p, len, buf + nbuf);
+      ld->done += len;
+    }
+  }
+  if (nbuf) {
+    insert(ld->pos, buf, nbuf);
+    if (mLoader != ld) return false;
+  }
+  return ld->done < ld->size;
+}
+
+void Fl_Text_Buffer::load_idle_cb_(void *data)
+{
+  Fl_Text_Buffer *buf = (Fl_Text_Buffer *) data;
+  if (buf->mLoader && !buf->load_step_(load_chunk))
+    buf->finish_loading();
+}
+
+void Fl_Text_Buffer::finish_loading()
+{
+  while (mLoader && load_step_(load_chunk)) { }
+  if (!mLoader)
+    return;
+  int transcoded = mLoader->transcoded;
+  cancel_loading();
+  input_file_was_transcoded = transcoded;
+  if (input_file_was_transcoded && transcoding_warning_action) {
+    transcoding_warning_action(this);
+  }
+}
+
+void Fl_Text_Buffer::cancel_loading()
+{
+  if (!mLoader)
+    return;
+  Fl::remove_idle(load_idle_cb_, this);
+  // a piece table owns the mapping, it may still contain pieces that point to it
+  if (!mPieces)
+    Fl::system_driver()->unmap_file((void *) mLoader->data, mLoader->size);
+  delete mLoader;
+  mLoader = NULL;
+}
+
 /*
  Insert text from a file.
  Input file can be of various encodings according to what input fiter is used.
@@ -2021,9 +2482,50 @@ const char *Fl_Text_Buffer::file_encoding_warning_message =
  */
  int Fl_Text_Buffer::insertfile(const char *file, int pos, int buflen)
 {
+  if (mLazyLoading) {
+    finish_loading();
+    size_t size;
+    void *addr = Fl::system_driver()->map_file(file, &size);
+    if (addr && size > (size_t) (INT_MAX - mLength)) {
+      Fl::system_driver()->unmap_file(addr, size);
+      addr = NULL;
+    }
+    if (addr) {
+      if (pos > mLength) pos = mLength;
+      if (pos < 0) pos = 0;
+      input_file_was_transcoded = false;
+      if (mPieces) {
+        // release the text of previous files if the buffer is empty
+        if (!mLength) mPieces->clear();
+        mPieces->add_mapping(addr, size);
+      } else if (mGapEnd - mGapStart < (int) size) {
+        // make room for the whole file to avoid reallocation for each part
+        reallocate_with_gap(pos, (int) size + mPreferredGapSize);
+      }
+      mLoader = new Loader;
+      mLoader->data = (const char *) addr;
+      mLoader->size = size;
+      mLoader->done = 0;
+      mLoader->pos = pos;
+      mLoader->transcoded = 0;
+      if (load_step_(buflen))
+        Fl::add_idle(load_idle_cb_, this);
+      else
+        finish_loading();
+      return 0;
+    }
+  }
   FILE *fp;
   if (!(fp = fl_fopen(file, "r")))
     return 1;
+  struct stat st;
+  if (!mPieces && !fl_stat(file, &st) && st.st_size > mGapEnd - mGapStart &&
+      st.st_size < INT_MAX - mLength - mPreferredGapSize) {
+    // make room for the whole file to avoid reallocation for each block
+    if (pos > mLength) pos = mLength;
+    if (pos < 0) pos = 0;
+    reallocate_with_gap(pos, (int) st.st_size + mPreferredGapSize);
+  }
   char *buffer = new char[buflen + 1];
   char *endline, line[100];
   int len;
@@ -2063,6 +2565,11 @@ const char *Fl_Text_Buffer::file_encoding_warning_message =
 int Fl_Text_Buffer::outputfile(const char *file,
                                int start, int end,
                                int buflen) {
+  finish_loading();
+  // the file may be one of the files that pieces point to, and truncating
+  // a mapped file makes reading its pages fail
+  if (mPieces)
+    mPieces->release_mappings();
   FILE *fp;
   if (!(fp = fl_fopen(file, "w")))
     return 1;
@@ -32,6 +32,8 @@
 #include <FL/Fl_Menu_Item.H>
 #include <FL/Fl_Input.H>
 #include "Fl_Screen_Driver.H"
+#include "Fl_Text_Width_Cache.H"
+#include "Fl_Text_Wrap_Cache.H"
 
 #undef min
 #undef max
@@ -146,10 +148,13 @@ Fl_Text_Display::Fl_Text_Display(int X, int Y, int W, int H, const char* l)
   mUnfinishedHighlightCB = 0;
   mHighlightCBArg = 0;
   mMaxsize = 0;
+  mScrollDX = mScrollDY = 0;
   mSuppressResync = 0;
   mNLinesDeleted = 0;
   mModifyingTabDistance = 0;    // XXX: UNUSED
   mColumnScale = 0;
+  mWrapCache = new Fl_Text_Wrap_Cache;
+  mWidthCache = new Fl_Text_Width_Cache;
   mCursor_color = FL_FOREGROUND_COLOR;
 
   mHScrollBar = new Fl_Scrollbar(0,0,1,1);
@@ -219,6 +224,9 @@ Fl_Text_Display::~Fl_Text_Display() {
     mBuffer->remove_modify_callback(buffer_modified_cb, this);
     mBuffer->remove_predelete_callback(buffer_predelete_cb, this);
   }
+  Fl::remove_idle(wrap_cache_idle_cb, this);
+  delete mWrapCache;
+  delete mWidthCache;
   if (mLineStarts) delete[] mLineStarts;
   if (linenumber_format_) {
     free((void*)linenumber_format_);
@@ -369,6 +377,7 @@ void Fl_Text_Display::buffer( Fl_Text_Buffer *buf ) {
   /* If the text display is already displaying a buffer, clear it off
    of the display and remove our callback from it */
   if ( buf == mBuffer) return;
+  mWrapCache->clear();
   if ( mBuffer != 0 ) {
     // we must provide a copy of the buffer that we are deleting!
     char *deletedText = mBuffer->text();
@@ -1455,60 +1464,182 @@ int Fl_Text_Display::count_lines(int startPos, int endPos,
    potential soft line breaks.
 
    Most of the resulting information is needed for calculating the vertical
-   scroll bar size. After a certain text length, the scroll bar size is no
-   longer very precise anyway, so we optimize line count for all lines but
-   the visible ones (plus minus a few lines for rounding).
-
-   The optimized code is several magnitudes faster and makes scrolling and
-   window resizing of long texts quite responsive. There is a slight but IMHO
-   tollerable drawback: when walking huge files using arrow up and down, the
-   text display sometimes jumps 2 or 3 lines instead of 1, but the overall
-   buffer stays intact as well as the scroll position.
+   scroll bar size. For large buffers, the number of rows of every complete
+   line is taken from the wrap cache instead. Lines that were not measured yet
+   are estimated from their length, the visible lines (plus minus a few lines
+   for rounding) are measured right away, and all other lines are measured
+   in idle time, so that the scroll bar converges to its exact size without
+   blocking the user interface.
    */
-  if (buffer()->length() > 16384) {
-    // Optimized line counting
-    int nLines = 0;
-    int firstVisibleChar = buffer()->rewind_lines(mFirstChar, 3);
-    int lastVisibleChar = buffer()->skip_lines(mLastChar, 3);
-    // Calculate the averga number of characters up to a soft line break
-    if (mColumnScale==0.0) x_to_col(1.0);
-    int avgCharsPerLine = mWrapMarginPix;
-    if (!avgCharsPerLine) avgCharsPerLine = text_area.w;
-    avgCharsPerLine = (int)(avgCharsPerLine / mColumnScale) + 1;
-
-    // first segment, lines up to display, count fast
-    if (startPos < firstVisibleChar) {
-      int tmpEnd = endPos<firstVisibleChar ? endPos : firstVisibleChar;
-      nLines += buffer()->estimate_lines(startPos, tmpEnd, avgCharsPerLine);
-      startPos = tmpEnd;
-    }
-    // second segement, count displayed liens
-    if (startPos < endPos && startPos < mLastChar) {
-      // Precisse line counting only for visible text:
-      int tmpEnd = endPos<lastVisibleChar ? endPos : lastVisibleChar;
-      wrapped_line_counter(buffer(), startPos, tmpEnd, INT_MAX,
+  Fl_Text_Wrap_Cache *cache = wrap_cache();
+  if (cache) {
+    Fl_Text_Buffer *buf = buffer();
+    int firstLine = buf->line_of_position(startPos);
+    int lastLine = buf->line_of_position(endPos);
+    if (firstLine < lastLine) {
+      // first segment, the rest of the line containing startPos
+      wrapped_line_counter(buf, startPos, buf->line_end(startPos), INT_MAX,
                            startPosIsLineStart, 0, &retPos, &retLines, &retLineStart,
                            &retLineEnd);
-      nLines += retLines;
-      startPos = tmpEnd;
-    }
-    // third segement is everything after displayed lines
-    if (startPos < endPos && startPos >= lastVisibleChar) {
-      nLines += buffer()->estimate_lines(startPos, endPos, avgCharsPerLine);
+      int nLines = retLines + 1;
+      // second segment, complete lines from the cache
+      if (firstLine + 1 < lastLine) {
+        int firstVisible = buf->line_of_position(mFirstChar) - 3;
+        int lastVisible = buf->line_of_position(mLastChar) + 4;
+        measure_wrapped_lines(max(firstLine + 1, firstVisible),
+                              min(lastLine, lastVisible), INT_MAX);
+        nLines += cache->rows(firstLine + 1, lastLine);
+      }
+      // third segment, the start of the line containing endPos
+      wrapped_line_counter(buf, buf->position_of_line(lastLine), endPos, INT_MAX,
+                           true, 0, &retPos, &retLines, &retLineStart,
+                           &retLineEnd);
+      return nLines + retLines;
     }
-    return nLines;
-  } else {
-    // Precise line counting only for small text buffer sizes:
-    wrapped_line_counter(buffer(), startPos, endPos, INT_MAX,
-                         startPosIsLineStart, 0, &retPos, &retLines, &retLineStart,
-                         &retLineEnd);
+  }
+
+  // Precise line counting for small text buffer sizes and within a line:
+  wrapped_line_counter(buffer(), startPos, endPos, INT_MAX,
+                       startPosIsLineStart, 0, &retPos, &retLines, &retLineStart,
+                       &retLineEnd);
 
 #ifdef DEBUG
-    printf("   # after WLC: retPos=%d, retLines=%d, retLineStart=%d, retLineEnd=%d\n",
-           retPos, retLines, retLineStart, retLineEnd);
+  printf("   # after WLC: retPos=%d, retLines=%d, retLineStart=%d, retLineEnd=%d\n",
+         retPos, retLines, retLineStart, retLineEnd);
 #endif // DEBUG
-    return retLines;
+  return retLines;
+}
+
+
+
+/*
+ Return the wrap cache if it is used, i.e. for large buffers in continuous
+ wrap mode. The cache is rebuilt with estimated row counts if the wrap
+ margin, the fonts, or the number of lines have changed, and the remaining
+ estimates are scheduled to be measured in idle time.
+ */
+Fl_Text_Wrap_Cache *Fl_Text_Display::wrap_cache() const {
+  Fl_Text_Buffer *buf = mBuffer;
+  if (!mContinuousWrap || !buf || buf->length() <= 16384)
+    return 0;
+  Fl_Text_Wrap_Cache *cache = mWrapCache;
+  int margin = mWrapMarginPix ? mWrapMarginPix : text_area.w;
+  int nLines = buf->line_of_position(buf->length()) + 1;
+  if (cache->lines() != nLines ||
+      !cache->matches(margin, textfont(), textsize(), buf->tab_distance(), mStyleTable)) {
+    cache->reset(margin, textfont(), textsize(), buf->tab_distance(), mStyleTable);
+    int charsPerRow = wrap_chars_per_row();
+    for (int pos = 0;;) {
+      int end = buf->line_end(pos);
+      cache->append(1 + (end - pos) / charsPerRow, false);
+      if (end >= buf->length()) break;
+      pos = end + 1;
+    }
+  }
+  if (cache->estimated() && !Fl::has_idle(wrap_cache_idle_cb, (void *)this))
+    Fl::add_idle(wrap_cache_idle_cb, (void *)this);
+  return cache;
+}
+
+/*
+ Return the average number of characters in a wrapped row.
+ */
+int Fl_Text_Display::wrap_chars_per_row() const {
+  if (mColumnScale == 0.0) x_to_col(1.0);
+  int width = mWrapMarginPix ? mWrapMarginPix : text_area.w;
+  return (int)(width / mColumnScale) + 1;
+}
+
+/*
+ Return the number of rows needed to display the line that starts at
+ \p lineStart.
+ */
+int Fl_Text_Display::wrapped_rows(int lineStart) const {
+  int retLines, retPos, retLineStart, retLineEnd;
+  wrapped_line_counter(mBuffer, lineStart, mBuffer->line_end(lineStart), INT_MAX,
+                       true, 0, &retPos, &retLines, &retLineStart, &retLineEnd,
+                       false);
+  return retLines + 1;
+}
+
+/*
+ Measure the rows of the lines from \p first to \p last - 1 that only have
+ estimated rows in the wrap cache, until at least \p maxBytes of text were
+ measured. Return the number of bytes measured.
+ */
+int Fl_Text_Display::measure_wrapped_lines(int first, int last, int maxBytes) const {
+  Fl_Text_Wrap_Cache *cache = mWrapCache;
+  int bytes = 0;
+  for (int line = cache->next_estimated(first);
+       line >= 0 && line < last && bytes < maxBytes;
+       line = cache->next_estimated(line + 1)) {
+    int pos = mBuffer->position_of_line(line);
+    cache->set(line, wrapped_rows(pos), true);
+    bytes += mBuffer->line_end(pos) - pos + 1;
+  }
+  return bytes;
+}
+
+/*
+ Update the wrap cache after a buffer modification. Lines that were removed
+ are removed from the cache, and the lines that were inserted or changed get
+ estimated row counts, to be measured when they are displayed or in idle time.
+ */
+void Fl_Text_Display::update_wrap_cache(int pos, int nInserted, int nDeleted,
+                                        int nRestyled, const char *deletedText) {
+  Fl_Text_Wrap_Cache *cache = mWrapCache;
+  if (!cache->lines())
+    return;
+  if (!mContinuousWrap || (nDeleted && !deletedText)) {
+    cache->clear();
+    return;
+  }
+  Fl_Text_Buffer *buf = mBuffer;
+  int line = buf->line_of_position(pos);
+  int linesDeleted = nDeleted ? countlines(deletedText) : 0;
+  int linesInserted = nInserted ? buf->count_lines(pos, pos + nInserted) : 0;
+  if (cache->lines() - linesDeleted + linesInserted
+      != buf->line_of_position(buf->length()) + 1) {
+    cache->clear();
+    return;
+  }
+  cache->remove(line + 1, linesDeleted);
+  cache->insert(line + 1, linesInserted);
+  int last = line + linesInserted;
+  if (nRestyled > nInserted)
+    last = buf->line_of_position(pos + nRestyled);
+  int charsPerRow = wrap_chars_per_row();
+  for (int p = buf->position_of_line(line); line <= last; line++) {
+    int end = buf->line_end(p);
+    cache->set(line, 1 + (end - p) / charsPerRow, false);
+    p = end + 1;
+  }
+}
+
+/*
+ Measure the wrapped lines of a large buffer in idle time, the visible lines
+ first, and update the vertical scrollbar as the row count converges.
+ */
+void Fl_Text_Display::wrap_cache_idle_cb(void *data) {
+  Fl_Text_Display *d = (Fl_Text_Display *)data;
+  Fl_Text_Wrap_Cache *cache = d->visible_r() ? d->wrap_cache() : 0;
+  if (!cache || !cache->estimated()) {
+    Fl::remove_idle(wrap_cache_idle_cb, data);
+    return;
   }
+  Fl_Text_Buffer *buf = d->mBuffer;
+  d->measure_wrapped_lines(buf->line_of_position(d->mFirstChar),
+                           buf->line_of_position(d->mLastChar) + 1, INT_MAX);
+  d->measure_wrapped_lines(0, cache->lines(), 64 * 1024);
+
+  int topLineNum = d->count_lines(0, d->mFirstChar, true) + 1;
+  if (d->mTopLineNumHint == d->mTopLineNum)
+    d->mTopLineNumHint = topLineNum;
+  d->mTopLineNum = topLineNum;
+  d->mNBufferLines = d->count_lines(0, buf->length(), true);
+  d->update_v_scrollbar();
+  if (!cache->estimated())
+    Fl::remove_idle(wrap_cache_idle_cb, data);
 }
 
 
@@ -1771,6 +1902,9 @@ void Fl_Text_Display::buffer_modified_cb( int pos, int nInserted, int nDeleted,
   if ( nInserted != 0 || nDeleted != 0 )
     textD->mCursorPreferredXPos = -1;
 
+  /* Keep the wrapped row counts in step with the lines of the buffer */
+  textD->update_wrap_cache(pos, nInserted, nDeleted, nRestyled, deletedText);
+
   /* Count the number of lines inserted and deleted, and in the case
    of continuous wrap mode, how much has changed */
   if (textD->mContinuousWrap) {
@@ -2258,13 +2392,24 @@ int Fl_Text_Display::find_x(const char *s, int len, int style, int x) const {
   int cursor_pos = x<0; // STR #2788
   x = x<0 ? -x : x;     // STR #2788
 
-  // TODO: use binary search which may be quicker.
+  // If the string width is the sum of the character widths, add them up
+  // instead of measuring every prefix of the string
+  Fl_Font font;
+  Fl_Fontsize fsize;
+  style_font(style, &font, &fsize);
+  bool additive = mWidthCache->additive(font, fsize);
+  double sum = 0;
+
   int i = 0;
   int last_w = 0;       // STR #2788
   while (i<len) {
     const char *next = fl_utf8_next_composed_char(s + i, s + len);
     int cl = next - (s+i);
-    int w = int( string_width(s, i+cl, style) );
+    int w;
+    if (additive)
+      w = int( sum += string_width(s+i, cl, style) );
+    else
+      w = int( string_width(s, i+cl, style) );
     if (w>x) {
       if (cursor_pos && (w-x < x-last_w)) return i+cl; // STR #2788
       return i;
@@ -2707,9 +2852,33 @@ int Fl_Text_Display::position_style( int lineStartPos, int lineLen, int lineInde
 }
 
 
+/**
+ \brief Find the font and font size of a particular style.
+
+ \param style index into style table
+ \param[out] font, size font and size used to draw text in this style
+ */
+void Fl_Text_Display::style_font( int style, Fl_Font *font, Fl_Fontsize *size ) const {
+  if ( mNStyles && (style & STYLE_LOOKUP_MASK) ) {
+    int si = (style & STYLE_LOOKUP_MASK) - 'A';
+    if (si < 0) si = 0;
+    else if (si >= mNStyles) si = mNStyles - 1;
+
+    *font = mStyleTable[si].font;
+    *size = mStyleTable[si].size;
+  } else {
+    *font = textfont();
+    *size = textsize();
+  }
+}
+
+
 /**
  \brief Find the width of a string in the font of a particular style.
 
+ Character widths are cached per font and size, so that measuring the same
+ characters again does not query the font system.
+
  \param string the text
  \param length number of bytes in string
  \param style index into style table
@@ -2720,20 +2889,8 @@ double Fl_Text_Display::string_width( const char *string, int length, int style
 
   Fl_Font font;
   Fl_Fontsize fsize;
-
-  if ( mNStyles && (style & STYLE_LOOKUP_MASK) ) {
-    int si = (style & STYLE_LOOKUP_MASK) - 'A';
-    if (si < 0) si = 0;
-    else if (si >= mNStyles) si = mNStyles - 1;
-
-    font  = mStyleTable[si].font;
-    fsize = mStyleTable[si].size;
-  } else {
-    font  = textfont();
-    fsize = textsize();
-  }
-  fl_font( font, fsize );
-  return fl_width( string, length );
+  style_font(style, &font, &fsize);
+  return mWidthCache->width(font, fsize, string, length);
 }
 
 
@@ -2841,7 +2998,16 @@ void Fl_Text_Display::offset_line_starts( int newTopLineNum ) {
    known line start (start or end of buffer, or the closest value in the
    lineStarts array) */
   lastLineNum = oldTopLineNum + nVisLines - 1;
-  if ( newTopLineNum < oldTopLineNum && newTopLineNum < -lineDelta ) {
+  Fl_Text_Wrap_Cache *cache = (lineDelta > nVisLines || -lineDelta > nVisLines) ?
+                              wrap_cache() : 0;
+  if ( cache ) {
+    /* far jump in a large wrapped buffer, find the line in the wrap cache
+     and measure only this line */
+    int rowInLine, line = cache->find_row(newTopLineNum - 1, &rowInLine);
+    measure_wrapped_lines(line, line + 1, INT_MAX);
+    line = cache->find_row(newTopLineNum - 1, &rowInLine);
+    mFirstChar = skip_lines( buf->position_of_line(line), rowInLine, true );
+  } else if ( newTopLineNum < oldTopLineNum && newTopLineNum < -lineDelta ) {
     mFirstChar = skip_lines( 0, newTopLineNum - 1, true );
   } else if ( newTopLineNum < oldTopLineNum ) {
     mFirstChar = rewind_lines( mFirstChar, -lineDelta );
@@ -3100,6 +3266,11 @@ int Fl_Text_Display::scroll_(int topLineNum, int horizOffset) {
   if (mHorizOffset == horizOffset && mTopLineNum == topLineNum)
     return 0;
 
+  /* Remember how far the text moves, so that draw() can move the text
+   that stays visible instead of drawing all of it again */
+  mScrollDX += mHorizOffset - horizOffset;
+  mScrollDY += (mTopLineNum - topLineNum) * mMaxsize;
+
   /* If the vertical scroll position has changed, update the line
    starts array and related counters in the text display */
   offset_line_starts(topLineNum);
@@ -3107,8 +3278,8 @@ int Fl_Text_Display::scroll_(int topLineNum, int horizOffset) {
   /* Just setting mHorizOffset is enough information for redisplay */
   mHorizOffset = horizOffset;
 
-  // redraw all text
-  damage(FL_DAMAGE_EXPOSE);
+  // move the text and draw the newly exposed parts
+  damage(FL_DAMAGE_SCROLL);
   return 1;
 }
 
@@ -3985,6 +4156,25 @@ void Fl_Text_Display::draw(void) {
   update_child(*mVScrollBar);
   update_child(*mHScrollBar);
 
+  // The text was scrolled: move the text that is still visible and draw
+  // the exposed area only, unless the scaling factor is fractional and
+  // moving pixels would not be exact
+  if ((mScrollDX || mScrollDY) && !(damage() & (FL_DAMAGE_ALL | FL_DAMAGE_EXPOSE))) {
+    float scale = Fl_Surface_Device::surface()->driver()->scale();
+    if (Fl_Surface_Device::surface() == Fl_Display_Device::display_device() &&
+        Fl_Window::current() && scale == int(scale)) {
+      fl_scroll(text_area.x, text_area.y, text_area.w, text_area.h,
+                mScrollDX, mScrollDY, draw_scrolled_area_cb, this);
+      // the old text cursor was moved along with the text
+      fl_push_clip(text_area.x, text_area.y, text_area.w, text_area.h);
+      draw_text(text_area.x, mCursorOldY + mScrollDY, text_area.w, mMaxsize);
+      fl_pop_clip();
+    } else {
+      clear_damage((uchar)(damage() | FL_DAMAGE_EXPOSE));
+    }
+  }
+  mScrollDX = mScrollDY = 0;
+
   // draw all of the text
   if (damage() & (FL_DAMAGE_ALL | FL_DAMAGE_EXPOSE)) {
     //printf("drawing all text\n");
@@ -3999,7 +4189,7 @@ void Fl_Text_Display::draw(void) {
       draw_text(text_area.x, text_area.y, text_area.w, text_area.h);
     }
   }
-  else if (damage() & FL_DAMAGE_SCROLL) {
+  else if ((damage() & FL_DAMAGE_SCROLL) && damage_range1_end != -1) {
     // draw some lines of text
     fl_push_clip(text_area.x, text_area.y,
                  text_area.w, text_area.h);
@@ -4044,6 +4234,13 @@ void Fl_Text_Display::draw(void) {
   fl_pop_clip();
 }
 
+/*
+ Draw the text in an area that was exposed by fl_scroll().
+ */
+void Fl_Text_Display::draw_scrolled_area_cb(void *data, int X, int Y, int W, int H) {
+  ((Fl_Text_Display *)data)->draw_text(X, Y, W, H);
+}
+
 // GitHub Issue #196: internal selection and visible selection can run out of
 // sync, giving the user unexpected keyboard selection. The code block below
 // captures that and fixes it.
@@ -0,0 +1,399 @@
+//
+// Piece table text storage for the Fast Light Tool Kit (FLTK).
+//
+// Copyright 2001-2026 by Bill Spitzak and others.
+//
+// This library is free software. Distribution and use rights are outlined in
+// the file "COPYING" which should have been included with this file.  If this
+// file is missing or damaged, see the license at:
+//
+//     https://www.fltk.org/COPYING.php
+//
+// Please see the following page on how to report bugs and issues:
+//
+//     https://www.fltk.org/bugs.php
+//
+
+#include "Fl_Text_Piece_Table.H"
+#include "Fl_System_Driver.H"
+#include "fl_text_scan.h"
+#include <FL/Fl.H>
+
+#include <stdlib.h>
+#include <string.h>
+
+// Minimum size of a chunk of memory that stores inserted text
+static const int chunk_size = 64 * 1024;
+
+// Count the newline characters in a run of bytes
+static inline int count_nl(const char *p, int len) {
+  return fl_text_count_byte(p, len, '\n');
+}
+
+Fl_Text_Piece_Table::Fl_Text_Piece_Table()
+: root_(NULL),
+  add_(NULL),
+  add_free_(0),
+  seed_(2463534242U)
+{ }
+
+Fl_Text_Piece_Table::~Fl_Text_Piece_Table() {
+  clear();
+}
+
+/*
+ Remove all pieces and release all text chunks.
+ */
+void Fl_Text_Piece_Table::clear() {
+  free_tree_(root_);
+  root_ = NULL;
+  for (size_t i = 0; i < chunks_.size(); i++)
+    ::free(chunks_[i]);
+  chunks_.clear();
+  for (size_t i = 0; i < maps_.size(); i++)
+    Fl::system_driver()->unmap_file((void *)maps_[i].addr, maps_[i].size);
+  maps_.clear();
+  add_ = NULL;
+  add_free_ = 0;
+}
+
+void Fl_Text_Piece_Table::add_mapping(void *addr, size_t size) {
+  Mapping m = { (const char *)addr, size };
+  maps_.push_back(m);
+}
+
+/*
+ Copy the text of all pieces that point into mapped files into the text
+ chunks, then unmap the files. Needed before a mapped file is overwritten.
+ */
+void Fl_Text_Piece_Table::release_mappings() {
+  if (maps_.empty())
+    return;
+  unmap_(root_);
+  for (size_t i = 0; i < maps_.size(); i++)
+    Fl::system_driver()->unmap_file((void *)maps_[i].addr, maps_[i].size);
+  maps_.clear();
+}
+
+void Fl_Text_Piece_Table::unmap_(Node *n) {
+  if (!n) return;
+  unmap_(n->left);
+  if (is_mapped_(n->text, n->len))
+    n->text = store_(n->text, n->len);
+  unmap_(n->right);
+}
+
+/*
+ Return true if the text is in a mapped file, so that pieces can point
+ directly into the mapped memory.
+ */
+bool Fl_Text_Piece_Table::is_mapped_(const char *text, int len) const {
+  for (size_t i = 0; i < maps_.size(); i++)
+    if (text >= maps_[i].addr && text + len <= maps_[i].addr + maps_[i].size)
+      return true;
+  return false;
+}
+
+/*
+ Simple xorshift generator for node priorities.
+ */
+unsigned Fl_Text_Piece_Table::random_() {
+  seed_ ^= seed_ << 13;
+  seed_ ^= seed_ >> 17;
+  seed_ ^= seed_ << 5;
+  return seed_;
+}
+
+Fl_Text_Piece_Table::Node *Fl_Text_Piece_Table::new_node_(const char *text, int len, int nl) {
+  Node *n = new Node;
+  n->text = text;
+  n->len = n->sub_len = len;
+  n->nl = n->sub_nl = nl;
+  n->prio = random_();
+  n->left = n->right = NULL;
+  return n;
+}
+
+/*
+ Recalculate the cached subtree sums of a node from its children.
+ */
+void Fl_Text_Piece_Table::update_(Node *n) {
+  n->sub_len = n->len;
+  n->sub_nl = n->nl;
+  if (n->left) {
+    n->sub_len += n->left->sub_len;
+    n->sub_nl += n->left->sub_nl;
+  }
+  if (n->right) {
+    n->sub_len += n->right->sub_len;
+    n->sub_nl += n->right->sub_nl;
+  }
+}
+
+void Fl_Text_Piece_Table::free_tree_(Node *n) {
+  if (!n) return;
+  free_tree_(n->left);
+  free_tree_(n->right);
+  delete n;
+}
+
+/*
+ Split the tree \p n into a tree with the first \p pos bytes and a tree with
+ the remaining bytes. A piece that contains \p pos is cut in two.
+ */
+void Fl_Text_Piece_Table::split_(Node *n, int pos, Node *&l, Node *&r) {
+  if (!n) {
+    l = r = NULL;
+    return;
+  }
+  int ll = n->left ? n->left->sub_len : 0;
+  if (pos <= ll) {
+    split_(n->left, pos, l, n->left);
+    r = n;
+  } else if (pos >= ll + n->len) {
+    split_(n->right, pos - ll - n->len, n->right, r);
+    l = n;
+  } else {
+    // cut this piece, the new right half inherits the priority so that
+    // it can adopt the right subtree without violating the heap order
+    int k = pos - ll;
+    Node *m = new_node_(n->text + k, n->len - k, 0);
+    m->nl = count_nl(m->text, m->len);
+    m->prio = n->prio;
+    m->right = n->right;
+    n->right = NULL;
+    n->len = k;
+    n->nl -= m->nl;
+    update_(m);
+    l = n;
+    r = m;
+  }
+  update_(n);
+}
+
+/*
+ Concatenate two trees, all bytes in \p l precede all bytes in \p r.
+ */
+Fl_Text_Piece_Table::Node *Fl_Text_Piece_Table::merge_(Node *l, Node *r) {
+  if (!l) return r;
+  if (!r) return l;
+  if (l->prio > r->prio) {
+    l->right = merge_(l->right, r);
+    update_(l);
+    return l;
+  }
+  r->left = merge_(l, r->left);
+  update_(r);
+  return r;
+}
+
+/*
+ Try to grow the piece that ends at \p pos by \p len bytes. This succeeds
+ only if the piece ends exactly at \p end, the current end of the insertion
+ chunk, which is the common case when the user types sequential characters.
+ */
+bool Fl_Text_Piece_Table::extend_(Node *n, int pos, const char *end, int len, int nl) {
+  if (!n) return false;
+  int ll = n->left ? n->left->sub_len : 0;
+  bool ok;
+  if (pos <= ll) {
+    ok = extend_(n->left, pos, end, len, nl);
+  } else if (pos <= ll + n->len) {
+    if (pos != ll + n->len || n->text + n->len != end || n->len + len > max_piece)
+      return false;
+    n->len += len;
+    n->nl += nl;
+    ok = true;
+  } else {
+    ok = extend_(n->right, pos - ll - n->len, end, len, nl);
+  }
+  if (ok) {
+    n->sub_len += len;
+    n->sub_nl += nl;
+  }
+  return ok;
+}
+
+/*
+ Copy text into the current chunk, allocating a new chunk if needed.
+ */
+const char *Fl_Text_Piece_Table::store_(const char *text, int len) {
+  if (len > add_free_) {
+    int size = len > chunk_size ? len : chunk_size;
+    add_ = (char *)malloc(size);
+    add_free_ = size;
+    chunks_.push_back(add_);
+  }
+  char *dst = add_;
+  memcpy(dst, text, len);
+  add_ += len;
+  add_free_ -= len;
+  return dst;
+}
+
+/*
+ Return a pointer to the byte at \p pos. If \p seglen is not NULL, it
+ receives the number of bytes that can be read contiguously from there.
+ For \p pos at or beyond the end of the text, an empty string is returned.
+ */
+const char *Fl_Text_Piece_Table::segment(int pos, int *seglen) const {
+  Node *n = root_;
+  while (n) {
+    int ll = n->left ? n->left->sub_len : 0;
+    if (pos < ll) {
+      n = n->left;
+    } else if (pos < ll + n->len) {
+      pos -= ll;
+      if (seglen) *seglen = n->len - pos;
+      return n->text + pos;
+    } else {
+      pos -= ll + n->len;
+      n = n->right;
+    }
+  }
+  if (seglen) *seglen = 0;
+  return "";
+}
+
+/*
+ Return a pointer to the first byte of the contiguous run of bytes that ends
+ at \p pos, and the length of this run in \p seglen.
+ */
+const char *Fl_Text_Piece_Table::segment_before(int pos, int *seglen) const {
+  Node *n = root_;
+  pos--;
+  while (n && pos >= 0) {
+    int ll = n->left ? n->left->sub_len : 0;
+    if (pos < ll) {
+      n = n->left;
+    } else if (pos < ll + n->len) {
+      *seglen = pos - ll + 1;
+      return n->text;
+    } else {
+      pos -= ll + n->len;
+      n = n->right;
+    }
+  }
+  *seglen = 0;
+  return "";
+}
+
+void Fl_Text_Piece_Table::copy_out(int start, int end, char *dst) const {
+  while (start < end) {
+    int seglen;
+    const char *src = segment(start, &seglen);
+    if (seglen <= 0) break;
+    if (seglen > end - start) seglen = end - start;
+    memcpy(dst, src, seglen);
+    dst += seglen;
+    start += seglen;
+  }
+}
+
+void Fl_Text_Piece_Table::insert(int pos, const char *text, int len) {
+  if (len <= 0)
+    return;
+  if (pos < 0) pos = 0;
+  if (pos > length()) pos = length();
+
+  bool mapped = is_mapped_(text, len);
+
+  // fast path: append to the piece that was inserted most recently
+  if (!mapped && pos > 0 && len <= add_free_) {
+    int nl = count_nl(text, len);
+    if (extend_(root_, pos, add_, len, nl)) {
+      memcpy(add_, text, len);
+      add_ += len;
+      add_free_ -= len;
+      return;
+    }
+  }
+
+  // build a subtree of pieces of at most max_piece bytes each, cut at
+  // UTF-8 character boundaries
+  const char *s = mapped ? text : store_(text, len);
+  Node *mid = NULL;
+  int off = 0;
+  while (off < len) {
+    int end = off + max_piece;
+    if (end >= len) {
+      end = len;
+    } else {
+      while (end > off + 1 && (s[end] & 0xC0) == 0x80)
+        end--;
+    }
+    mid = merge_(mid, new_node_(s + off, end - off, count_nl(s + off, end - off)));
+    off = end;
+  }
+
+  Node *l, *r;
+  split_(root_, pos, l, r);
+  root_ = merge_(merge_(l, mid), r);
+}
+
+void Fl_Text_Piece_Table::remove(int start, int end) {
+  if (start < 0) start = 0;
+  if (end > length()) end = length();
+  if (start >= end)
+    return;
+  Node *l, *m, *r;
+  split_(root_, start, l, r);
+  split_(r, end - start, m, r);
+  free_tree_(m);
+  root_ = merge_(l, r);
+}
+
+/*
+ Count the newlines in the bytes before \p pos.
+ */
+int Fl_Text_Piece_Table::count_newlines(int pos) const {
+  int count = 0;
+  Node *n = root_;
+  while (n) {
+    int ll = n->left ? n->left->sub_len : 0;
+    if (pos < ll) {
+      n = n->left;
+      continue;
+    }
+    if (n->left) count += n->left->sub_nl;
+    pos -= ll;
+    if (pos < n->len)
+      return count + count_nl(n->text, pos);
+    count += n->nl;
+    pos -= n->len;
+    n = n->right;
+  }
+  return count;
+}
+
+/*
+ Return the byte offset of the newline with the 0-based \p index.
+ */
+int Fl_Text_Piece_Table::newline_position(int index) const {
+  if (index < 0 || index >= newlines())
+    return -1;
+  int base = 0;
+  Node *n = root_;
+  while (n) {
+    int lnl = n->left ? n->left->sub_nl : 0;
+    if (index < lnl) {
+      n = n->left;
+      continue;
+    }
+    index -= lnl;
+    base += n->left ? n->left->sub_len : 0;
+    if (index < n->nl) {
+      const char *p = n->text;
+      for (;;) {
+        p = (const char *)memchr(p, '\n', n->text + n->len - p);
+        if (index-- == 0)
+          return base + (int)(p - n->text);
+        p++;
+      }
+    }
+    index -= n->nl;
+    base += n->len;
+    n = n->right;
+  }
+  return -1;
+}
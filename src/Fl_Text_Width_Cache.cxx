@@ -0,0 +1,125 @@
+//
+// Character width cache for the Fast Light Tool Kit (FLTK).
+//
+// Copyright 2001-2026 by Bill Spitzak and others.
+//
+// This library is free software. Distribution and use rights are outlined in
+// the file "COPYING" which should have been included with this file.  If this
+// file is missing or damaged, see the license at:
+//
+//     https://www.fltk.org/COPYING.php
+//
+// Please see the following page on how to report bugs and issues:
+//
+//     https://www.fltk.org/bugs.php
+//
+
+#include "Fl_Text_Width_Cache.H"
+#include "fl_text_scan.h"
+#include <FL/Fl_Device.H>
+#include <FL/fl_draw.H>
+#include <FL/fl_utf8.h>
+
+#include <math.h>
+
+// A string that is measured differently if the platform applies kerning
+static const char kerning_sample[] = "AVAWAYTaToVaWaYo";
+
+Fl_Text_Width_Cache::Fl_Text_Width_Cache()
+: last_(0L),
+  surface_(0L),
+  scale_(0)
+{ }
+
+Fl_Text_Width_Cache::~Fl_Text_Width_Cache() {
+  clear();
+}
+
+void Fl_Text_Width_Cache::clear() {
+  for (size_t i = 0; i < fonts_.size(); i++)
+    delete fonts_[i];
+  fonts_.clear();
+  last_ = 0L;
+}
+
+/*
+ Return the widths of a font, measuring the printable ASCII characters if
+ the font was not used before.
+ */
+Fl_Text_Width_Cache::Font_Widths *Fl_Text_Width_Cache::find_(Fl_Font font, Fl_Fontsize size) {
+  Fl_Surface_Device *surface = Fl_Surface_Device::surface();
+  float scale = fl_graphics_driver->scale();
+  if (surface != surface_ || scale != scale_) {
+    clear();
+    surface_ = surface;
+    scale_ = scale;
+  }
+  if (last_ && last_->font == font && last_->size == size)
+    return last_;
+  for (size_t i = 0; i < fonts_.size(); i++) {
+    if (fonts_[i]->font == font && fonts_[i]->size == size)
+      return last_ = fonts_[i];
+  }
+
+  Font_Widths *f = new Font_Widths;
+  f->font = font;
+  f->size = size;
+  fl_font(font, size);
+  bool mono = true;
+  for (int c = 0; c < 128; c++) {
+    if (c < ' ' || c > '~') {
+      f->ascii[c] = -1.0;
+      continue;
+    }
+    char s = (char)c;
+    f->ascii[c] = fl_width(&s, 1);
+    if (f->ascii[c] != f->ascii[' '])
+      mono = false;
+  }
+  f->mono = mono ? f->ascii[' '] : 0.0;
+  double sum = 0.0;
+  for (const char *p = kerning_sample; *p; p++)
+    sum += f->ascii[(unsigned char)*p];
+  f->additive = fabs(fl_width(kerning_sample) - sum) < 0.01;
+  fonts_.push_back(f);
+  return last_ = f;
+}
+
+double Fl_Text_Width_Cache::width(Fl_Font font, Fl_Fontsize size, const char *s, int len) {
+  if (len <= 0)
+    return 0.0;
+  Font_Widths *f = find_(font, size);
+  bool font_set = false;
+  if (!f->additive && len > fl_utf8len1(*s)) {
+    fl_font(font, size);
+    return fl_width(s, len);
+  }
+  if (f->mono && fl_text_ascii_prefix(s, len) == len)
+    return len * f->mono;
+
+  double w = 0.0;
+  const char *end = s + len;
+  while (s < end) {
+    unsigned char c = (unsigned char)*s;
+    if (c < 0x80) {
+      double &cw = f->ascii[c];
+      if (cw < 0.0) {
+        if (!font_set) { fl_font(font, size); font_set = true; }
+        cw = fl_width(s, 1);
+      }
+      w += cw;
+      s++;
+      continue;
+    }
+    int l;
+    unsigned u = fl_utf8decode(s, end, &l);
+    std::unordered_map<unsigned, double>::iterator it = f->other.find(u);
+    if (it == f->other.end()) {
+      if (!font_set) { fl_font(font, size); font_set = true; }
+      it = f->other.insert(std::make_pair(u, fl_width(s, l))).first;
+    }
+    w += it->second;
+    s += l;
+  }
+  return w;
+}
@@ -0,0 +1,354 @@
+//
+// Wrapped line cache for the Fast Light Tool Kit (FLTK).
+//
+// Copyright 2001-2026 by Bill Spitzak and others.
+//
+// This library is free software. Distribution and use rights are outlined in
+// the file "COPYING" which should have been included with this file.  If this
+// file is missing or damaged, see the license at:
+//
+//     https://www.fltk.org/COPYING.php
+//
+// Please see the following page on how to report bugs and issues:
+//
+//     https://www.fltk.org/bugs.php
+//
+
+#include "Fl_Text_Wrap_Cache.H"
+
+#include <string.h>
+
+Fl_Text_Wrap_Cache::Fl_Text_Wrap_Cache()
+: lines_(0),
+  rows_(0),
+  estimated_(0),
+  hint_block_(0),
+  hint_line_(0),
+  hint_row_(0),
+  margin_(-1),
+  font_(-1),
+  size_(-1),
+  tab_(-1),
+  styles_(0L)
+{ }
+
+Fl_Text_Wrap_Cache::~Fl_Text_Wrap_Cache() {
+  clear();
+}
+
+void Fl_Text_Wrap_Cache::clear() {
+  for (size_t i = 0; i < blocks_.size(); i++)
+    delete blocks_[i];
+  blocks_.clear();
+  lines_ = rows_ = estimated_ = 0;
+  hint_block_ = hint_line_ = hint_row_ = 0;
+}
+
+void Fl_Text_Wrap_Cache::reset(int margin, int font, int size, int tab, const void *styles) {
+  clear();
+  margin_ = margin;
+  font_ = font;
+  size_ = size;
+  tab_ = tab;
+  styles_ = styles;
+}
+
+/*
+ Return the index of the block that contains \p line and make it the hint
+ block. The search starts at the previous hint, so that sequential access
+ only visits neighbouring blocks. A line beyond the end is in the last block.
+ */
+int Fl_Text_Wrap_Cache::find_block_(int line) const {
+  int nb = (int)blocks_.size();
+  if (!nb)
+    return -1;
+  int b = hint_block_, start = hint_line_, row = hint_row_;
+  if (b >= nb) {
+    b = start = row = 0;
+  }
+  while (b > 0 && line < start) {
+    b--;
+    start -= blocks_[b]->n;
+    row -= blocks_[b]->rows;
+  }
+  while (b < nb - 1 && line >= start + blocks_[b]->n) {
+    start += blocks_[b]->n;
+    row += blocks_[b]->rows;
+    b++;
+  }
+  hint_block_ = b;
+  hint_line_ = start;
+  hint_row_ = row;
+  return b;
+}
+
+/*
+ Move the lines from index \p k of block \p b into a new block after it.
+ */
+void Fl_Text_Wrap_Cache::split_(int b, int k) {
+  Block *bl = blocks_[b];
+  Block *nb = new Block;
+  nb->n = bl->n - k;
+  nb->rows = nb->estimated = 0;
+  for (int i = 0; i < nb->n; i++) {
+    int v = bl->v[k + i];
+    nb->v[i] = v;
+    if (v < 0) {
+      nb->rows -= v;
+      nb->estimated++;
+    } else {
+      nb->rows += v;
+    }
+  }
+  bl->n = k;
+  bl->rows -= nb->rows;
+  bl->estimated -= nb->estimated;
+  blocks_.insert(blocks_.begin() + b + 1, nb);
+}
+
+/*
+ Merge block \p b + 1 into block \p b if both fit into one block.
+ */
+void Fl_Text_Wrap_Cache::merge_(int b) {
+  if (b < 0 || b + 1 >= (int)blocks_.size())
+    return;
+  Block *bl = blocks_[b], *next = blocks_[b + 1];
+  if (bl->n + next->n > block_size)
+    return;
+  memcpy(bl->v + bl->n, next->v, next->n * sizeof(int));
+  bl->n += next->n;
+  bl->rows += next->rows;
+  bl->estimated += next->estimated;
+  delete next;
+  blocks_.erase(blocks_.begin() + b + 1);
+}
+
+void Fl_Text_Wrap_Cache::append(int rows, bool exact) {
+  if (rows < 1) rows = 1;
+  if (blocks_.empty() || blocks_.back()->n == block_size) {
+    Block *bl = new Block;
+    bl->n = bl->rows = bl->estimated = 0;
+    blocks_.push_back(bl);
+  }
+  Block *bl = blocks_.back();
+  bl->v[bl->n++] = exact ? rows : -rows;
+  bl->rows += rows;
+  rows_ += rows;
+  lines_++;
+  if (!exact) {
+    bl->estimated++;
+    estimated_++;
+  }
+}
+
+void Fl_Text_Wrap_Cache::insert(int line, int n) {
+  if (n <= 0)
+    return;
+  if (line < 0) line = 0;
+  if (line > lines_) line = lines_;
+  if (blocks_.empty()) {
+    for (int i = 0; i < n; i++)
+      append(1, false);
+    return;
+  }
+
+  int b, k;
+  if (line == lines_) {
+    b = (int)blocks_.size() - 1;
+    k = blocks_[b]->n;
+  } else {
+    b = find_block_(line);
+    k = line - hint_line_;
+  }
+  Block *bl = blocks_[b];
+
+  if (bl->n + n <= block_size) {
+    // the common case: a few lines are inserted into a block with room
+    memmove(bl->v + k + n, bl->v + k, (bl->n - k) * sizeof(int));
+    for (int i = 0; i < n; i++)
+      bl->v[k + i] = -1;
+    bl->n += n;
+    bl->rows += n;
+    bl->estimated += n;
+  } else {
+    // cut the block at the insertion point, fill up its first half and
+    // add as many new blocks as needed after it
+    if (k < bl->n)
+      split_(b, k);
+    int left = n;
+    int room = block_size - bl->n;
+    if (room > left) room = left;
+    for (int i = 0; i < room; i++)
+      bl->v[bl->n + i] = -1;
+    bl->n += room;
+    bl->rows += room;
+    bl->estimated += room;
+    left -= room;
+    std::vector<Block*> added;
+    while (left > 0) {
+      Block *nb = new Block;
+      nb->n = nb->rows = nb->estimated = left < block_size ? left : (int)block_size;
+      for (int i = 0; i < nb->n; i++)
+        nb->v[i] = -1;
+      added.push_back(nb);
+      left -= nb->n;
+    }
+    blocks_.insert(blocks_.begin() + b + 1, added.begin(), added.end());
+  }
+  lines_ += n;
+  rows_ += n;
+  estimated_ += n;
+  hint_block_ = hint_line_ = hint_row_ = 0;
+}
+
+void Fl_Text_Wrap_Cache::remove(int line, int n) {
+  if (line < 0) {
+    n += line;
+    line = 0;
+  }
+  if (line + n > lines_)
+    n = lines_ - line;
+  if (n <= 0)
+    return;
+
+  int first = find_block_(line);
+  int b = first, k = line - hint_line_, left = n;
+  while (left > 0) {
+    Block *bl = blocks_[b];
+    int m = bl->n - k;
+    if (m > left) m = left;
+    if (m == bl->n) {
+      rows_ -= bl->rows;
+      estimated_ -= bl->estimated;
+      delete bl;
+      blocks_.erase(blocks_.begin() + b);
+    } else {
+      for (int i = k; i < k + m; i++) {
+        int v = bl->v[i];
+        if (v < 0) {
+          v = -v;
+          bl->estimated--;
+          estimated_--;
+        }
+        bl->rows -= v;
+        rows_ -= v;
+      }
+      memmove(bl->v + k, bl->v + k + m, (bl->n - k - m) * sizeof(int));
+      bl->n -= m;
+      b++;
+    }
+    left -= m;
+    k = 0;
+  }
+  lines_ -= n;
+
+  // keep the blocks from getting too small
+  merge_(first);
+  merge_(first - 1);
+  hint_block_ = hint_line_ = hint_row_ = 0;
+}
+
+void Fl_Text_Wrap_Cache::set(int line, int rows, bool exact) {
+  if (line < 0 || line >= lines_)
+    return;
+  if (rows < 1) rows = 1;
+  Block *bl = blocks_[find_block_(line)];
+  int &v = bl->v[line - hint_line_];
+  int old = v;
+  if (old < 0) {
+    old = -old;
+    bl->estimated--;
+    estimated_--;
+  }
+  if (!exact) {
+    bl->estimated++;
+    estimated_++;
+  }
+  bl->rows += rows - old;
+  rows_ += rows - old;
+  v = exact ? rows : -rows;
+}
+
+/*
+ Return the number of rows of all lines before \p line.
+ */
+int Fl_Text_Wrap_Cache::rows_before_(int line) const {
+  if (line <= 0)
+    return 0;
+  if (line >= lines_)
+    return rows_;
+  const Block *bl = blocks_[find_block_(line)];
+  int row = hint_row_;
+  for (int i = 0, k = line - hint_line_; i < k; i++)
+    row += bl->v[i] < 0 ? -bl->v[i] : bl->v[i];
+  return row;
+}
+
+int Fl_Text_Wrap_Cache::rows(int first, int last) const {
+  if (first >= last)
+    return 0;
+  return rows_before_(last) - rows_before_(first);
+}
+
+int Fl_Text_Wrap_Cache::next_estimated(int line) const {
+  if (line < 0) line = 0;
+  if (line >= lines_ || !estimated_)
+    return -1;
+  int nb = (int)blocks_.size();
+  int b = find_block_(line), k = line - hint_line_, start = hint_line_;
+  for (; b < nb; b++) {
+    const Block *bl = blocks_[b];
+    if (bl->estimated) {
+      for (int i = k; i < bl->n; i++)
+        if (bl->v[i] < 0)
+          return start + i;
+    }
+    start += bl->n;
+    k = 0;
+  }
+  return -1;
+}
+
+int Fl_Text_Wrap_Cache::find_row(int row, int *row_in_line) const {
+  *row_in_line = 0;
+  if (!lines_)
+    return 0;
+  if (row >= rows_) {
+    // past the end: the last row of the last line
+    const Block *bl = blocks_.back();
+    int v = bl->v[bl->n - 1];
+    *row_in_line = (v < 0 ? -v : v) - 1;
+    return lines_ - 1;
+  }
+  if (row < 0) row = 0;
+
+  int nb = (int)blocks_.size();
+  int b = hint_block_, start = hint_line_, first = hint_row_;
+  if (b >= nb) {
+    b = start = first = 0;
+  }
+  while (b > 0 && row < first) {
+    b--;
+    start -= blocks_[b]->n;
+    first -= blocks_[b]->rows;
+  }
+  while (b < nb - 1 && row >= first + blocks_[b]->rows) {
+    start += blocks_[b]->n;
+    first += blocks_[b]->rows;
+    b++;
+  }
+  hint_block_ = b;
+  hint_line_ = start;
+  hint_row_ = first;
+
+  const Block *bl = blocks_[b];
+  for (int i = 0; i < bl->n; i++) {
+    int v = bl->v[i] < 0 ? -bl->v[i] : bl->v[i];
+    if (row < first + v) {
+      *row_in_line = row - first;
+      return start + i;
+    }
+    first += v;
+  }
+  return lines_ - 1; // not reached
+}
@@ -2,7 +2,7 @@
 // Timeout support functions for the Fast Light Tool Kit (FLTK).
 //
 // Author: Albrecht Schlosser
-// Copyright 2021-2024 by Bill Spitzak and others.
+// Copyright 2021-2026 by Bill Spitzak and others.
 //
 // This library is free software. Distribution and use rights are outlined in
 // the file "COPYING" which should have been included with this file.  If this
@@ -22,6 +22,7 @@
 
 #include <stdio.h>
 #include <math.h> // for trunc()
+#include <algorithm> // for std::sort()
 
 #if !HAVE_TRUNC
 static inline double trunc(double x) { return x >= 0 ? floor(x) : ceil(x); }
@@ -34,7 +35,12 @@ static inline double trunc(double x) { return x >= 0 ? floor(x) : ceil(x); }
 // static class variables
 
 Fl_Timeout *Fl_Timeout::free_timeout = 0;
-Fl_Timeout *Fl_Timeout::first_timeout = 0;
+std::vector<Fl_Timeout*> Fl_Timeout::active_timeouts;
+std::unordered_map<Fl_Timeout_Handler, Fl_Timeout::Data_Map> Fl_Timeout::timeout_map;
+double Fl_Timeout::timeout_clock = 0.0;
+int Fl_Timeout::slack_timeouts = 0;
+unsigned long Fl_Timeout::next_serial = 0;
+std::vector<int> Fl_Timeout::heap_todo;
 Fl_Timeout *Fl_Timeout::current_timeout = 0;
 
 #if FL_TIMEOUT_DEBUG
@@ -173,31 +179,105 @@ long Fl::ticks_between(Fl_Timestamp& back, Fl_Timestamp& further_back) {
 */
 static double elapsed_time() {
   static int first = 1;                 // initialization
-  static Fl_Timestamp prev;             // previous timestamp
-  Fl_Timestamp now = Fl::now();         // current timestamp
+  static double prev;                   // previous timestamp
+  double now = Fl::system_driver()->monotonic_time(); // current timestamp
   double elapsed = 0.0;
   if (first) {
     first = 0;
   } else {
-    elapsed = Fl::seconds_between(now, prev);
+    elapsed = now - prev;
   }
   prev = now;
   return elapsed;
 }
 
+/**
+  Move the timer at index \p i of the heap towards the root until its
+  parent expires before it.
+*/
+void Fl_Timeout::sift_up(int i) {
+  Fl_Timeout *t = active_timeouts[i];
+  while (i > 0) {
+    int parent = (i - 1) / 2;
+    Fl_Timeout *p = active_timeouts[parent];
+    if (!t->before(p))
+      break;
+    active_timeouts[i] = p;
+    p->pos = i;
+    i = parent;
+  }
+  active_timeouts[i] = t;
+  t->pos = i;
+}
+
+/**
+  Move the timer at index \p i of the heap towards the leaves until it
+  expires before its children.
+*/
+void Fl_Timeout::sift_down(int i) {
+  int n = (int)active_timeouts.size();
+  Fl_Timeout *t = active_timeouts[i];
+  for (;;) {
+    int child = 2 * i + 1;
+    if (child >= n)
+      break;
+    if (child + 1 < n && active_timeouts[child + 1]->before(active_timeouts[child]))
+      child++;
+    Fl_Timeout *c = active_timeouts[child];
+    if (!c->before(t))
+      break;
+    active_timeouts[i] = c;
+    c->pos = i;
+    i = child;
+  }
+  active_timeouts[i] = t;
+  t->pos = i;
+}
+
 /**
   Insert this timer entry into the active timer queue.
 
-  The timer is inserted at the required position so the timer queue
-  is always ordered by due time.
+  Timers with the same due time expire in the order of insertion.
 */
 void Fl_Timeout::insert() {
-  Fl_Timeout **p = (Fl_Timeout **)&first_timeout;
-  while (*p && (*p)->time <= time) {
-    p = (Fl_Timeout **)&((*p)->next);
+  serial = next_serial++;
+  if (slack > 0.0)
+    slack_timeouts++;
+  active_timeouts.push_back(this);
+  sift_up((int)active_timeouts.size() - 1);
+  timeout_map[callback].insert(std::make_pair(data, this));
+}
+
+/**
+  Remove this timer entry from the active timer queue.
+*/
+void Fl_Timeout::remove() {
+  // remove it from the heap
+  int i = pos;
+  Fl_Timeout *last = active_timeouts.back();
+  active_timeouts.pop_back();
+  if (last != this) {
+    active_timeouts[i] = last;
+    last->pos = i;
+    if (i > 0 && last->before(active_timeouts[(i - 1) / 2]))
+      sift_up(i);
+    else
+      sift_down(i);
   }
-  next = *p;
-  *p = this;
+  pos = -1;
+  if (slack > 0.0)
+    slack_timeouts--;
+  // remove it from the map
+  auto m = timeout_map.find(callback);
+  auto range = m->second.equal_range(data);
+  for (auto it = range.first; it != range.second; ++it) {
+    if (it->second == this) {
+      m->second.erase(it);
+      break;
+    }
+  }
+  if (m->second.empty())
+    timeout_map.erase(m);
 }
 
 /**
@@ -217,11 +297,10 @@ void Fl_Timeout::insert() {
   \see Fl::has_timeout(Fl_Timeout_Handler cb, void *data)
 */
 int Fl_Timeout::has_timeout(Fl_Timeout_Handler cb, void *data) {
-  for (Fl_Timeout *t = first_timeout; t; t = t->next) {
-    if (t->callback == cb && t->data == data)
-      return 1;
-  }
-  return 0;
+  auto m = timeout_map.find(cb);
+  if (m == timeout_map.end())
+    return 0;
+  return m->second.find(data) != m->second.end();
 }
 
 /**
@@ -266,13 +345,44 @@ void Fl_Timeout::repeat_timeout(double time, Fl_Timeout_Handler cb, void *data)
   Fl_Timeout *t = (Fl_Timeout *)get(time, cb, data);
   Fl_Timeout *cur = current_timeout;
   if (cur) {
-    t->time += cur->time;   // was: missed_timeout_by (always <= 0.0)
-    if (t->time < 0.0)
-      t->time = 0.001;      // at least 1 ms
+    double delay = time + cur->delay(); // cur->delay(): missed_timeout_by (always <= 0.0)
+    if (delay < 0.0)
+      delay = 0.001;        // at least 1 ms
+    t->delay(delay);
+    if (cur->callback == cb)
+      t->slack = cur->slack;
   }
   t->insert();
 }
 
+/**
+  Set the slack of matching active timeouts.
+
+  \param[in]  slack allowed delay in seconds after the expiration time
+  \param[in]  cb    Timer callback (must match)
+  \param[in]  data  Wildcard if NULL, must match otherwise
+
+  Implements:
+
+      void Fl::timeout_slack(double slack, Fl_Timeout_Handler cb, void *data)
+
+  \see Fl::timeout_slack(double slack, Fl_Timeout_Handler cb, void *data)
+*/
+void Fl_Timeout::timeout_slack(double slack, Fl_Timeout_Handler cb, void *data) {
+  if (slack < 0.0)
+    slack = 0.0;
+  auto m = timeout_map.find(cb);
+  if (m == timeout_map.end())
+    return;
+  auto range = data ? m->second.equal_range(data)
+                    : std::make_pair(m->second.begin(), m->second.end());
+  for (auto it = range.first; it != range.second; ++it) {
+    Fl_Timeout *t = it->second;
+    slack_timeouts += (slack > 0.0) - (t->slack > 0.0);
+    t->slack = slack;
+  }
+}
+
 /**
   Remove a timeout callback.
 
@@ -289,15 +399,17 @@ void Fl_Timeout::repeat_timeout(double time, Fl_Timeout_Handler cb, void *data)
   \see Fl::remove_timeout(Fl_Timeout_Handler cb, void *data)
 */
 void Fl_Timeout::remove_timeout(Fl_Timeout_Handler cb, void *data) {
-  for (Fl_Timeout** p = &first_timeout; *p;) {
-    Fl_Timeout* t = *p;
-    if (t->callback == cb && (t->data == data || !data)) {
-      *p = t->next;
-      t->next = free_timeout;
-      free_timeout = t;
-    } else {
-      p = &(t->next);
-    }
+  for (;;) {
+    auto m = timeout_map.find(cb);
+    if (m == timeout_map.end())
+      return;
+    auto it = data ? m->second.find(data) : m->second.begin();
+    if (it == m->second.end())
+      return;
+    Fl_Timeout *t = it->second;
+    t->remove();
+    t->next = free_timeout;
+    free_timeout = t;
   }
 }
 
@@ -322,35 +434,39 @@ void Fl_Timeout::remove_timeout(Fl_Timeout_Handler cb, void *data) {
   \see Fl::remove_next_timeout(Fl_Timeout_Handler cb, void *data, void **data_return)
 */
 int Fl_Timeout::remove_next_timeout(Fl_Timeout_Handler cb, void *data, void **data_return) {
+  auto m = timeout_map.find(cb);
+  if (m == timeout_map.end())
+    return 0;
+  // find the matching timeout that expires first
   int ret = 0;
-  for (Fl_Timeout** p = &first_timeout; *p;) { // scan all timeouts
-    Fl_Timeout* t = *p;
-    if (t->callback == cb && (t->data == data || !data)) { // timeout matches
-      ret++;
-      if (ret == 1) { // first timeout: remove
-        if (data_return)
-          *data_return = t->data;
-        *p = t->next;
-        t->next = free_timeout;
-        free_timeout = t;
-        continue;
-      }
-      p = &(t->next);
-    } // timeout matches
-    else { // no match
-      p = &(t->next);
-    }
-  } // scan all timeouts
+  Fl_Timeout *first = 0;
+  auto range = data ? m->second.equal_range(data)
+                    : std::make_pair(m->second.begin(), m->second.end());
+  for (auto it = range.first; it != range.second; ++it) {
+    ret++;
+    if (!first || it->second->before(first))
+      first = it->second;
+  }
+  if (first) {
+    if (data_return)
+      *data_return = first->data;
+    first->remove();
+    first->next = free_timeout;
+    free_timeout = first;
+  }
   return ret;
 }
 
+/**
+  Returns the active timeouts, ordered by their expiration time.
+*/
 std::vector<Fl::TimeoutData> Fl_Timeout::timeout_list() {
+  std::vector<Fl_Timeout*> sorted(active_timeouts);
+  std::sort(sorted.begin(), sorted.end(),
+            [](const Fl_Timeout *a, const Fl_Timeout *b) { return a->before(b); });
   std::vector<Fl::TimeoutData> v;
-  const Fl_Timeout *t = first_timeout;
-  while (t) {
-    v.push_back( { t->time, t->callback, t->data } );
-    t = t->next;
-  }
+  for (Fl_Timeout *t : sorted)
+    v.push_back( { t->delay(), t->callback, t->data } );
   return v;
 }
 
@@ -367,18 +483,12 @@ std::vector<Fl::TimeoutData> Fl_Timeout::timeout_list() {
 void Fl_Timeout::make_current() {
   // printf("[%4d] Fl_Timeout::make_current(%p)\n", __LINE__, this);
   // remove the timer entry from the active timer queue
-  for (Fl_Timeout** p = &first_timeout; *p;) {
-    Fl_Timeout* t = *p;
-    if (t == this) {
-      *p = t->next;
-      // push it to the current timer stack
-      t->next = current_timeout;
-      current_timeout = t;
-      break;
-    } else {
-      p = &(t->next);
-    }
-  }
+  if (pos < 0)
+    return;
+  remove();
+  // push it to the current timer stack
+  next = current_timeout;
+  current_timeout = this;
 }
 
 /**
@@ -482,8 +592,8 @@ Fl_Timeout *Fl_Timeout::get(double time, Fl_Timeout_Handler cb, void *data) {
   }
 
   t->next = 0;
-  t->skip = 1;          // see do_timeouts() (issue #450)
   t->delay(time);
+  t->slack = 0.0;
   t->callback = cb;
   t->data = data;
   return t;
@@ -492,8 +602,9 @@ Fl_Timeout *Fl_Timeout::get(double time, Fl_Timeout_Handler cb, void *data) {
 /**
   Elapse all timers w/o calling their callbacks.
 
-  All timer values are adjusted by the delta time since the last call.
-  This method does \b NOT call timer callbacks if timers are expired.
+  The timeout clock is advanced by the delta time since the last call, which
+  reduces the delay of all timers. This method does \b NOT call timer callbacks
+  if timers are expired.
 
   This must be called before new timers are added to the timer queue to make
   sure that the next timer decrement does not count down too much time.
@@ -504,20 +615,36 @@ void Fl_Timeout::elapse_timeouts() {
   double elapsed = elapsed_time();
   // printf("elapse_timeouts: elapsed = %9.6f\n", double(elapsed)/1000000.);
 
-  if (elapsed > 0.0) {
-
-    // active timers
-
-    for (Fl_Timeout* t = first_timeout; t; t = t->next) {
-      t->time -= elapsed;
-    }
-
-    // "current" timers, i.e. timers being serviced
+  if (elapsed > 0.0)
+    timeout_clock += elapsed;
+}
 
-    for (Fl_Timeout* t = current_timeout; t; t = t->next) {
-      t->time -= elapsed;
+/*
+  Return the expired timer that expires first and was inserted before
+  \p serial, or NULL. Timers inserted later are skipped (issue #450).
+  This only visits expired timers in the heap.
+*/
+Fl_Timeout *Fl_Timeout::first_expired(unsigned long serial) {
+  const std::vector<Fl_Timeout*> &heap = active_timeouts;
+  Fl_Timeout *found = 0;
+  std::vector<int> &todo = heap_todo;
+  todo.clear();
+  if (!heap.empty())
+    todo.push_back(0);
+  while (!todo.empty()) {
+    int i = todo.back();
+    todo.pop_back();
+    Fl_Timeout *t = heap[i];
+    if (t->time > timeout_clock || (found && found->before(t)))
+      continue; // the children of t expire even later
+    if (t->serial < serial) {
+      found = t;
+      continue;
     }
+    for (int c = 2 * i + 1; c <= 2 * i + 2 && c < (int)heap.size(); c++)
+      todo.push_back(c);
   }
+  return found;
 }
 
 /**
@@ -525,24 +652,22 @@ void Fl_Timeout::elapse_timeouts() {
 */
 void Fl_Timeout::do_timeouts() {
 
-  // Reset "skip" flag for existing timers (issue #450).
-  // For timers inserted in timer callbacks 'skip' will be true (1)
+  // Timers inserted in timer callbacks have a serial number of at least
+  // 'serial' and are skipped (issue #450).
 
-  Fl_Timeout *t = first_timeout;
-  while (t) {
-    t->skip = 0;
-    t = t->next;
-  }
+  unsigned long serial = next_serial;
+  Fl_Timeout *t;
 
-  if (first_timeout) {
+  if (!active_timeouts.empty()) {
     Fl_Timeout::elapse_timeouts();
-    while ((t = first_timeout)) {
-      if (t->time > 0) break;
+    while (!active_timeouts.empty()) {
+      t = active_timeouts[0];
+      if (t->delay() > 0) break;
 
       // skip timers inserted during timeout handling (issue #450)
-      while (t && t->skip)
-        t = t->next;
-      if (!t || t->time > 0) break;
+      if (t->serial >= serial)
+        t = first_expired(serial);
+      if (!t) break;
 
       // make this timeout the "current" timeout
       t->make_current();
@@ -568,7 +693,9 @@ void Fl_Timeout::do_timeouts() {
 
   If at least one timer is active and its timeout value is smaller than
   \p ttw then this value is returned. Fl::wait() will wait no longer than
-  until the next timer expires.
+  until the next timer expires. If timers have a slack, Fl::wait() waits
+  until the first timer must run at the latest, so that other timers
+  that expire until then run in the same wakeup.
 
   If no timer is active this returns the input value \p ttw unchanged.
 
@@ -580,11 +707,30 @@ void Fl_Timeout::do_timeouts() {
   \return  delay until next timeout or 0.0 (see description)
 */
 double Fl_Timeout::time_to_wait(double ttw) {
-  Fl_Timeout *t = first_timeout;
-  if (!t) return ttw;
-  double tdelay = t->delay();
-if (tdelay < 0.0)
+  if (active_timeouts.empty()) return ttw;
+  double tdelay = active_timeouts[0]->delay();
+  if (tdelay < 0.0)
     return 0.0;
+  if (slack_timeouts) {
+    // find the earliest time at which a timer must run, visiting only
+    // timers that expire before it
+    double latest = active_timeouts[0]->time + active_timeouts[0]->slack;
+    std::vector<int> &todo = heap_todo;
+    todo.clear();
+    todo.push_back(0);
+    while (!todo.empty()) {
+      int i = todo.back();
+      todo.pop_back();
+      Fl_Timeout *t = active_timeouts[i];
+      if (t->time >= latest)
+        continue;
+      if (t->time + t->slack < latest)
+        latest = t->time + t->slack;
+      for (int c = 2 * i + 1; c <= 2 * i + 2 && c < (int)active_timeouts.size(); c++)
+        todo.push_back(c);
+    }
+    tdelay = latest - timeout_clock;
+  }
   if (tdelay < ttw)
     return tdelay;
   return ttw;
@@ -599,15 +745,10 @@ void Fl_Timeout::debug(int level) {
 
   printf("\nFl_Timeout::debug: number of allocated timers = %d\n", num_timers);
 
-  int active = 0;
-  Fl_Timeout *t = first_timeout;
-  while (t) {
-    active++;
-    t = t->next;
-  }
+  int active = (int)active_timeouts.size();
 
   int current = 0;
-  t = current_timeout;
+  Fl_Timeout *t = current_timeout;
   while (t) {
     current++;
     t = t->next;
@@ -622,12 +763,9 @@ void Fl_Timeout::debug(int level) {
 
   printf("Fl_Timeout::debug: active: %d, current: %d, free: %d\n\n", active, current, free);
 
-  t = first_timeout;
-  int n = 0;
-  while (t) {
-    printf("Active timer %3d: time = %10.6f sec\n", n+1, t->delay());
-    t = t->next;
-    n++;
+  std::vector<Fl::TimeoutData> list = timeout_list();
+  for (int n = 0; n < (int)list.size(); n++) {
+    printf("Active timer %3d: time = %10.6f sec\n", n+1, list[n].t);
   }
 } // Fl_Timeout::debug(int)
 
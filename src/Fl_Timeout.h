@@ -2,7 +2,7 @@
 // Header for timeout support functions for the Fast Light Tool Kit (FLTK).
 //
 // Author: Albrecht Schlosser
-// Copyright 2021-2024 by Bill Spitzak and others.
+// Copyright 2021-2026 by Bill Spitzak and others.
 //
 // This library is free software. Distribution and use rights are outlined in
 // the file "COPYING" which should have been included with this file.  If this
@@ -20,6 +20,9 @@
 
 #include <FL/Fl.H>
 
+#include <unordered_map>
+#include <vector>
+
 #define FL_TIMEOUT_DEBUG 0        // 1 = include debugging features, 0 = no
 
 /** \file
@@ -40,8 +43,15 @@
   The internal class Fl_Timeout handles all timeout related functions.
 
   All code is platform independent except retrieving a timestamp which
-  requires calling a system driver function and potentially results in
-  different timer resolutions (from milliseconds to microseconds).
+  requires calling a system driver function. The timestamp is taken from a
+  monotonic clock, so that changes of the system time don't affect timers.
+
+  Active timeouts are kept in a binary heap ordered by their expiration
+  time on an internal clock that is advanced by elapse_timeouts(), so
+  adding, removing, and expiring a timeout takes logarithmic time and
+  elapsing the timeouts takes constant time. A hash table that maps the
+  callback and its data to the active timeouts makes has_timeout() and
+  remove_timeout() independent of the number of other timeouts.
 
   Related user documentation:
 
@@ -51,17 +61,20 @@
   - Fl::has_timeout(Fl_Timeout_Handler cb, void *data)
   - Fl::remove_timeout(Fl_Timeout_Handler cb, void *data)
   - Fl::remove_next_timeout(Fl_Timeout_Handler cb, void *data, void **data_return)
+  - Fl::timeout_slack(double slack, Fl_Timeout_Handler cb, void *data)
 
 */
 class Fl_Timeout {
 
 protected:
 
-  Fl_Timeout *next;             // ** Link to next timeout
+  Fl_Timeout *next;             // ** Link to next current or free timeout
   Fl_Timeout_Handler callback;  // the user's callback
   void *data;                   // the user's callback data
-  double time;                  // delay until timeout
-  int skip;                     // skip "new" (inserted) timers (issue #450)
+  double time;                  // expiration time on the timeout_clock
+  double slack;                 // allowed delay after time, see timeout_slack()
+  unsigned long serial;         // order of insertion, see do_timeouts() (issue #450)
+  int pos;                      // index in active_timeouts, or -1
 
   // constructor
   Fl_Timeout() {
@@ -69,7 +82,9 @@ protected:
     callback = 0;
     data = 0;
     time = 0;
-    skip = 0;
+    slack = 0;
+    serial = 0;
+    pos = -1;
   }
 
   // destructor
@@ -81,22 +96,37 @@ protected:
   // insert this timer into the active timer queue, sorted by expiration time
   void insert();
 
+  // remove this timer from the active timer queue
+  void remove();
+
   // remove this timer from the active timer queue and
   // add it to the "current" timer stack
   void make_current();
 
+  // true if this timer expires before timer t
+  bool before(const Fl_Timeout *t) const {
+    return time < t->time || (time == t->time && serial < t->serial);
+  }
+
+  // move the timer at index i of the heap up or down to its place
+  static void sift_up(int i);
+  static void sift_down(int i);
+
+  // the expired timer that expires first and was inserted before serial
+  static Fl_Timeout *first_expired(unsigned long serial);
+
   // remove this timer from the current timer stack and
   // add it to the list of free timers
   void release();
 
   /** Get the timer's delay in seconds. */
   double delay() {
-    return time;
+    return time - timeout_clock;
   }
 
   /** Set the timer's delay in seconds. */
   void delay(double t) {
-    time = t;
+    time = timeout_clock + t;
   }
 
 public:
@@ -111,6 +141,8 @@ public:
   static int remove_next_timeout(Fl_Timeout_Handler cb, void *data = NULL, void **data_return = NULL);
   static std::vector<Fl::TimeoutData> timeout_list();
 
+  static void timeout_slack(double slack, Fl_Timeout_Handler cb, void *data);
+
   // Elapse timeouts, i.e. calculate new delay time of all timers.
   // This does not call the timer callbacks.
   static void elapse_timeouts();
@@ -131,15 +163,45 @@ protected:
   static Fl_Timeout *current();
 
   /**
-    List of active timeouts.
+    Heap of active timeouts.
 
     These timeouts can be triggered when due, which calls their callbacks.
+    The timeout that expires first is active_timeouts[0], and no timeout
+    expires before its parent at index (i - 1) / 2.
     The lifetime of a timeout:
-    - active, in this queue
+    - active, in this heap
     - callback running, in queue \p current_timeout
     - done, in list of free timeouts, ready to be reused.
   */
-  static Fl_Timeout *first_timeout;
+  static std::vector<Fl_Timeout*> active_timeouts;
+
+  /**
+    The active timeouts by callback and data.
+  */
+  typedef std::unordered_multimap<void*, Fl_Timeout*> Data_Map;
+  static std::unordered_map<Fl_Timeout_Handler, Data_Map> timeout_map;
+
+  /**
+    The time in seconds that elapse_timeouts() has counted since the
+    first call. Expiration times are relative to this clock.
+  */
+  static double timeout_clock;
+
+  /**
+    The number of active timeouts with a slack greater than 0.
+  */
+  static int slack_timeouts;
+
+  /**
+    The serial number of the next timeout that is inserted.
+  */
+  static unsigned long next_serial;
+
+  /**
+    Heap indices still to visit in first_expired() and time_to_wait().
+    Kept between calls, so that walking the heap doesn't allocate memory.
+  */
+  static std::vector<int> heap_todo;
 
   /**
     List of free timeouts after use.
@@ -20,12 +20,13 @@
 #include <string.h>
 
 #include <FL/Fl_Tree.H>
+#include <FL/Fl_Window.H>
 #include <FL/Fl_Preferences.H>
 #include <FL/fl_string_functions.h>
 
 // INTERNAL: scroller callback (hor+vert scroll)
 static void scroll_cb(Fl_Widget*,void *data) {
-  ((Fl_Tree*)data)->redraw();
+  ((Fl_Tree*)data)->damage(FL_DAMAGE_SCROLL);
 }
 
 // INTERNAL: Parse elements from 'path' into an array of null terminated strings
@@ -104,6 +105,7 @@ Fl_Tree::Fl_Tree(int X, int Y, int W, int H, const char *L) : Fl_Group(X,Y,W,H,L
   _toh = _tih = H - Fl::box_dh(box());
   _tree_w = -1;
   _tree_h = -1;
+  _drawn_vpos = _drawn_hpos = 0;
   end();
 }
 
@@ -192,7 +194,7 @@ int Fl_Tree::extend_selection(Fl_Tree_Item *from, Fl_Tree_Item *to,
     return(changed);
   }
   char on = 0;
-  for ( Fl_Tree_Item *item = first(); item; item = item->next_visible(_prefs) ) {
+  for ( Fl_Tree_Item *item = first(); item; item = next_item(item, FL_Down, true) ) {
     if ( visible && !item->is_visible() ) continue;
     if ( on || (item == from) || (item == to) ) {
       switch (val) {
@@ -327,8 +329,8 @@ int Fl_Tree::handle(int e) {
               set_item_focus(next_visible_item(_item_focus, ekey));     // next item up|dn
               if ( _item_focus ) {                                      // item in focus?
                 // Autoscroll
-                int itemtop = _item_focus->y();
-                int itembot = _item_focus->y()+_item_focus->h();
+                int itemtop = item_top(_item_focus);
+                int itembot = itemtop+_item_focus->h();
                 if ( itemtop < y() ) { show_item_top(_item_focus); }
                 if ( itembot > y()+h() ) { show_item_bottom(_item_focus); }
                 // Extend selection
@@ -663,14 +665,18 @@ void Fl_Tree::calc_dimensions() {
 void Fl_Tree::calc_tree() {
   // Set tree width and height to zero, and recalc just _tox/_toy/_tow/_toh for now.
   _tree_w = _tree_h = -1;
+  _rows.clear();
+  _widget_rows.clear();
   calc_dimensions();
   if ( !_root ) return;
   // Walk the tree to determine its width and height.
   // We need this to compute scrollbars..
+  // The walk also collects the displayed items and their positions in _rows,
+  // which lets draw(), find_clicked() and next_item() skip everything else.
   // By the end, 'Y' will be the lowest point on the tree
   //
   int X = _tix + _prefs.marginleft() - _hscroll->value();
-  int Y = _tiy + _prefs.margintop()  - _vscroll->value();
+  int Y = rows_top();
   int W = _tiw;
   // Adjust root's X/W if connectors off
   if (_prefs.connectorstyle() == FL_TREE_CONNECTOR_NONE) {
@@ -688,6 +694,7 @@ void Fl_Tree::calc_tree() {
 }
 
 void Fl_Tree::resize(int X,int Y,int W, int H) {
+  int moved = (X != x() || Y != y()) ? 1 : 0;
   fix_scrollbar_order();
   if (auto_resize_children()) {         // backwards compatibility to 1.4.x
     Fl_Group::resize(X, Y, W, H);
@@ -695,43 +702,86 @@ void Fl_Tree::resize(int X,int Y,int W, int H) {
   } else {
     Fl_Widget::resize(X, Y, W, H);
   }
+  if ( moved )
+    recalc_tree();                      // move the widgets of items not on screen, too
   calc_dimensions();
 }
 
+// INTERNAL: Draw all items of the tree that are in the current clip region.
+void Fl_Tree::draw_items() {
+  // These values are changed during drawing
+  // By end, 'Y' will be the lowest point on the tree
+  int X = _tix + _prefs.marginleft() - _hscroll->value();
+  int Y = rows_top();
+  int W = _tiw - X + _tix;
+  // Adjust root's X/W if connectors off
+  if (_prefs.connectorstyle() == FL_TREE_CONNECTOR_NONE) {
+    X -= _prefs.openicon_w();
+    W += _prefs.openicon_w();
+  }
+  int xmax = 0;
+  fl_font(_prefs.labelfont(), _prefs.labelsize());
+  _root->draw(X, Y, W,                                  // descend into tree here to draw it
+              (Fl::focus()==this)?_item_focus:0,        // show focus item ONLY if Fl_Tree has focus
+              xmax, 1, 1);
+}
+
+// INTERNAL: Draw the background and the items in an area exposed by fl_scroll().
+void Fl_Tree::draw_area_cb(void *data, int X, int Y, int W, int H) {
+  Fl_Tree *tree = (Fl_Tree*)data;
+  fl_push_clip(X, Y, W, H);
+  tree->Fl_Group::draw_box();
+  tree->draw_items();
+  fl_pop_clip();
+}
+
 /// Standard FLTK draw() method, handles drawing the tree widget.
 void Fl_Tree::draw() {
   fix_scrollbar_order();
   // Has tree recalc been scheduled? If so, do it
-  if ( _tree_w == -1 ) calc_tree();
+  int recalc = (_tree_w == -1) ? 1 : 0;
+  if ( recalc ) calc_tree();
   else calc_dimensions();
-  // Let group draw box+label but *NOT* children.
-  // We handle drawing children ourselves by calling each item's draw()
-  {
+  // If the tree was only scrolled, move the items that stay visible and
+  // draw the exposed area. Not if the scaling factor is fractional and
+  // moving pixels would not be exact, or a drag line or label may move.
+  int dx = _drawn_hpos - hposition();
+  int dy = _drawn_vpos - vposition();
+  _drawn_hpos = hposition();
+  _drawn_vpos = vposition();
+  // Only items on screen are drawn and move their widgets,
+  // move the widgets of all other items along with the scrolled tree.
+  if ( !recalc && (dx || dy) ) {
+    for ( size_t i = 0; i < _widget_rows.size(); i++ ) {
+      Fl_Widget *wid = _widget_rows[i]->widget();
+      if ( wid ) wid->position(wid->x() + dx, wid->y() + dy);
+    }
+  }
+  if ( (damage() & ~FL_DAMAGE_CHILD) == FL_DAMAGE_SCROLL ) {
+    float scale = Fl_Surface_Device::surface()->driver()->scale();
+    if ( _root &&
+         Fl_Surface_Device::surface() == Fl_Display_Device::display_device() &&
+         Fl_Window::current() && scale == int(scale) &&
+         !(label() && (align() & FL_ALIGN_INSIDE)) &&
+         !(_prefs.selectmode() == FL_TREE_SELECT_SINGLE_DRAGGABLE && Fl::pushed() == this) ) {
+      fl_scroll(_tix, _tiy, _tiw, _tih, dx, dy, draw_area_cb, this);
+    } else {
+      clear_damage((uchar)(damage() | FL_DAMAGE_ALL));
+    }
+  }
+  if ( (damage() & ~FL_DAMAGE_CHILD) != FL_DAMAGE_SCROLL ) {
+    // Let group draw box+label but *NOT* children.
+    // We handle drawing children ourselves by calling each item's draw()
+    //
     // Draw group's bg + label
     if ( damage() & ~FL_DAMAGE_CHILD) { // redraw entire widget?
       Fl_Group::draw_box();
       Fl_Group::draw_label();
     }
     if ( ! _root ) return;
-    // These values are changed during drawing
-    // By end, 'Y' will be the lowest point on the tree
-    int X = _tix + _prefs.marginleft() - _hscroll->value();
-    int Y = _tiy + _prefs.margintop()  - _vscroll->value();
-    int W = _tiw - X + _tix;
-    // Adjust root's X/W if connectors off
-    if (_prefs.connectorstyle() == FL_TREE_CONNECTOR_NONE) {
-      X -= _prefs.openicon_w();
-      W += _prefs.openicon_w();
-    }
     // Draw entire tree, starting with root
     fl_push_clip(_tix,_tiy,_tiw,_tih);
-    {
-      int xmax = 0;
-      fl_font(_prefs.labelfont(), _prefs.labelsize());
-      _root->draw(X, Y, W,                              // descend into tree here to draw it
-                  (Fl::focus()==this)?_item_focus:0,    // show focus item ONLY if Fl_Tree has focus
-                  xmax, 1, 1);
-    }
+    draw_items();
     fl_pop_clip();
   }
   // Draw scrollbars last
@@ -802,6 +852,7 @@ Fl_Tree_Item* Fl_Tree::root() {
 void Fl_Tree::root(Fl_Tree_Item *newitem) {
   if ( _root ) clear();
   _root = newitem;
+  recalc_tree();
 }
 
 /** Adds a new item, given a menu style \p 'path'.
@@ -852,6 +903,75 @@ Fl_Tree_Item* Fl_Tree::add(Fl_Tree_Item *parent_item, const char *name) {
   return(parent_item->add(_prefs, name));
 }
 
+/**
+ Adds many items at once, given an array of menu style \p 'paths'.
+
+ This is the same as calling add(const char*, Fl_Tree_Item*) for every path,
+ but much faster for large numbers of paths if they are sorted, e.g. in the
+ tree's sortorder(), or at least grouped so that paths which share a parent
+ follow each other, as in a listing of a file system:
+ \par
+ \code
+ :
+ const char *paths[] = { "usr/bin/cc", "usr/bin/ls", "usr/lib/libc.so", "var/log" };
+ tree->add_sorted(paths, 4);
+ :
+ \endcode
+
+ The items of the previous path are remembered, so only the part of each
+ path that differs from the previous one is looked up, and new items are
+ appended to their parent without searching for their position, unless
+ this would break the sortorder().
+
+ \param[in] paths The paths of the items to add.
+ \param[in] count The number of paths.
+ \returns The number of items added. Paths that exist already are skipped.
+ \see add(const char*, Fl_Tree_Item*)
+ \version 1.5.0
+*/
+int Fl_Tree::add_sorted(const char * const *paths, int count) {
+  // Tree has no root? make one
+  if ( ! _root ) {
+    _root = new Fl_Tree_Item(this);
+    _root->parent(0);
+    _root->label("ROOT");
+  }
+  int added = 0;
+  char **prev = 0;                              // elements of the previous path
+  std::vector<Fl_Tree_Item*> items;             // and their items
+  for ( int i = 0; i < count; i++ ) {
+    char **arr = parse_path(paths[i]);
+    // Keep the items that the previous path has in common with this one
+    size_t d = 0;
+    while ( prev && d < items.size() && arr[d] && strcmp(arr[d], prev[d]) == 0 ) d++;
+    items.resize(d);
+    int found = arr[d] ? 0 : 1;                 // an empty path is never added
+    for ( ; arr[d]; d++ ) {
+      Fl_Tree_Item *parent = d ? items[d-1] : _root;
+      Fl_Tree_Item *item = parent->find_child_item(arr[d]);
+      found = item ? 1 : 0;
+      if ( !item ) {
+        // Append if this keeps the children sorted, else let add() find the place
+        int nc = parent->children();
+        Fl_Tree_Item *last = nc ? parent->child(nc-1) : 0;
+        int cmp = (last && last->label()) ? strcmp(last->label(), arr[d]) : 0;
+        if ( _prefs.sortorder() == FL_TREE_SORT_NONE || !last ||
+             (_prefs.sortorder() == FL_TREE_SORT_ASCENDING  && cmp <= 0) ||
+             (_prefs.sortorder() == FL_TREE_SORT_DESCENDING && cmp >= 0) )
+          item = parent->insert(_prefs, arr[d], nc);
+        else
+          item = parent->add(_prefs, arr[d]);
+      }
+      items.push_back(item);
+    }
+    if ( !found ) added++;
+    free_path(prev);
+    prev = arr;
+  }
+  free_path(prev);
+  return(added);
+}
+
 /**
  Inserts a new item \p 'name' above the specified Fl_Tree_Item \p 'above'.
  Example:
@@ -1059,7 +1179,23 @@ int Fl_Tree::item_pathname(char *pathname, int pathnamelen, const Fl_Tree_Item *
 ///
 const Fl_Tree_Item* Fl_Tree::find_clicked(int yonly) const {
   if ( ! _root ) return(NULL);
-  return(_root->find_clicked(_prefs, yonly));
+  if ( _tree_w == -1 ) return(_root->find_clicked(_prefs, yonly));     // no index of items yet
+  // Binary search the displayed items for the first one that ends below the event
+  int ey = Fl::event_y() - rows_top();
+  int lo = 0, hi = (int)_rows.size();
+  while ( lo < hi ) {
+    int mid = (lo + hi) / 2;
+    if ( _rows[mid]->_row_y + _rows[mid]->h() < ey ) lo = mid + 1;
+    else hi = mid;
+  }
+  for ( ; lo < (int)_rows.size() && _rows[lo]->_row_y <= ey; lo++ ) {
+    const Fl_Tree_Item *item = _rows[lo];
+    if ( yonly ) return(item);
+    if ( ey < item->_row_y + item->h() &&
+         Fl::event_x() >= item->x() && Fl::event_x() < item->x() + item->w() )
+      return(item);
+  }
+  return(0);
 }
 
 /// Non-const version of Fl_Tree::find_clicked(int yonly) const.
@@ -1346,6 +1482,14 @@ Fl_Tree_Item *Fl_Tree::next_item(Fl_Tree_Item *item, int dir, bool visible) {
     if ( ! item ) return(0);
     if ( item->visible_r() ) return(item);              // return first/last visible item
   }
+  if ( visible && in_rows(item) ) {                     // use the index of displayed items
+    int row = item->_row;
+    switch (dir) {
+      case FL_Up:   return( row > 0 ? _rows[row-1] : 0 );
+      case FL_Down: return( row+1 < (int)_rows.size() ? _rows[row+1] : 0 );
+    }
+    return(0);
+  }
   switch (dir) {
     case FL_Up:
       if ( visible ) return(item->prev_visible(_prefs));
@@ -2361,7 +2505,8 @@ void Fl_Tree::item_draw_mode(int mode) {
 int Fl_Tree::displayed(Fl_Tree_Item *item) {
   item = item ? item : first();
   if (!item) return(0);
-  return( (item->y() >= y()) && (item->y() <= (y()+h()-item->h())) ? 1 : 0);
+  int item_y = item_top(item);
+  return( (item_y >= y()) && (item_y <= (y()+h()-item->h())) ? 1 : 0);
 }
 
 /// Adjust the vertical scrollbar so that \p 'item' is visible
@@ -2381,7 +2526,7 @@ int Fl_Tree::displayed(Fl_Tree_Item *item) {
 void Fl_Tree::show_item(Fl_Tree_Item *item, int yoff) {
   item = item ? item : first();
   if (!item) return;
-  int newval = item->y() - y() - yoff + (int)_vscroll->value();
+  int newval = item_top(item) - y() - yoff + (int)_vscroll->value();
   if ( newval < _vscroll->minimum() ) newval = (int)_vscroll->minimum();
   if ( newval > _vscroll->maximum() ) newval = (int)_vscroll->maximum();
   _vscroll->value(newval);
@@ -2458,7 +2603,7 @@ void Fl_Tree::vposition(int pos) {
   if (pos > _vscroll->maximum()) pos = (int)_vscroll->maximum();
   if (pos == _vscroll->value()) return;
   _vscroll->value(pos);
-  redraw();
+  damage(FL_DAMAGE_SCROLL);
 }
 
 /// Returns the horizontal scroll position as a pixel offset.
@@ -2483,7 +2628,7 @@ void Fl_Tree::hposition(int pos) {
   if (pos > _hscroll->maximum()) pos = (int)_hscroll->maximum();
   if (pos == _hscroll->value()) return;
   _hscroll->value(pos);
-  redraw();
+  damage(FL_DAMAGE_SCROLL);
 }
 
 /**
@@ -2691,3 +2836,21 @@ void Fl_Tree::fix_scrollbar_order() {
 void Fl_Tree::recalc_tree() {
   _tree_w = _tree_h = -1;
 }
+
+// INTERNAL: Return the screen y position of the top of the first item.
+int Fl_Tree::rows_top() const {
+  return(_tiy + _prefs.margintop() - (int)_vscroll->value());
+}
+
+// INTERNAL: Is \p 'item' in the index of displayed items built by calc_tree()?
+bool Fl_Tree::in_rows(const Fl_Tree_Item *item) const {
+  return( _tree_w != -1 && item->_row >= 0 && item->_row < (int)_rows.size() &&
+          _rows[item->_row] == item );
+}
+
+// INTERNAL: Return the screen y position of \p 'item'.
+//    item->y() is only updated while the item is drawn, so use the
+//    position from the index of displayed items if possible.
+int Fl_Tree::item_top(Fl_Tree_Item *item) const {
+  return( in_rows(item) ? rows_top() + item->_row_y : item->y() );
+}
@@ -72,6 +72,9 @@ void Fl_Tree_Item::_Init(const Fl_Tree_Prefs &prefs, Fl_Tree *tree) {
   _children.manage_item_destroy(1);     // let array's dtor manage destroying Fl_Tree_Items
   _prev_sibling     = 0;
   _next_sibling     = 0;
+  _row              = -1;
+  _row_y            = 0;
+  _rows_h           = 0;
 }
 
 /// Constructor.
@@ -101,6 +104,8 @@ Fl_Tree_Item::~Fl_Tree_Item() {
   // focus item? set to null
   if ( _tree && this == _tree->_item_focus )
     { _tree->_item_focus = 0; }
+  // tree's index of displayed items may point to us
+  if ( _tree ) _tree->recalc_tree();
   //_children.clear();          // array's destructor handles itself
 }
 
@@ -131,6 +136,9 @@ Fl_Tree_Item::Fl_Tree_Item(const Fl_Tree_Item *o) {
   _parent           = o->_parent;
   _prev_sibling     = 0;                // do not copy ptrs! use update_prev_next()
   _next_sibling     = 0;                // do not copy ptrs! use update_prev_next()
+  _row              = -1;
+  _row_y            = 0;
+  _rows_h           = 0;
 }
 
 /// Print the tree as 'ascii art' to stdout.
@@ -157,8 +165,13 @@ void Fl_Tree_Item::show_self(const char *indent) const {
 /// Makes and manages an internal copy of \p 'name'.
 ///
 void Fl_Tree_Item::label(const char *name) {
+  // update the parent's label lookup, if it has one and knows this item
+  Fl_Tree_Item_Array *siblings = _parent ? &_parent->_children : 0;
+  bool indexed = siblings && siblings->unindex_label(this);
+  if ( siblings && !_label ) siblings->drop_label_index(); // unlabeled items are not in it
   if ( _label ) { free((void*)_label); _label = 0; }
   _label = name ? fl_strdup(name) : 0;
+  if ( indexed ) siblings->index_label(this);
   recalc_tree();                // may change label geometry
 }
 
@@ -185,13 +198,8 @@ void Fl_Tree_Item::clear_children() {
 /// \version 1.3.0 release
 ///
 int Fl_Tree_Item::find_child(const char *name) {
-  if ( name ) {
-    for ( int t=0; t<children(); t++ )
-      if ( child(t)->label() )
-        if ( strcmp(child(t)->label(), name) == 0 )
-          return(t);
-  }
-  return(-1);
+  Fl_Tree_Item *item = _children.find(name);
+  return(item ? find_child(item) : -1);
 }
 
 /// Return the /immediate/ child of current item
@@ -201,12 +209,7 @@ int Fl_Tree_Item::find_child(const char *name) {
 /// \version 1.3.3
 ///
 const Fl_Tree_Item* Fl_Tree_Item::find_child_item(const char *name) const {
-  if ( name )
-    for ( int t=0; t<children(); t++ )
-      if ( child(t)->label() )
-        if ( strcmp(child(t)->label(), name) == 0 )
-          return(child(t));
-  return(0);
+  return(_children.find(name));
 }
 
 /// Non-const version of Fl_Tree_Item::find_child_item(const char *name) const.
@@ -224,18 +227,10 @@ Fl_Tree_Item* Fl_Tree_Item::find_child_item(const char *name) {
 /// \version 1.3.0 release
 ///
 const Fl_Tree_Item *Fl_Tree_Item::find_child_item(char **arr) const {
-  for ( int t=0; t<children(); t++ ) {
-    if ( child(t)->label() ) {
-      if ( strcmp(child(t)->label(), *arr) == 0 ) {     // match?
-        if ( *(arr+1) ) {                               // more in arr? descend
-          return(_children[t]->find_child_item(arr+1));
-        } else {                                        // end of arr? done
-          return(_children[t]);
-        }
-      }
-    }
-  }
-  return(0);
+  const Fl_Tree_Item *item = _children.find(*arr);      // match?
+  if ( item && *(arr+1) )                               // more in arr? descend
+    return(item->find_child_item(arr+1));
+  return(item);                                         // end of arr? done
 }
 
 /// Non-const version of Fl_Tree_Item::find_child_item(char **arr) const.
@@ -442,6 +437,7 @@ Fl_Tree_Item *Fl_Tree_Item::insert_above(const Fl_Tree_Prefs &prefs, const char
 Fl_Tree_Item* Fl_Tree_Item::deparent(int pos) {
   Fl_Tree_Item *orphan = _children[pos];
   if ( _children.deparent(pos) < 0 ) return NULL;
+  recalc_tree();                // may change tree geometry
   return orphan;
 }
 
@@ -457,6 +453,7 @@ int Fl_Tree_Item::reparent(Fl_Tree_Item *newchild, int pos) {
   int ret;
   if ( (ret = _children.reparent(newchild, this, pos)) < 0 ) return ret;
   newchild->parent(this);               // take custody
+  recalc_tree();                        // may change tree geometry
   return 0;
 }
 
@@ -470,7 +467,9 @@ int Fl_Tree_Item::reparent(Fl_Tree_Item *newchild, int pos) {
 /// \see move_above(), move_below(), move_into(), move(Fl_Tree_Item*,int,int)
 ///
 int Fl_Tree_Item::move(int to, int from) {
-  return _children.move(to, from);
+  int ret = _children.move(to, from);
+  recalc_tree();                // may change tree geometry
+  return ret;
 }
 
 /// Move the current item above/below/into the specified \p 'item',
@@ -661,16 +660,11 @@ int Fl_Tree_Item::remove_child(Fl_Tree_Item *item) {
 /// \version 1.3.3
 ///
 int Fl_Tree_Item::remove_child(const char *name) {
-  for ( int t=0; t<children(); t++ ) {
-    if ( child(t)->label() ) {
-      if ( strcmp(child(t)->label(), name) == 0 ) {
-        _children.remove(t);
-        recalc_tree();          // may change tree geometry
-        return(0);
-      }
-    }
-  }
-  return(-1);
+  int t = find_child(name);
+  if ( t == -1 ) return(-1);
+  _children.remove(t);
+  recalc_tree();                // may change tree geometry
+  return(0);
 }
 
 /// Swap two of our children, given two child index values \p 'ax' and \p 'bx'.
@@ -681,6 +675,7 @@ int Fl_Tree_Item::remove_child(const char *name) {
 ///
 void Fl_Tree_Item::swap_children(int ax, int bx) {
   _children.swap(ax, bx);
+  recalc_tree();                // may change tree geometry
 }
 
 /// Swap two of our immediate children, given item pointers.
@@ -977,6 +972,11 @@ int Fl_Tree_Item::draw_item_content(int render) {
 void Fl_Tree_Item::draw(int X, int &Y, int W, Fl_Tree_Item *itemfocus,
                         int &tree_item_xmax, int lastchild, int render) {
   Fl_Tree_Prefs &prefs = _tree->_prefs;
+  if ( !render ) {                      // remember position for Fl_Tree's index of displayed items
+    _row    = -1;
+    _row_y  = Y - _tree->rows_top();
+    _rows_h = 0;
+  }
   if ( !is_visible() ) return;
   int tree_top = tree()->_tiy;
   int tree_bot = tree_top + tree()->_tih;
@@ -1053,6 +1053,8 @@ void Fl_Tree_Item::draw(int X, int &Y, int W, Fl_Tree_Item *itemfocus,
     }
   }
   char clipped = ((Y+H) < tree_top) || (Y>tree_bot) ? 1 : 0;
+  // Also skip items outside the area exposed by scrolling the tree
+  if ( !clipped && !fl_not_clipped(tree()->_tix, Y, tree()->_tiw, H2) ) clipped = 1;
   if (!render) clipped = 0;                     // NOT rendering? Then don't clip, so we calc unclipped items
   char active = (is_active() && tree()->active_r()) ? 1 : 0;
   char drawthis = ( is_root() && prefs.showroot() == 0 ) ? 0 : 1;
@@ -1131,6 +1133,13 @@ void Fl_Tree_Item::draw(int X, int &Y, int W, Fl_Tree_Item *itemfocus,
     }                   // end drawthis
   }                     // end clipped
   if ( drawthis ) Y += H2;                                      // adjust Y (even if clipped)
+  if ( !render ) {
+    if ( drawthis ) {
+      _row = (int)_tree->_rows.size();
+      _tree->_rows.push_back(this);
+    }
+    if ( widget() ) _tree->_widget_rows.push_back(this);
+  }
   // Manage tree_item_xmax
   if ( xmax > tree_item_xmax )
     tree_item_xmax = xmax;
@@ -1140,7 +1149,27 @@ void Fl_Tree_Item::draw(int X, int &Y, int W, Fl_Tree_Item *itemfocus,
                            : X;                                 // unless didn't drawthis
     int child_w = W - (child_x-X);
     int child_y_start = Y;
-    for ( int t=0; t<children(); t++ ) {
+    int t = 0;
+    if ( render ) {
+      // Skip children that are entirely above the screen, using the
+      // positions remembered by the last Fl_Tree::calc_tree()
+      int top = tree_top - _tree->rows_top();
+      int lo = 0, hi = children();
+      while ( lo < hi ) {
+        int mid = (lo + hi) / 2;
+        if ( _children[mid]->_row_y + _children[mid]->_rows_h < top ) lo = mid + 1;
+        else hi = mid;
+      }
+      if ( (t = lo) > 0 )
+        Y = _tree->rows_top() + _children[t-1]->_row_y + _children[t-1]->_rows_h;
+    }
+    for ( ; t<children(); t++ ) {
+      if ( render && Y > tree_bot ) {
+        // Skip children that are entirely below the screen
+        Fl_Tree_Item *last = _children[children()-1];
+        Y = _tree->rows_top() + last->_row_y + last->_rows_h;
+        break;
+      }
       int is_lastchild = ((t+1)==children()) ? 1 : 0;
       _children[t]->draw(child_x, Y, child_w, itemfocus, tree_item_xmax, is_lastchild, render);
     }
@@ -1178,6 +1207,7 @@ void Fl_Tree_Item::draw(int X, int &Y, int W, Fl_Tree_Item *itemfocus,
       }
     }
   }
+  if ( !render ) _rows_h = Y - _tree->rows_top() - _row_y;
 }
 
 
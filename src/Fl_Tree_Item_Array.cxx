@@ -7,6 +7,8 @@
 #include <FL/Fl_Tree_Item_Array.H>
 #include <FL/Fl_Tree_Item.H>
 
+#include <unordered_map>
+
 //////////////////////
 // Fl_Tree_Item_Array.cxx
 //////////////////////
@@ -25,6 +27,28 @@
 //     https://www.fltk.org/bugs.php
 //
 
+// Internal: The labels of all items in an array, so that find() does not
+//    have to compare every label. Keys point to the items' own labels.
+//
+struct Fl_Tree_Item_Array::Label_Index {
+  struct Hash {
+    size_t operator()(const char *s) const {
+      size_t h = 2166136261u;                   // FNV-1a
+      for ( ; *s; s++ ) h = (h ^ (unsigned char)*s) * 16777619u;
+      return h;
+    }
+  };
+  struct Equal {
+    bool operator()(const char *a, const char *b) const { return strcmp(a, b) == 0; }
+  };
+  typedef std::unordered_multimap<const char*, Fl_Tree_Item*, Hash, Equal> Map;
+  typedef Map::iterator Map_Iterator;
+  Map map;
+};
+
+// Arrays with fewer items are searched linearly
+static const int min_indexed_items = 32;
+
 /// Constructor; creates an empty array.
 ///
 ///     The optional 'chunksize' can be specified to optimize
@@ -35,6 +59,7 @@ Fl_Tree_Item_Array::Fl_Tree_Item_Array(int new_chunksize) {
   _total     = 0;
   _size      = 0;
   _flags     = 0;
+  _index     = 0;
   _chunksize = new_chunksize;
 }
 
@@ -50,6 +75,7 @@ Fl_Tree_Item_Array::Fl_Tree_Item_Array(const Fl_Tree_Item_Array* o) {
   _size      = o->_size;
   _chunksize = o->_chunksize;
   _flags     = o->_flags;
+  _index     = 0;
   for ( int t=0; t<o->_total; t++ ) {
     if ( _flags & MANAGE_ITEM ) {
       _items[t] = new Fl_Tree_Item(o->_items[t]);       // make new copy of item
@@ -68,6 +94,7 @@ Fl_Tree_Item_Array::Fl_Tree_Item_Array(const Fl_Tree_Item_Array* o) {
 ///     and the array will be cleared. total() will return 0.
 ///
 void Fl_Tree_Item_Array::clear() {
+  delete _index; _index = 0;
   if ( _items ) {
     for ( int t=0; t<_total; t++ ) {
       if ( _flags & MANAGE_ITEM )
@@ -123,6 +150,7 @@ void Fl_Tree_Item_Array::insert(int pos, Fl_Tree_Item *new_item) {
   }
   _items[pos] = new_item;
   _total++;
+  index_label(new_item);
   if ( _flags & MANAGE_ITEM )
   {
     _items[pos]->update_prev_next(pos); // adjust item's prev/next and its neighbors
@@ -146,11 +174,13 @@ void Fl_Tree_Item_Array::add(Fl_Tree_Item *val) {
 ///
 void Fl_Tree_Item_Array::replace(int index, Fl_Tree_Item *newitem) {
   if ( _items[index] ) {                        // delete if non-zero
+    unindex_label(_items[index]);
     if ( _flags & MANAGE_ITEM )
       // Destroy old item
       delete _items[index];
   }
   _items[index] = newitem;                      // install new item
+  index_label(newitem);
   if ( _flags & MANAGE_ITEM )
   {
     // Restitch into linked list
@@ -164,6 +194,7 @@ void Fl_Tree_Item_Array::replace(int index, Fl_Tree_Item *newitem) {
 ///
 void Fl_Tree_Item_Array::remove(int index) {
   if ( _items[index] ) {                        // delete if non-zero
+    unindex_label(_items[index]);
     if ( _flags & MANAGE_ITEM )
       delete _items[index];
   }
@@ -250,6 +281,7 @@ int Fl_Tree_Item_Array::deparent(int pos) {
   Fl_Tree_Item *item = _items[pos];
   Fl_Tree_Item *prev = item->prev_sibling();
   Fl_Tree_Item *next = item->next_sibling();
+  unindex_label(item);
   // Remove from parent's list of children
   _total -= 1;
   for ( int t=pos; t<_total; t++ )
@@ -275,8 +307,86 @@ int Fl_Tree_Item_Array::reparent(Fl_Tree_Item *item, Fl_Tree_Item* newparent, in
   for ( int t=_total-1; t>pos; --t )    // shuffle array to make room for new entry
     _items[t] = _items[t-1];
   _items[pos] = item;                   // insert new entry
+  index_label(item);
   // Attach to new parent and siblings
   _items[pos]->parent(newparent);       // reparent (update_prev_next() needs this)
   _items[pos]->update_prev_next(pos);   // find new siblings
   return 0;
 }
+
+/// Return the first item with the label \p 'name', or NULL if none.
+///
+///     Large arrays that manage their items (see manage_item_destroy())
+///     build a hash table of the labels on first use, which the other
+///     methods keep up to date, so lookups do not compare every label.
+///     Items that share a label are still searched in order.
+///
+const Fl_Tree_Item *Fl_Tree_Item_Array::find(const char *name) const {
+  if ( !name ) return(0);
+  if ( !_index && _total >= min_indexed_items && (_flags & MANAGE_ITEM) ) {
+    _index = new Label_Index;
+    _index->map.reserve(_total);
+    for ( int t=0; t<_total; t++ )
+      if ( _items[t] && _items[t]->label() )
+        _index->map.insert(std::make_pair(_items[t]->label(), _items[t]));
+  }
+  if ( _index ) {
+    std::pair<Label_Index::Map_Iterator, Label_Index::Map_Iterator> r =
+      _index->map.equal_range(name);
+    if ( r.first == r.second ) return(0);                    // no such label
+    Label_Index::Map_Iterator second = r.first;
+    if ( ++second == r.second ) return(r.first->second);     // unique label
+  }
+  for ( int t=0; t<_total; t++ )
+    if ( _items[t] && _items[t]->label() && strcmp(_items[t]->label(), name) == 0 )
+      return(_items[t]);
+  return(0);
+}
+
+/// Non-const version of find(const char*) const.
+Fl_Tree_Item *Fl_Tree_Item_Array::find(const char *name) {
+  return(const_cast<Fl_Tree_Item*>(
+         static_cast<const Fl_Tree_Item_Array&>(*this).find(name)));
+}
+
+/// Add the label of \p 'item' to the hash table used by find().
+/// Fl_Tree_Item::label(const char*) removes the old label of an item
+/// with unindex_label() and adds the new one with index_label().
+void Fl_Tree_Item_Array::index_label(Fl_Tree_Item *item) {
+  if ( _index && item && item->label() )
+    _index->map.insert(std::make_pair(item->label(), item));
+}
+
+/// Remove the label of \p 'item' from the hash table used by find().
+/// \returns true if the label was in the table.
+bool Fl_Tree_Item_Array::unindex_label(Fl_Tree_Item *item) {
+  if ( !_index || !item || !item->label() ) return false;
+  std::pair<Label_Index::Map_Iterator, Label_Index::Map_Iterator> r =
+    _index->map.equal_range(item->label());
+  for ( Label_Index::Map_Iterator i = r.first; i != r.second; ++i ) {
+    if ( i->second == item ) { _index->map.erase(i); return true; }
+  }
+  return false;
+}
+
+/// Drop the hash table used by find(), find() builds a new one.
+void Fl_Tree_Item_Array::drop_label_index() {
+  delete _index; _index = 0;
+}
+
+/// Option to control if Fl_Tree_Item_Array's destructor will also destroy the Fl_Tree_Item's.
+/// If set: items and item array is destroyed.
+/// If clear: only the item array is destroyed, not items themselves.
+///
+///     Only arrays that manage their items keep a hash table of the labels
+///     for find(), because the items of other arrays can be changed or
+///     destroyed without telling the array.
+///
+void Fl_Tree_Item_Array::manage_item_destroy(int val) {
+  if ( val ) {
+    _flags |= MANAGE_ITEM;
+  } else {
+    _flags &= ~MANAGE_ITEM;
+    drop_label_index();
+  }
+}
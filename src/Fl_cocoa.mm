@@ -301,6 +301,7 @@ static DataReady dataready;
 
 void DataReady::AddFD(int n, int events, void (*cb)(int, void*), void *v)
 {
+  events &= ~FL_EDGE; // only supported by epoll
   RemoveFD(n, events);
   int i = nfds++;
   if (i >= fd_array_size)
@@ -329,6 +330,7 @@ void DataReady::AddFD(int n, int events, void (*cb)(int, void*), void *v)
 void DataReady::RemoveFD(int n, int events)
 {
   int i,j;
+  events &= ~FL_EDGE; // only supported by epoll
   _maxfd = -1; // recalculate maxfd on the fly
   for (i=j=0; i<nfds; i++) {
     if (fds[i].fd == n) {
@@ -1,7 +1,7 @@
 //
 // Multi-threading support code for the Fast Light Tool Kit (FLTK).
 //
-// Copyright 1998-2025 by Bill Spitzak and others.
+// Copyright 1998-2026 by Bill Spitzak and others.
 //
 // This library is free software. Distribution and use rights are outlined in
 // the file "COPYING" which should have been included with this file.  If this
@@ -18,6 +18,7 @@
 #include <FL/Fl.H>
 #include "Fl_System_Driver.H"
 
+#include <stdint.h>
 #include <stdlib.h>
 
 /*
@@ -64,16 +65,301 @@
    duplicate entries in the queue.
 */
 
+#include <atomic>
+#include <new>
+#include <unordered_map>
+
+/*
+   The awake queues.
+
+   Worker threads append awake handlers to a list of chunks without taking
+   a lock: a thread claims a slot by incrementing the slot counter of the
+   last chunk, fills it in and marks it ready. If the chunk is full, the
+   first thread that notices links a new chunk behind it. Only the main
+   thread removes handlers, in the order in which the slots were claimed,
+   and stops at the first slot that is not ready yet. That slot's thread
+   calls Fl::awake() after marking it ready, so the main thread will come
+   back for it.
+
+   A chunk that was read completely is deleted as soon as no thread is in
+   the middle of adding a handler, because a thread might still be looking
+   at it. The main thread tries that whenever it reads, and the last thread
+   that leaves push() tries it, too, so that the chunks are freed even if
+   the queue is not read again for a while.
+
+   Fl::awake_once() remembers the newest entry of each handler/data pair in
+   a hash table that is protected by lock_ring(). An entry that is not the
+   newest one of its pair when the main thread reads it is skipped.
+
+   Fl::awake_update() uses a second queue that is only read once per batch
+   of updates. The hash table is used to add a handler/data pair only if it
+   is not in the queue yet, and a worker thread only wakes up the main thread
+   if no batch is scheduled yet.
+*/
+
 #ifndef FL_DOXYGEN
 
-static constexpr int AWAKE_RING_SIZE = 1024;
-Fl_Awake_Handler *Fl_System_Driver::awake_ring_ = nullptr;
-void **Fl_System_Driver::awake_data_ = nullptr;
-int Fl_System_Driver::awake_ring_size_ = 0;
-int Fl_System_Driver::awake_ring_head_ = 0;
-int Fl_System_Driver::awake_ring_tail_ = 0;
+namespace {
+
+struct Awake_Entry {
+  Fl_Awake_Handler func;
+  void *data;
+  unsigned once;                // awake_once() generation, or 0
+  std::atomic<bool> ready;      // set when func, data, and once are valid
+};
+
+struct Awake_Chunk {
+  static constexpr int size = 256;
+  std::atomic<int> claimed;             // number of slots handed out, may exceed size
+  std::atomic<Awake_Chunk*> next;
+  Awake_Chunk *retired_next;            // list of chunks waiting to be deleted
+  Awake_Entry slot[size];
+};
+
+class Awake_Queue {
+  Awake_Chunk *const first_;            // never deleted
+  std::atomic<Awake_Chunk*> tail_;      // chunk to append to
+  std::atomic<int> writers_;            // threads in push()
+  std::atomic<int> pending_;            // entries that were not read yet
+  std::atomic<Awake_Chunk*> retired_;   // chunks to delete
+  // only used by the main thread:
+  Awake_Chunk *head_;                   // chunk to read from
+  int read_;                            // next slot to read in head_
+  void retire(Awake_Chunk *first, Awake_Chunk *last); // any thread
+  void delete_retired();                              // any thread
+public:
+  constexpr Awake_Queue(Awake_Chunk *first)
+  : first_(first), tail_(first), writers_(0), pending_(0),
+    retired_(nullptr), head_(first), read_(0) { }
+  int pending() const { return pending_.load(); }
+  bool push(Fl_Awake_Handler func, void *data, unsigned once);
+  bool pop(Awake_Entry &e);
+};
+
+struct Awake_Key {
+  Fl_Awake_Handler func;
+  void *data;
+  const Awake_Queue *queue;
+  bool operator==(const Awake_Key &k) const {
+    return func == k.func && data == k.data && queue == k.queue;
+  }
+};
+
+struct Awake_Key_Hash {
+  size_t operator()(const Awake_Key &k) const {
+    return (size_t)(reinterpret_cast<uintptr_t>(k.func) * 31 + reinterpret_cast<uintptr_t>(k.data));
+  }
+};
+
+} // namespace
+
+static Awake_Chunk awake_first_chunk, update_first_chunk;
+static Awake_Queue awake_queue(&awake_first_chunk);     // Fl::awake(), Fl::awake_once()
+static Awake_Queue update_queue(&update_first_chunk);   // Fl::awake_update()
+static std::atomic<unsigned long> awake_dropped_count(0); // entries that were not added
+static std::atomic<bool> update_scheduled(false);       // a batch of updates is due
+
+// only used by the main thread:
+static double update_interval = 0.0;    // minimum time between batches
+static Fl_Timestamp update_last;        // time of the last batch
+static bool update_timeout = false;     // update_timeout_cb() is scheduled
+
+// protected by lock_ring():
+static std::unordered_map<Awake_Key, unsigned, Awake_Key_Hash> awake_once_map;
+static unsigned awake_once_generation = 0;
+
+// Adds the chunks from first to last, linked by retired_next, to the chunks
+// to delete.
+void Awake_Queue::retire(Awake_Chunk *first, Awake_Chunk *last) {
+  Awake_Chunk *old = retired_.load();
+  do {
+    last->retired_next = old;
+  } while (!retired_.compare_exchange_weak(old, first));
+}
+
+// Deletes the chunks that were read completely if no thread can see them.
+// A thread in push() that got a chunk from tail_ before the chunk was retired
+// is counted in writers_ until it is done, so if writers_ is 0 after taking
+// the list, no thread can see any chunk in it.
+void Awake_Queue::delete_retired() {
+  if (!retired_.load())
+    return;
+  Awake_Chunk *list = retired_.exchange(nullptr);
+  if (!list)
+    return;
+  if (writers_.load() > 0) {            // try again later
+    Awake_Chunk *last = list;
+    while (last->retired_next)
+      last = last->retired_next;
+    retire(list, last);
+    return;
+  }
+  while (list) {
+    Awake_Chunk *c = list;
+    list = c->retired_next;
+    delete c;
+  }
+}
+
+// Appends an entry, returns false if no chunk could be allocated.
+bool Awake_Queue::push(Fl_Awake_Handler func, void *data, unsigned once) {
+  bool ret = true;
+  writers_.fetch_add(1);
+  for (;;) {
+    Awake_Chunk *c = tail_.load();
+    int i = c->claimed.fetch_add(1);
+    if (i < Awake_Chunk::size) {
+      Awake_Entry &e = c->slot[i];
+      e.func = func;
+      e.data = data;
+      e.once = once;
+      pending_.fetch_add(1);
+      e.ready.store(true, std::memory_order_release);
+      break;
+    }
+    // The chunk is full, append a new one unless another thread did
+    Awake_Chunk *n = c->next.load();
+    if (!n) {
+      Awake_Chunk *nc = new (std::nothrow) Awake_Chunk();
+      if (!nc) {
+        ret = false;
+        break;
+      }
+      if (c->next.compare_exchange_strong(n, nc))
+        n = nc;
+      else
+        delete nc;
+    }
+    tail_.compare_exchange_strong(c, n);
+  }
+  if (writers_.fetch_sub(1) == 1)       // the last thread in push()
+    delete_retired();
+  return ret;
+}
+
+// Removes the oldest entry, returns false if there is none. Main thread only.
+bool Awake_Queue::pop(Awake_Entry &e) {
+  for (;;) {
+    Awake_Chunk *c = head_;
+    if (read_ < Awake_Chunk::size) {
+      Awake_Entry &s = c->slot[read_];
+      if (!s.ready.load(std::memory_order_acquire)) {
+        delete_retired();
+        return false;
+      }
+      read_++;
+      pending_.fetch_sub(1);
+      e.func = s.func;
+      e.data = s.data;
+      e.once = s.once;
+      return true;
+    }
+    // All slots were read, go to the next chunk
+    Awake_Chunk *n = c->next.load();
+    if (!n)
+      return false;
+    head_ = n;
+    read_ = 0;
+    // make sure that no thread can reach this chunk through the tail pointer
+    Awake_Chunk *expected = c;
+    tail_.compare_exchange_strong(expected, n);
+    if (c != first_)
+      retire(c, c);
+    delete_retired();
+  }
+}
+
+// Adds an entry to a queue, see Fl_System_Driver::push_awake_handler().
+static int push_handler(Awake_Queue &queue, Fl_Awake_Handler func, void *data, bool once) {
+  Awake_Key key = { func, data, &queue };
+  unsigned generation = 0, previous = 0;
+  if (once) {
+    Fl::system_driver()->lock_ring();
+    if (++awake_once_generation == 0) awake_once_generation = 1;
+    generation = awake_once_generation;
+    unsigned &g = awake_once_map[key];
+    previous = g;
+    g = generation;
+    Fl::system_driver()->unlock_ring();
+  }
+  if (queue.push(func, data, generation))
+    return 0;
+
+  awake_dropped_count.fetch_add(1);
+  if (once) {
+    // let the previous entry of this pair be called again
+    Fl::system_driver()->lock_ring();
+    auto it = awake_once_map.find(key);
+    if (it != awake_once_map.end() && it->second == generation) {
+      if (previous) it->second = previous;
+      else awake_once_map.erase(it);
+    }
+    Fl::system_driver()->unlock_ring();
+  }
+  return -1;
+}
+
+// Adds an entry to the update queue unless the pair is already in it.
+static int push_update(Fl_Awake_Handler func, void *data) {
+  Awake_Key key = { func, data, &update_queue };
+  Fl::system_driver()->lock_ring();
+  bool queued = (awake_once_map.find(key) != awake_once_map.end());
+  unsigned generation = 0;
+  if (!queued) {
+    if (++awake_once_generation == 0) awake_once_generation = 1;
+    generation = awake_once_map[key] = awake_once_generation;
+  }
+  Fl::system_driver()->unlock_ring();
+  if (queued || update_queue.push(func, data, generation))
+    return 0;
 
-#endif
+  awake_dropped_count.fetch_add(1);
+  Fl::system_driver()->lock_ring();
+  awake_once_map.erase(key);
+  Fl::system_driver()->unlock_ring();
+  return -1;
+}
+
+// Returns false if the entry is a replaced awake_once() entry.
+static bool awake_entry_current(const Awake_Queue &queue, const Awake_Entry &e) {
+  if (!e.once)
+    return true;
+  Awake_Key key = { e.func, e.data, &queue };
+  Fl::system_driver()->lock_ring();
+  auto it = awake_once_map.find(key);
+  bool current = (it != awake_once_map.end() && it->second == e.once);
+  if (current)
+    awake_once_map.erase(it);
+  Fl::system_driver()->unlock_ring();
+  return current;
+}
+
+// Calls the handlers that are in a queue now. Handlers that are added
+// meanwhile are left for the next call, the thread that adds them wakes
+// up the main thread again.
+static void run_handlers(Awake_Queue &queue) {
+  Awake_Entry e;
+  for (int n = queue.pending(); n > 0 && queue.pop(e); n--) {
+    if (awake_entry_current(queue, e))
+      e.func(e.data);
+  }
+}
+
+// Calls all handlers that were added with Fl::awake_update().
+static void run_update_batch() {
+  // clear the flag first, a thread that adds an update while we are reading
+  // the queue will wake us up again
+  update_scheduled.store(false);
+  update_last = Fl::now();
+  run_handlers(update_queue);
+}
+
+static void update_timeout_cb(void*) {
+  update_timeout = false;
+  run_update_batch();
+}
+
+#endif // FL_DOXYGEN
 
 /**
  \cond DriverDev
@@ -84,101 +370,50 @@ int Fl_System_Driver::awake_ring_tail_ = 0;
 /**
  \brief Adds an awake handler for use in awake().
 
- \internal Adds an awake handler for use in awake().
+ \internal Adds an awake handler for use in awake(). This can be called by
+ any thread and does not take a lock, unless \p once is true.
 
  \param[in] func The function to call when the main thread is awake.
  \param[in] data The user data to pass to the function.
  \param[in] once If true, the handler will be added only once, removing any
                  existing handler with the same function pointer and data pointer.
- \return 0 on success, -1 if the ring buffer is full.
+ \return 0 on success, -1 if the memory for the queue could not be allocated.
  */
 int Fl_System_Driver::push_awake_handler(Fl_Awake_Handler func, void *data, bool once)
 {
-  int ret = 0;
-  Fl::system_driver()->lock_ring();
-
-  // Allocate the ring buffers if we have not done so yet.
-  if (!awake_ring_) {
-    awake_ring_size_ = AWAKE_RING_SIZE;
-    awake_ring_ = (Fl_Awake_Handler*)malloc(awake_ring_size_*sizeof(Fl_Awake_Handler));
-    awake_data_ = (void**)malloc(awake_ring_size_*sizeof(void*));
-    // explicitly initialize the head and tail indices
-    awake_ring_head_= awake_ring_tail_ = 0;
-  }
-
-  // If we want to add the handler only once, go through the list of existing
-  // handlers and remove any handler with the same function pointer
-  // and data pointer.
-  if (once) {
-    int src = awake_ring_tail_;
-    int dst = awake_ring_tail_;
-    while (src != awake_ring_head_) {
-      if ((awake_ring_[src] != func) || (awake_data_[src] != data)) {
-        if (src != dst) {
-          awake_ring_[dst] = awake_ring_[src];
-          awake_data_[dst] = awake_data_[src];
-        }
-        dst++;
-        if (dst >= awake_ring_size_) dst = 0; // wrap around
-      }
-      src++;
-      if (src >= awake_ring_size_) src = 0; // wrap around
-    }
-    awake_ring_head_ = dst;
-  }
-
-  // The next head index we will want (not the current index):
-  // We use this to check if the ring-buffer is full or not
-  // (and to update awake_ring_head_ if we do use the current index.)
-  int next_head = awake_ring_head_ + 1;
-  if (next_head >= awake_ring_size_) {
-    next_head = 0;
-  }
-  // check that the ring buffer is not full
-  if (next_head == awake_ring_tail_) {
-    // ring is full. Return -1 as an error indicator.
-    ret = -1;
-  } else {
-    awake_ring_[awake_ring_head_] = func;
-    awake_data_[awake_ring_head_] = data;
-    awake_ring_head_ = next_head;
-  }
-
-  Fl::system_driver()->unlock_ring();
-  return ret;
+  return push_handler(awake_queue, func, data, once);
 }
 
 /**
- \brief Gets the last stored awake handler for use in awake().
+ \brief Calls all pending awake handlers.
  \internal Used in the main event loop when an Awake message is received.
+ Calls the handlers of Fl::awake(Fl_Awake_Handler, void*) and
+ Fl::awake_once(), and then the handlers of Fl::awake_update() if the
+ interval since the last batch of updates has passed, or schedules a
+ timeout for that batch otherwise. Must only be called by the main thread.
  */
-int Fl_System_Driver::pop_awake_handler(Fl_Awake_Handler &func, void *&data)
+void Fl_System_Driver::run_awake_handlers()
 {
-  int ret = 0;
-  Fl::system_driver()->lock_ring();
-  if ((!awake_ring_) || (awake_ring_head_ == awake_ring_tail_)) {
-    ret = -1;
-  } else {
-    func = awake_ring_[awake_ring_tail_];
-    data = awake_data_[awake_ring_tail_];
-    ++awake_ring_tail_;
-    if (awake_ring_tail_ >= awake_ring_size_) {
-      awake_ring_tail_ = 0;
+  run_handlers(awake_queue);
+  if (!update_scheduled.load() || update_timeout)
+    return;
+  if (update_interval > 0.0) {
+    double wait = update_interval - Fl::seconds_since(update_last);
+    if (wait > 0.0) {
+      update_timeout = true;
+      Fl::add_timeout(wait, update_timeout_cb);
+      return;
     }
   }
-  Fl::system_driver()->unlock_ring();
-  return ret;
+  run_update_batch();
 }
 
 /**
- \brief Checks if the awake ring buffer is empty.
+ \brief Checks if the awake queues are empty.
  \internal Used in the main event loop when an Awake message is received.
  */
 bool Fl_System_Driver::awake_ring_empty() {
-  Fl::system_driver()->lock_ring();
-  bool retval = (awake_ring_head_ == awake_ring_tail_);
-  Fl::system_driver()->unlock_ring();
-  return retval;
+  return awake_queue.pending() == 0 && update_queue.pending() == 0;
 }
 
 /**
@@ -234,8 +469,9 @@ void Fl::awake(void *v) {
  be run by the main thread, passing optional user data. The callback will be
  executed during the main thread's next event handling cycle.
 
- The queue holding the list of handlers is limited to 1024 entries.
- If the queue is full, the function will return -1 and the callback will not be
+ The queue holding the list of handlers grows as needed, and adding a handler
+ does not block other threads. If the memory for the queue can not be
+ allocated, the function will return -1 and the callback will not be
  scheduled. However the main thread will still be woken up to process any
  other pending events.
 
@@ -246,10 +482,11 @@ void Fl::awake(void *v) {
  several seconds.
 
  \return 0 if the callback was successfully scheduled
- \return -1 if the queue is full.
+ \return -1 if the queue could not grow.
 
  \see Fl::awake()
  \see Fl::awake_once(Fl_Awake_Handler, void*)
+ \see Fl::awake_pending(), Fl::awake_dropped()
  \see \ref advanced_multithreading
 */
 int Fl::awake(Fl_Awake_Handler handler, void *user_data) {
@@ -264,22 +501,110 @@ int Fl::awake(Fl_Awake_Handler handler, void *user_data) {
  This function lets a worker thread request that a specific callback function
  be run by the main thread, passing optional user data. If a callback with the
  same user_data is already scheduled, the previous entry will be removed and
- the new entry will be appended to the list.
+ the new entry will be appended to the list. Finding the previous entry takes
+ constant time, independent of the number of scheduled callbacks.
 
  \return 0 if the callback was successfully scheduled
- \return -1 if the queue is full.
+ \return -1 if the queue could not grow.
 
  \see Fl::awake()
  \see Fl::awake(Fl_Awake_Handler, void*)
  \see \ref advanced_multithreading
 */
 int Fl::awake_once(Fl_Awake_Handler handler, void *user_data) {
-  // TODO: remove any previous entry with the same handler and user_data
   int ret = Fl_System_Driver::push_awake_handler(handler, user_data, true);
   Fl::awake();
   return ret;
 }
 
+/**
+ \brief Schedules a callback for the next batch of UI updates, then wakes up the main thread if needed.
+
+ This function lets a worker thread post frequent UI updates, e.g. progress,
+ live charts, or a log tail, without waking up the main thread for each of
+ them. The main thread calls all callbacks that were posted with this
+ function in one batch, and redraws the changed widgets once after the batch.
+
+ If a callback with the same \p handler and \p user_data is already scheduled
+ for the next batch, it is not added again, so the callback should read the
+ current state of the data when it is called. A worker thread only wakes up
+ the main thread if no batch is scheduled yet, so a stream of updates costs
+ one wakeup per batch.
+
+ By default a batch is run in every iteration of the event loop that has
+ updates. Use Fl::awake_update_interval(double) to limit the number of batches
+ per second, e.g. to the refresh rate of the display.
+
+ Callbacks posted with Fl::awake(Fl_Awake_Handler, void*) and
+ Fl::awake_once(Fl_Awake_Handler, void*) are called before the batch and are
+ not delayed by the interval.
+
+ \return 0 if the callback was successfully scheduled
+ \return -1 if the queue could not grow.
+
+ \see Fl::awake_update_interval(double)
+ \see Fl::awake_once(Fl_Awake_Handler, void*)
+ \see \ref advanced_multithreading
+*/
+int Fl::awake_update(Fl_Awake_Handler handler, void *user_data) {
+  int ret = push_update(handler, user_data);
+  if (!update_scheduled.exchange(true))
+    Fl::awake();
+  return ret;
+}
+
+/**
+ \brief Sets the minimum time between two batches of UI updates.
+
+ Callbacks posted with Fl::awake_update(Fl_Awake_Handler, void*) are called
+ at most once per \p seconds. Use 1.0/60.0 to update the UI no faster than a
+ display with a refresh rate of 60 Hz. The default is 0.0, which runs a batch
+ in every iteration of the event loop that has updates.
+
+ This function must be called by the main thread.
+
+ \param[in] seconds minimum time between two batches
+ \see Fl::awake_update(Fl_Awake_Handler, void*)
+*/
+void Fl::awake_update_interval(double seconds) {
+  update_interval = seconds > 0.0 ? seconds : 0.0;
+}
+
+/**
+ \brief Returns the minimum time between two batches of UI updates.
+ \see Fl::awake_update_interval(double)
+*/
+double Fl::awake_update_interval() {
+  return update_interval;
+}
+
+/**
+ \brief Returns the number of callbacks that are waiting to be executed.
+
+ This counts the callbacks scheduled with Fl::awake(Fl_Awake_Handler, void*),
+ Fl::awake_once(Fl_Awake_Handler, void*), and
+ Fl::awake_update(Fl_Awake_Handler, void*) that the main thread did not take
+ from the queue yet, including entries of Fl::awake_once() that were replaced
+ by a newer entry and will be skipped.
+
+ \see Fl::awake_dropped()
+*/
+int Fl::awake_pending() {
+  return awake_queue.pending() + update_queue.pending();
+}
+
+/**
+ \brief Returns the number of callbacks that could not be scheduled.
+
+ Fl::awake(Fl_Awake_Handler, void*) and Fl::awake_once(Fl_Awake_Handler, void*)
+ drop a callback and return -1 if the queue can not grow.
+
+ \see Fl::awake_pending()
+*/
+unsigned long Fl::awake_dropped() {
+  return awake_dropped_count.load();
+}
+
 /**
  \brief Returns the last message sent by a child thread.
 
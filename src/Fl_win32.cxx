@@ -275,6 +275,7 @@ static struct FD {
 extern unsigned int fl_codepage;
 
 void Fl_WinAPI_System_Driver::add_fd(int n, int events, void (*cb)(FL_SOCKET, void *), void *v) {
+  events &= ~FL_EDGE; // only supported by epoll
   remove_fd(n, events);
   int i = nfds++;
   if (i >= fd_array_size) {
@@ -302,6 +303,7 @@ void Fl_WinAPI_System_Driver::add_fd(int fd, void (*cb)(FL_SOCKET, void *), void
 
 void Fl_WinAPI_System_Driver::remove_fd(int n, int events) {
   int i, j;
+  events &= ~FL_EDGE; // only supported by epoll
   for (i = j = 0; i < nfds; i++) {
     if (fd[i].fd == n) {
       short e = fd[i].events & ~events;
@@ -346,13 +348,9 @@ extern int fl_send_system_handlers(void *e);
 MSG fl_msg;
 
 // A local helper function to flush any pending callback requests
-// from the awake ring-buffer
+// from the awake queues
 static void process_awake_handler_requests(void) {
-  Fl_Awake_Handler func;
-  void *data;
-  while (Fl_WinAPI_System_Driver::pop_awake_handler(func, data) == 0) {
-    func(data);
-  }
+  Fl_WinAPI_System_Driver::run_awake_handlers();
 }
 
 // This is never called with time_to_wait < 0.0.
@@ -436,8 +434,6 @@ double Fl_WinAPI_System_Driver::wait(double time_to_wait) {
   }
 
   // The following conditional test: !Fl_System_Driver::awake_ring_empty()
-  //  equivalent to:
-  //    (Fl::awake_ring_head_ != Fl::awake_ring_tail_)
   // is a workaround / fix for STR #3143. This works, but a better solution
   // would be to understand why the PostThreadMessage() messages are not
   // seen by the main window if it is being dragged/ resized at the time.
@@ -445,17 +441,15 @@ double Fl_WinAPI_System_Driver::wait(double time_to_wait) {
   // whilst the main window is unresponsive (if a drag or resize operation
   // is in progress) we may miss the PostThreadMessage(). So here, we check if
   // there is anything pending in the awake ring buffer and if so process
-  // it. This is not strictly thread safe (for speed it compares the head
-  // and tail indices without first locking the ring buffer) but is intended
+  // it. The test only reads the number of pending entries and is intended
   // only as a fall-back recovery mechanism if the awake processing stalls.
-  // If the test erroneously returns true (may happen if we test the indices
-  // whilst they are being modified) we will call process_awake_handler_requests()
-  // unnecessarily, but this has no harmful consequences so is safe to do.
+  // If the test returns true while an entry is still being added we will
+  // call process_awake_handler_requests() unnecessarily, but this has no
+  // harmful consequences so is safe to do.
   // Note also that if we miss the PostThreadMessage(), then thread_message_
   // will not be updated, so this is not a perfect solution, but it does
   // recover and process any pending awake callbacks.
-  // Normally the ring buffer head and tail indices will match and this
-  // comparison will do nothing. Addresses STR #3143
+  // Normally the awake queue will be empty and this test will do nothing. Addresses STR #3143
   if (!Fl_System_Driver::awake_ring_empty()) {
     process_awake_handler_requests();
   }
@@ -27,7 +27,7 @@
 /* #define BACKSPACE_HACK 1 */
 
 #  include <config.h>
-#  include <FL/Fl.H>
+#  include "Fl_Private.H"
 #  include <FL/platform.H>
 #  include "Fl_Window_Driver.H"
 #  include <FL/Fl_Window.H>
@@ -90,11 +90,11 @@ static bool have_xfixes = false;
 #    include <X11/extensions/Xrender.h>
 #  endif
 
-#  if USE_POLL
+#  if USE_POLL || USE_EPOLL
 #    include <poll.h>
 #  else
 #    define POLLIN 1
-#  endif /* USE_POLL */
+#  endif /* USE_POLL || USE_EPOLL */
 
 extern Fl_Widget *fl_selection_requestor;
 extern Fl_Window *fl_xmousewin;
@@ -106,6 +106,31 @@ extern int fl_send_system_handlers(void *e);
 static Fl_Window *send_motion;
 #endif
 
+// Replace a MotionNotify event with the last one of the queued motion
+// events that follow it for the same window and state, and remember the
+// positions of the replaced events (see Fl::compress_motion()).
+static void merge_motion(XEvent &xevent) {
+  std::vector<int> &merged = Fl::Private::merged_motion_;
+  while (XEventsQueued(fl_display, QueuedAlready)) {
+    XEvent next;
+    XPeekEvent(fl_display, &next);
+    if (next.type != MotionNotify || next.xmotion.window != xevent.xmotion.window ||
+        next.xmotion.state != xevent.xmotion.state)
+      break;
+    merged.push_back(xevent.xmotion.x);
+    merged.push_back(xevent.xmotion.y);
+    XNextEvent(fl_display, &xevent);
+  }
+#if USE_XFT || FLTK_USE_CAIRO
+  Fl_Window *win = merged.empty() ? 0 : fl_find(xevent.xmotion.window);
+  if (win) {
+    float s = Fl::screen_driver()->scale(Fl_Window_Driver::driver(win)->screen_num());
+    for (size_t i = 0; i < merged.size(); i++)
+      merged[i] = int(merged[i] / s);
+  }
+#endif
+}
+
 static bool in_a_window; // true if in any of our windows, even destroyed ones
 static void do_queued_events() {
   in_a_window = true;
@@ -114,6 +139,12 @@ static void do_queued_events() {
     XNextEvent(fl_display, &xevent);
     if (fl_send_system_handlers(&xevent))
       continue;
+    if (xevent.type == MotionNotify && Fl::Private::compress_motion_) {
+      merge_motion(xevent);
+      fl_handle(xevent);
+      Fl::Private::merged_motion_.clear();
+      continue;
+    }
     fl_handle(xevent);
   }
   // we send FL_LEAVE only if the mouse did not enter some other window:
@@ -660,6 +691,9 @@ void open_display_i(Display* d) {
 
 void Fl_X11_Screen_Driver::close_display() {
   Fl::remove_fd(ConnectionNumber(fl_display));
+#if HAVE_XSHM
+  shm_release();
+#endif
   XCloseDisplay(fl_display);
 }
 
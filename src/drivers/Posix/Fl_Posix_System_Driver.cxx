@@ -1,7 +1,7 @@
 //
 // Definition of Posix system driver (used by the X11, Wayland and macOS platforms).
 //
-// Copyright 1998-2023 by Bill Spitzak and others.
+// Copyright 1998-2026 by Bill Spitzak and others.
 //
 // This library is free software. Distribution and use rights are outlined in
 // the file "COPYING" which should have been included with this file.  If this
@@ -29,6 +29,7 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <sys/time.h>
+#include <sys/mman.h>
 #include <pwd.h>
 #include <unistd.h>
 #include <time.h>
@@ -84,6 +85,31 @@ int Fl_Posix_System_Driver::file_type(const char *filename)
   return filetype;
 }
 
+void *Fl_Posix_System_Driver::map_file(const char *f, size_t *size) {
+  int fd = ::open(f, O_RDONLY);
+  if (fd < 0) return NULL;
+  void *addr = NULL;
+  struct stat st;
+  if (!fstat(fd, &st) && S_ISREG(st.st_mode) && st.st_size > 0 &&
+      (unsigned long long)st.st_size <= (size_t)-1) {
+    addr = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (addr == MAP_FAILED) {
+      addr = NULL;
+    } else {
+#ifdef MADV_SEQUENTIAL
+      madvise(addr, (size_t)st.st_size, MADV_SEQUENTIAL);
+#endif
+      *size = (size_t)st.st_size;
+    }
+  }
+  ::close(fd);
+  return addr;
+}
+
+void Fl_Posix_System_Driver::unmap_file(void *addr, size_t size) {
+  munmap(addr, size);
+}
+
 const char *Fl_Posix_System_Driver::getpwnam(const char *login) {
   struct passwd *pwd;
   pwd = ::getpwnam(login);
@@ -98,6 +124,15 @@ void Fl_Posix_System_Driver::gettime(time_t *sec, int *usec) {
   *usec = tv.tv_usec;
 }
 
+double Fl_Posix_System_Driver::monotonic_time() {
+#if defined(CLOCK_MONOTONIC)
+  struct timespec ts;
+  if (clock_gettime(CLOCK_MONOTONIC, &ts) == 0)
+    return ts.tv_sec + ts.tv_nsec / 1000000000.0;
+#endif
+  return Fl_System_Driver::monotonic_time();
+}
+
 // Run the specified program, returning 1 on success and 0 on failure
 int Fl_Posix_System_Driver::run_program(const char *program, char **argv, char *msg, int msglen) {
   pid_t pid;                            // Process ID of first child
@@ -321,8 +356,7 @@ int Fl_Posix_System_Driver::close_fd(int fd) { return close(fd); }
 #  include <unistd.h>
 #  include <fcntl.h>
 #  include <pthread.h>
-#  include <sys/ioctl.h>
-#  include <mutex> // for std::mutex (since C++11)
+#  include <atomic>
 
 // Pipe for thread messaging via Fl::awake()...
 static int thread_filedes[2];
@@ -372,20 +406,15 @@ static void unlock_function_rec() {
 
 // -- Start of "awake" implementation --
 static void* thread_message_ = nullptr;
-static std::mutex pipe_mutex;
+static std::atomic<bool> pipe_pending(false); // a byte was written and not read yet
 
 void Fl_Posix_System_Driver::awake(void* msg) {
   thread_message_ = msg;
-  if (thread_filedes[1]) {
-    pipe_mutex.lock();
-    int avail = 0;
-    ioctl(thread_filedes[0], FIONREAD, &avail);
-    if (avail == 0) {
-      // Only write to the pipe if there is no data wainting to avoid overflow.
-      char dummy = 0;
-      if (write(thread_filedes[1], &dummy, 1)==0) { /* ignore */ }
-    }
-    pipe_mutex.unlock();
+  // Only write to the pipe if there is no data waiting, so that a stream
+  // of awake calls costs one write and one wakeup of the main thread
+  if (thread_filedes[1] && !pipe_pending.exchange(true)) {
+    char dummy = 0;
+    if (write(thread_filedes[1], &dummy, 1)==0) { /* ignore */ }
   }
 }
 
@@ -397,16 +426,13 @@ void* Fl_Posix_System_Driver::thread_message() {
 
 static void thread_awake_cb(int fd, void*) {
   if (thread_filedes[1]) {
-    pipe_mutex.lock();
     char dummy = 0;
     if (read(fd, &dummy, 1)==0) { /* This should never happen */ }
-    pipe_mutex.unlock();
-  }
-  Fl_Awake_Handler func;
-  void *data;
-  while (Fl_System_Driver::pop_awake_handler(func, data)==0) {
-    (*func)(data);
+    // clear the flag before reading the queues, so that a thread that adds
+    // a handler after this point writes to the pipe again
+    pipe_pending.store(false);
   }
+  Fl_System_Driver::run_awake_handlers();
 }
 // -- End of "awake" implementation --
 
@@ -1,7 +1,7 @@
 //
 // Definition of the part of the Screen interface shared by X11/Wayland
 //
-// Copyright 2022-2024 by Bill Spitzak and others.
+// Copyright 2022-2026 by Bill Spitzak and others.
 //
 // This library is free software. Distribution and use rights are outlined in
 // the file "COPYING" which should have been included with this file.  If this
@@ -18,6 +18,21 @@
 #include <sys/time.h>
 #include "Fl_Unix_Screen_Driver.H"
 
+#if USE_EPOLL
+#include <FL/Enumerations.H>
+#include <sys/timerfd.h>
+#include <unistd.h>
+#include <errno.h>
+#include <math.h>
+#include <stdint.h>
+
+int Fl_Unix_Screen_Driver::epoll_fd = -1;
+int Fl_Unix_Screen_Driver::timer_fd = -1;
+std::vector< std::vector<Fl_Unix_Screen_Driver::FD> > Fl_Unix_Screen_Driver::fd;
+std::vector<int> Fl_Unix_Screen_Driver::unpolled;
+int Fl_Unix_Screen_Driver::nfds = 0;
+static bool timer_armed = false;
+#else
 #if USE_POLL
 pollfd *Fl_Unix_Screen_Driver::pollfds = NULL;
 #else
@@ -26,6 +41,7 @@ fd_set Fl_Unix_Screen_Driver::fdsets[3];
 int Fl_Unix_Screen_Driver::maxfd = 0;
 int Fl_Unix_Screen_Driver::nfds = 0;
 Fl_Unix_Screen_Driver::FD *Fl_Unix_Screen_Driver::fd = NULL;
+#endif // USE_EPOLL
 
 // these pointers are set by the Fl::lock() function:
 static void nothing() {}
@@ -33,6 +49,170 @@ void (*fl_lock_function)() = nothing;
 void (*fl_unlock_function)() = nothing;
 
 
+#if USE_EPOLL
+
+// Create the epoll instance and the timerfd for timeouts if not done yet.
+// Returns the epoll instance or -1.
+int Fl_Unix_Screen_Driver::epoll_init() {
+  if (epoll_fd >= 0)
+    return epoll_fd;
+  epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+  if (epoll_fd < 0)
+    return -1;
+  timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+  if (timer_fd >= 0) {
+    epoll_event ev;
+    ev.events = EPOLLIN;
+    ev.data.fd = timer_fd;
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, timer_fd, &ev) < 0) {
+      ::close(timer_fd);
+      timer_fd = -1;
+    }
+  }
+  return epoll_fd;
+}
+
+// Register the events of all callbacks of file descriptor n with epoll,
+// or remove it from the epoll set if it has no callbacks left.
+void Fl_Unix_Screen_Driver::epoll_update(int n) {
+  if (epoll_init() < 0)
+    return;
+  int events = 0;
+  if (n < (int)fd.size()) {
+    for (size_t i = 0; i < fd[n].size(); i++)
+      events |= fd[n][i].events;
+  }
+  size_t u = 0;
+  while (u < unpolled.size() && unpolled[u] != n)
+    u++;
+  epoll_event ev;
+  ev.events = 0;
+  if (events & POLLIN) ev.events |= EPOLLIN;
+  if (events & POLLOUT) ev.events |= EPOLLOUT;
+  if (events & POLLERR) ev.events |= EPOLLPRI;  // like the except set of select()
+  if (events & FL_EDGE) ev.events |= EPOLLET;
+  ev.data.fd = n;
+  if (!(events & (POLLIN | POLLOUT | POLLERR))) {
+    if (u < unpolled.size())
+      unpolled.erase(unpolled.begin() + u);
+    else
+      epoll_ctl(epoll_fd, EPOLL_CTL_DEL, n, &ev);
+    return;
+  }
+  if (u < unpolled.size())
+    return;
+  if (epoll_ctl(epoll_fd, EPOLL_CTL_MOD, n, &ev) == 0)
+    return;
+  if (errno == ENOENT && epoll_ctl(epoll_fd, EPOLL_CTL_ADD, n, &ev) == 0)
+    return;
+  // epoll rejects regular files and directories, which select() and poll()
+  // report as always ready
+  if (errno == EPERM)
+    unpolled.push_back(n);
+}
+
+// Call the callbacks of file descriptor f that wait for revents.
+// Callbacks that a previous callback removed are not called.
+static void do_fd_callbacks(int f, int revents) {
+  std::vector< std::vector<Fl_Unix_Screen_Driver::FD> > &fd = Fl_Unix_Screen_Driver::fd;
+  if (f >= (int)fd.size() || fd[f].empty())
+    return;
+  if (fd[f].size() == 1) {
+    Fl_Unix_Screen_Driver::FD h = fd[f][0];
+    if (h.events & revents) h.cb(f, h.arg);
+    return;
+  }
+  std::vector<Fl_Unix_Screen_Driver::FD> list(fd[f]);
+  for (size_t i = 0; i < list.size(); i++) {
+    if (!(list[i].events & revents))
+      continue;
+    size_t j = 0;
+    while (j < fd[f].size() && (fd[f][j].cb != list[i].cb || fd[f][j].arg != list[i].arg))
+      j++;
+    if (j < fd[f].size())
+      list[i].cb(f, list[i].arg);
+  }
+}
+
+// This is never called with time_to_wait < 0.0:
+// It should return negative on error, 0 if nothing happens before
+// timeout, and >0 if any callbacks were done.
+int Fl_Unix_Screen_Driver::poll_or_select_with_delay(double time_to_wait) {
+  if (epoll_init() < 0)
+    return -1;
+
+  // Wait with a timerfd that expires after time_to_wait, because the
+  // timeout of epoll_wait() has only a resolution of milliseconds.
+  int timeout = -1;
+  itimerspec its = { { 0, 0 }, { 0, 0 } }; // disarmed
+  if (!unpolled.empty() || time_to_wait <= 0.0) {
+    timeout = 0;
+  } else if (time_to_wait < 2147483.648) {
+    if (timer_fd >= 0) {
+      its.it_value.tv_sec = time_t(time_to_wait);
+      its.it_value.tv_nsec = long(1000000000 * (time_to_wait - its.it_value.tv_sec));
+      if (!its.it_value.tv_sec && !its.it_value.tv_nsec)
+        its.it_value.tv_nsec = 1;
+    } else {
+      timeout = int(ceil(time_to_wait * 1000));
+    }
+  }
+  bool arm = its.it_value.tv_sec || its.it_value.tv_nsec;
+  if (arm || timer_armed) {
+    timerfd_settime(timer_fd, 0, &its, NULL);
+    timer_armed = arm;
+  }
+
+  epoll_event events[64];
+
+  fl_unlock_function();
+  int n = epoll_wait(epoll_fd, events, 64, timeout);
+  fl_lock_function();
+
+  if (n < 0)
+    return n;
+  int ret = 0;
+  for (int i = 0; i < n; i++) {
+    int f = events[i].data.fd;
+    if (f == timer_fd) {
+      uint64_t expirations;
+      if (::read(timer_fd, &expirations, sizeof(expirations)) > 0)
+        timer_armed = false;
+      continue;
+    }
+    ret++;
+    int revents = 0;
+    if (events[i].events & EPOLLIN) revents |= POLLIN;
+    if (events[i].events & EPOLLOUT) revents |= POLLOUT;
+    if (events[i].events & EPOLLPRI) revents |= POLLERR;
+    // like select(), report errors and hangups as readable and writable
+    if (events[i].events & (EPOLLERR | EPOLLHUP)) revents |= POLLIN | POLLOUT;
+    do_fd_callbacks(f, revents);
+  }
+  if (!unpolled.empty()) {
+    std::vector<int> ready(unpolled);
+    for (size_t i = 0; i < ready.size(); i++)
+      do_fd_callbacks(ready[i], POLLIN | POLLOUT);
+    ret += (int)ready.size();
+  }
+  return ret;
+}
+
+int Fl_Unix_Screen_Driver::poll_or_select() {
+  if (!nfds) return 0; // nothing to select or poll
+  if (!unpolled.empty()) return 1;
+  if (epoll_init() < 0) return -1;
+  // the epoll instance is readable if any events are pending, and polling
+  // it does not consume edge-triggered events
+  pollfd p;
+  p.fd = epoll_fd;
+  p.events = POLLIN;
+  p.revents = 0;
+  return ::poll(&p, 1, 0);
+}
+
+#else
+
 // This is never called with time_to_wait < 0.0:
 // It should return negative on error, 0 if nothing happens before
 // timeout, and >0 if any callbacks were done.
@@ -48,7 +228,12 @@ int Fl_Unix_Screen_Driver::poll_or_select_with_delay(double time_to_wait) {
   fl_unlock_function();
 
   if (time_to_wait < 2147483.648) {
-#  if USE_POLL
+#  if USE_POLL && defined(__linux__)
+    timespec t;
+    t.tv_sec = time_t(time_to_wait);
+    t.tv_nsec = long(1000000000 * (time_to_wait-t.tv_sec));
+    n = ::ppoll(pollfds, nfds, &t, NULL);
+#  elif USE_POLL
     n = ::poll(pollfds, nfds, int(time_to_wait*1000 + .5));
 #  else
     timeval t;
@@ -99,3 +284,5 @@ int Fl_Unix_Screen_Driver::poll_or_select() {
   return ::select(maxfd+1,&fdt[0],&fdt[1],&fdt[2],&t);
 #  endif
 }
+
+#endif // USE_EPOLL
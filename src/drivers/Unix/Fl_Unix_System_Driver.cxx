@@ -2,7 +2,7 @@
 // Definition of Unix/Linux system driver
 // for the Fast Light Tool Kit (FLTK).
 //
-// Copyright 2010-2024 by Bill Spitzak and others.
+// Copyright 2010-2026 by Bill Spitzak and others.
 //
 // This library is free software. Distribution and use rights are outlined in
 // the file "COPYING" which should have been included with this file.  If this
@@ -703,9 +703,49 @@ const char *Fl_Unix_System_Driver::filename_name(const char *name) {
 }
 
 
+#if USE_EPOLL
+
+void Fl_Unix_System_Driver::add_fd(int n, int events, void (*cb)(int, void*), void *v) {
+  remove_fd(n, events & ~FL_EDGE);
+  if (n < 0) return;
+  std::vector< std::vector<Fl_Unix_Screen_Driver::FD> > &fd = Fl_Unix_Screen_Driver::fd;
+  if (n >= (int)fd.size()) fd.resize(n + 1);
+  if (fd[n].empty()) Fl_Unix_Screen_Driver::nfds++;
+  Fl_Unix_Screen_Driver::FD h;
+  h.events = (short)events;
+  h.cb = cb;
+  h.arg = v;
+  fd[n].push_back(h);
+  Fl_Unix_Screen_Driver::epoll_update(n);
+}
+
+void Fl_Unix_System_Driver::add_fd(int n, void (*cb)(int, void*), void* v) {
+  add_fd(n, POLLIN, cb, v);
+}
+
+void Fl_Unix_System_Driver::remove_fd(int n, int events) {
+  std::vector< std::vector<Fl_Unix_Screen_Driver::FD> > &fd = Fl_Unix_Screen_Driver::fd;
+  if (n < 0 || n >= (int)fd.size() || fd[n].empty()) return;
+  std::vector<Fl_Unix_Screen_Driver::FD> &list = fd[n];
+  for (size_t i = 0; i < list.size(); ) {
+    int e = list[i].events & ~events;
+    if (!(e & (POLLIN | POLLOUT | POLLERR))) { // if no events left, delete this callback
+      list.erase(list.begin() + i);
+    } else {
+      list[i].events = e;
+      i++;
+    }
+  }
+  if (list.empty()) Fl_Unix_Screen_Driver::nfds--;
+  Fl_Unix_Screen_Driver::epoll_update(n);
+}
+
+#else
+
 static int fd_array_size = 0;
 
 void Fl_Unix_System_Driver::add_fd(int n, int events, void (*cb)(int, void*), void *v) {
+  events &= ~FL_EDGE; // only supported by epoll
   remove_fd(n,events);
   int i = Fl_Unix_Screen_Driver::nfds++;
   if (i >= fd_array_size) {
@@ -751,6 +791,7 @@ void Fl_Unix_System_Driver::add_fd(int n, void (*cb)(int, void*), void* v) {
 
 void Fl_Unix_System_Driver::remove_fd(int n, int events) {
   int i,j;
+  events &= ~FL_EDGE; // only supported by epoll
 # if !USE_POLL
   Fl_Unix_Screen_Driver::maxfd = -1; // recalculate maxfd on the fly
 # endif
@@ -786,6 +827,8 @@ void Fl_Unix_System_Driver::remove_fd(int n, int events) {
 #  endif
 }
 
+#endif // USE_EPOLL
+
 void Fl_Unix_System_Driver::remove_fd(int n) {
   remove_fd(n, -1);
 }
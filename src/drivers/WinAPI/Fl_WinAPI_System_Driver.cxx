@@ -1065,6 +1065,15 @@ void Fl_WinAPI_System_Driver::gettime(time_t *sec, int *usec) {
   *usec = t.millitm * 1000;
 }
 
+double Fl_WinAPI_System_Driver::monotonic_time() {
+  static LARGE_INTEGER frequency = { 0 };
+  LARGE_INTEGER count;
+  if (!frequency.QuadPart)
+    QueryPerformanceFrequency(&frequency);
+  QueryPerformanceCounter(&count);
+  return double(count.QuadPart) / double(frequency.QuadPart);
+}
+
 //
 // Code for lock support
 //
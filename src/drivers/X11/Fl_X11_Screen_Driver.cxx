@@ -1,7 +1,7 @@
 //
 // Definition of X11 Screen interface
 //
-// Copyright 1998-2025 by Bill Spitzak and others.
+// Copyright 1998-2026 by Bill Spitzak and others.
 //
 // This library is free software. Distribution and use rights are outlined in
 // the file "COPYING" which should have been included with this file.  If this
@@ -36,6 +36,11 @@
 #  include <X11/extensions/Xinerama.h>
 #endif
 
+#if HAVE_XSHM
+#  include <sys/ipc.h>
+#  include <sys/shm.h>
+#endif
+
 #  include <X11/Xutil.h>
 #  ifdef __sgi
 #    include <X11/extensions/readdisplay.h>
@@ -642,6 +647,96 @@ extern "C" {
 }
 
 
+#if HAVE_XSHM
+
+// Transfers of fewer bytes are not worth a round trip to the server, and
+// larger ones are split into blocks or done with XGetImage().
+#define SHM_MIN_SIZE 0x10000
+#define SHM_MAX_SIZE 0x1000000
+
+static XShmSegmentInfo shm_info;
+static size_t shm_size = 0;     // size of the attached segment, 0 if none
+static int shm_usable = -1;     // -1: not checked yet, 0: no, 1: yes
+static bool shm_attach_failed;
+
+extern "C" {
+  static int shm_attach_errhandler(Display *display, XErrorEvent *error) {
+    shm_attach_failed = true;
+    return 0;
+  }
+}
+
+/*
+ Returns a shared memory segment of at least size bytes that is attached to
+ the X server, or NULL if there is none.
+
+ The segment is kept for later transfers and replaced when a larger one is
+ needed. MIT-SHM is disabled for good if the extension is missing or if the
+ server can't attach the segment, which happens when the server runs on
+ another host, e.g. with ssh forwarding.
+ Callers must make sure that the server is done with the segment, by calling
+ XSync() after XShmPutImage(), before they write to it again.
+ */
+XShmSegmentInfo *Fl_X11_Screen_Driver::shm_segment(size_t size) {
+  if (shm_usable < 0) shm_usable = XShmQueryExtension(fl_display) ? 1 : 0;
+  if (!shm_usable || size < SHM_MIN_SIZE || size > SHM_MAX_SIZE) return NULL;
+  if (size <= shm_size) return &shm_info;
+  shm_release();
+  size = (size + SHM_MIN_SIZE - 1) & ~(size_t)(SHM_MIN_SIZE - 1);
+  shm_info.shmid = shmget(IPC_PRIVATE, size, IPC_CREAT | 0600);
+  if (shm_info.shmid < 0) return NULL;
+  shm_info.shmaddr = (char *)shmat(shm_info.shmid, NULL, 0);
+  if (shm_info.shmaddr == (char *)-1) {
+    shmctl(shm_info.shmid, IPC_RMID, NULL);
+    return NULL;
+  }
+  shm_info.readOnly = False;
+  // XShmAttach() fails asynchronously, catch the error
+  XSync(fl_display, False);
+  shm_attach_failed = false;
+  XErrorHandler old_handler = XSetErrorHandler(shm_attach_errhandler);
+  XShmAttach(fl_display, &shm_info);
+  XSync(fl_display, False);
+  XSetErrorHandler(old_handler);
+  // the segment goes away when both sides have detached it, even after a crash
+  shmctl(shm_info.shmid, IPC_RMID, NULL);
+  if (shm_attach_failed) {
+    shmdt(shm_info.shmaddr);
+    shm_usable = 0;
+    return NULL;
+  }
+  shm_size = size;
+  return &shm_info;
+}
+
+// Detaches the shared memory segment, if any.
+void Fl_X11_Screen_Driver::shm_release() {
+  if (!shm_size) return;
+  XShmDetach(fl_display, &shm_info);
+  XSync(fl_display, False);
+  shmdt(shm_info.shmaddr);
+  shm_size = 0;
+}
+
+// Reads a window area with XShmGetImage(), returns NULL if that is not possible.
+static XImage *shm_get_image(Window xid, int X, int Y, int w, int h) {
+  XImage *image = XShmCreateImage(fl_display, fl_visual->visual, fl_visual->depth,
+                                  ZPixmap, NULL, NULL, w, h);
+  if (!image) return NULL;
+  XShmSegmentInfo *shm =
+    Fl_X11_Screen_Driver::shm_segment((size_t)image->bytes_per_line * h);
+  if (shm) {
+    image->data = shm->shmaddr;
+    image->obdata = (char *)shm;
+    if (XShmGetImage(fl_display, xid, image, X, Y, AllPlanes))
+      return image;
+  }
+  XDestroyImage(image); // does not free the data of a shared memory image
+  return NULL;
+}
+
+#endif // HAVE_XSHM
+
 // When capturing window decoration, w is negative and X,Y,w and h are in pixels;
 // otherwise X,Y,w and h are in FLTK units.
 //
@@ -722,6 +817,10 @@ Fl_RGB_Image *Fl_X11_Screen_Driver::read_win_rectangle(int X, int Y, int w, int
       // however, if the window is obscured etc. the function will still fail. Make sure we
       // catch the error and continue, otherwise an exception will be thrown.
       XErrorHandler old_handler = XSetErrorHandler(xgetimageerrhandler);
+#if HAVE_XSHM
+      image = shm_get_image(xid, Xs, Ys, ws, hs);
+      if (!image)
+#endif
       image = XGetImage(fl_display, xid, Xs, Ys, ws, hs, AllPlanes, ZPixmap);
       XSetErrorHandler(old_handler);
     } else {
@@ -1,7 +1,7 @@
 //
 // Image drawing routines for the Fast Light Tool Kit (FLTK).
 //
-// Copyright 1998-2024 by Bill Spitzak and others.
+// Copyright 1998-2026 by Bill Spitzak and others.
 //
 // This library is free software. Distribution and use rights are outlined in
 // the file "COPYING" which should have been included with this file.  If this
@@ -55,6 +55,7 @@
 #  include "../../Fl_Screen_Driver.H"
 #  include "../../Fl_XColor.H"
 #  include "../../flstring.h"
+#  include "../../fl_pixel_convert.h"
 #if HAVE_XRENDER
 #  include <X11/extensions/Xrender.h>
 #  if RENDER_MAJOR * 100 + RENDER_MAJOR < 10
@@ -260,22 +261,11 @@ static void m565_converter(const uchar *from,uchar *to,int w, int delta) {
 // 24bit TrueColor converters:
 
 static void rgb_converter(const uchar *from, uchar *to, int w, int delta) {
-  int d = delta-3;
-  for (; w--; from += d) {
-    *to++ = *from++;
-    *to++ = *from++;
-    *to++ = *from++;
-  }
+  fl_pixel_rgb_to_24(from, to, w, delta, false);
 }
 
 static void bgr_converter(const uchar *from, uchar *to, int w, int delta) {
-  for (; w--; from += delta) {
-    uchar r = from[0];
-    uchar g = from[1];
-    *to++ = from[2];
-    *to++ = g;
-    *to++ = r;
-  }
+  fl_pixel_rgb_to_24(from, to, w, delta, true);
 }
 
 static void rrr_converter(const uchar *from, uchar *to, int w, int delta) {
@@ -287,77 +277,55 @@ static void rrr_converter(const uchar *from, uchar *to, int w, int delta) {
 }
 
 ////////////////////////////////////////////////////////////////
-// 32bit TrueColor converters on a 32 or 64-bit machine:
+// 32bit TrueColor converters on a 32 or 64-bit machine, see
+// fl_pixel_convert.cxx for their vectorized implementations:
 
 #  ifdef U64
 #    define STORETYPE U64
-#    if WORDS_BIGENDIAN
-#      define INNARDS32(f) \
-  U64 *t = (U64*)to; \
-  int w1 = w/2; \
-  for (; w1--; from += delta) {U64 i = f; from += delta; *t++ = (i<<32)|(f);} \
-  if (w&1) *t++ = (U64)(f)<<32;
-#    else
-#      define INNARDS32(f) \
-  U64 *t = (U64*)to; \
-  int w1 = w/2; \
-  for (; w1--; from += delta) {U64 i = f; from += delta; *t++ = ((U64)(f)<<32)|i;} \
-  if (w&1) *t++ = (U64)(f);
-#    endif
 #  else
 #    define STORETYPE U32
-#    define INNARDS32(f) \
-  U32 *t = (U32*)to; for (; w--; from += delta) *t++ = f
 #  endif
 
 static void rgbx_converter(const uchar *from, uchar *to, int w, int delta) {
-  INNARDS32((unsigned(from[0])<<24)+(from[1]<<16)+(from[2]<<8));
+  fl_pixel_rgb_to_32(from, to, w, delta, 24, 16, 8);
 }
 
 static void xbgr_converter(const uchar *from, uchar *to, int w, int delta) {
-  INNARDS32((from[0])+(from[1]<<8)+(from[2]<<16));
+  fl_pixel_rgb_to_32(from, to, w, delta, 0, 8, 16);
 }
 
 static void xrgb_converter(const uchar *from, uchar *to, int w, int delta) {
-  INNARDS32((from[0]<<16)+(from[1]<<8)+(from[2]));
+  fl_pixel_rgb_to_32(from, to, w, delta, 16, 8, 0);
 }
 
 static void argb_premul_converter(const uchar *from, uchar *to, int w, int delta) {
-  INNARDS32((unsigned(from[3]) << 24) +
-             (((from[0] * from[3]) / 255) << 16) +
-             (((from[1] * from[3]) / 255) << 8) +
-             ((from[2] * from[3]) / 255));
+  fl_pixel_rgba_to_argb_premul(from, to, w, delta);
 }
 
 static void depth2_to_argb_premul_converter(const uchar *from, uchar *to, int w, int delta) {
-  INNARDS32((unsigned(from[1]) << 24) +
-            (((from[0] * from[1]) / 255) << 16) +
-            (((from[0] * from[1]) / 255) << 8) +
-            ((from[0] * from[1]) / 255));
+  fl_pixel_ga_to_argb_premul(from, to, w, delta);
 }
 
 static void bgrx_converter(const uchar *from, uchar *to, int w, int delta) {
-  INNARDS32((from[0]<<8)+(from[1]<<16)+(unsigned(from[2])<<24));
+  fl_pixel_rgb_to_32(from, to, w, delta, 8, 16, 24);
 }
 
 static void rrrx_converter(const uchar *from, uchar *to, int w, int delta) {
-  INNARDS32(unsigned(*from) * 0x1010100U);
+  fl_pixel_gray_to_32(from, to, w, delta, 24, 16, 8);
 }
 
 static void xrrr_converter(const uchar *from, uchar *to, int w, int delta) {
-  INNARDS32(*from * 0x10101U);
+  fl_pixel_gray_to_32(from, to, w, delta, 16, 8, 0);
 }
 
 static void
 color32_converter(const uchar *from, uchar *to, int w, int delta) {
-  INNARDS32(
-    (from[0]<<fl_redshift)+(from[1]<<fl_greenshift)+(from[2]<<fl_blueshift));
+  fl_pixel_rgb_to_32(from, to, w, delta, fl_redshift, fl_greenshift, fl_blueshift);
 }
 
 static void
 mono32_converter(const uchar *from,uchar *to,int w, int delta) {
-  INNARDS32(
-    (*from << fl_redshift)+(*from << fl_greenshift)+(*from << fl_blueshift));
+  fl_pixel_gray_to_32(from, to, w, delta, fl_redshift, fl_greenshift, fl_blueshift);
 }
 
 ////////////////////////////////////////////////////////////////
@@ -468,6 +436,25 @@ static void figure_out_visual() {
 }
 
 #  define MAXBUFFER 0x40000 // 256k
+#  define SHM_BUFFER 0x100000 // 1M, in shared memory
+
+// Sends h lines of the converted image in xi to the window, through the
+// shared memory segment shm if it is not NULL.
+static void put_image(GC gc, int X, int Y, int w, int h, void *shm) {
+#if HAVE_XSHM
+  if (shm) {
+    int height = xi.height;
+    xi.height = h; // the server checks that the image fits in the segment
+    xi.obdata = (char *)shm;
+    XShmPutImage(fl_display, fl_window, gc, &xi, 0, 0, X, Y, w, h, False);
+    xi.obdata = NULL;
+    xi.height = height;
+    XSync(fl_display, False); // the segment is reused for the next block
+    return;
+  }
+#endif
+  XPutImage(fl_display, fl_window, gc, &xi, 0, 0, X, Y, w, h);
+}
 
 static void innards(const uchar *buf, int X, int Y, int W, int H,
                     int delta, int linedelta, int mono,
@@ -528,18 +515,35 @@ static void innards(const uchar *buf, int X, int Y, int W, int H,
   } else {
     int linesize = ((w*bytes_per_pixel+scanline_add)&scanline_mask)/sizeof(STORETYPE);
     int blocking = h;
-    static STORETYPE *buffer;   // our storage, always word aligned
+    static STORETYPE *heap_buffer;   // our storage, always word aligned
     static long buffer_size;
+    STORETYPE *buffer = NULL;
+    void *shm = NULL;
+#if HAVE_XSHM
+    // Large images are converted into a shared memory segment, so that the
+    // X server reads the pixels from there instead of from the connection.
     {int size = linesize*h;
-    if (size > MAXBUFFER) {
-      size = MAXBUFFER;
-      blocking = MAXBUFFER/linesize;
-    }
-    if (size > buffer_size) {
-      delete[] buffer;
-      buffer_size = size;
-      buffer = new STORETYPE[size];
+    if (size > SHM_BUFFER) size = SHM_BUFFER;
+    XShmSegmentInfo *info = Fl_X11_Screen_Driver::shm_segment(size*sizeof(STORETYPE));
+    if (info && size >= linesize) {
+      shm = info;
+      buffer = (STORETYPE *)info->shmaddr;
+      blocking = size/linesize;
     }}
+#endif // HAVE_XSHM
+    if (!buffer) {
+      int size = linesize*h;
+      if (size > MAXBUFFER) {
+        size = MAXBUFFER;
+        blocking = MAXBUFFER/linesize;
+      }
+      if (size > buffer_size) {
+        delete[] heap_buffer;
+        buffer_size = size;
+        heap_buffer = new STORETYPE[size];
+      }
+      buffer = heap_buffer;
+    }
     xi.data = (char *)buffer;
     xi.bytes_per_line = linesize*sizeof(STORETYPE);
     if (buf) {
@@ -552,7 +556,7 @@ static void innards(const uchar *buf, int X, int Y, int W, int H,
           buf += linedelta;
           to += linesize;
         }
-        XPutImage(fl_display,fl_window,gc, &xi, 0, 0, X+dx, Y+dy+j-k, w, k);
+        put_image(gc, X+dx, Y+dy+j-k, w, k, shm);
       }
     } else {
       STORETYPE* linebuf = new STORETYPE[(W*delta+(sizeof(STORETYPE)-1))/sizeof(STORETYPE)];
@@ -564,7 +568,7 @@ static void innards(const uchar *buf, int X, int Y, int W, int H,
           conv((uchar*)linebuf, (uchar*)to, w, delta);
           to += linesize;
         }
-        XPutImage(fl_display,fl_window,gc, &xi, 0, 0, X+dx, Y+dy+j-k, w, k);
+        put_image(gc, X+dx, Y+dy+j-k, w, k, shm);
       }
 
       delete[] linebuf;
@@ -843,7 +847,7 @@ int Fl_Xlib_Graphics_Driver::scale_and_render_pixmap(Fl_Offscreen pixmap, int de
       { XDoubleToFixed( 0 ),       XDoubleToFixed( 0 ),       XDoubleToFixed( 1 ) }
     }};
     XRenderSetPictureTransform(fl_display, src, &mat);
-    if (Fl_Image::scaling_algorithm() == FL_RGB_SCALING_BILINEAR) {
+    if (Fl_Image::scaling_algorithm() != FL_RGB_SCALING_NEAREST) {
       XRenderSetPictureFilter(fl_display, src, FilterBilinear, 0, 0);
       // A note at  https://www.talisman.org/~erlkonig/misc/x11-composite-tutorial/ :
       // "When you use a filter you'll probably want to use PictOpOver as the render op,
@@ -0,0 +1,475 @@
+//
+// Image scaling kernels for the Fast Light Tool Kit (FLTK).
+//
+// Copyright 2026 by Bill Spitzak and others.
+//
+// This library is free software. Distribution and use rights are outlined in
+// the file "COPYING" which should have been included with this file.  If this
+// file is missing or damaged, see the license at:
+//
+//     https://www.fltk.org/COPYING.php
+//
+// Please see the following page on how to report bugs and issues:
+//
+//     https://www.fltk.org/bugs.php
+//
+
+#include <config.h>
+#include "fl_image_scale.h"
+#include "fl_simd.h"
+
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+
+#if HAVE_PTHREAD || defined(_MSC_VER)
+#  define FL_SCALE_THREADS 1
+#  include <thread>
+#  include <system_error>
+#else
+#  define FL_SCALE_THREADS 0
+#endif
+
+/*
+ Area weights are fixed point numbers with 14 fraction bits, the weights of
+ the source pixels of a destination pixel add up to exactly area_one.
+ The vertical pass sums up to 255 * area_one per channel in 32 bits, the
+ horizontal pass rounds these sums to 8.8 fixed point and weights them
+ again, which stays below 2^32 as well.
+ */
+static const int area_bits = 14;
+static const int area_one = 1 << area_bits;
+
+// Bands with fewer source bytes are not worth starting a thread for
+static const long band_min_bytes = 256 * 1024;
+
+// ---- plain C++ ------------------------------------------------------------
+
+// acc[i] += a[i] * wa + b[i] * wb
+static void accumulate_c(uint32_t *acc, const uchar *a, const uchar *b, int n, int wa, int wb) {
+  for (int i = 0; i < n; i++)
+    acc[i] += a[i] * (uint32_t)wa + b[i] * (uint32_t)wb;
+}
+
+// dst[i] = (t[i] * w0 + b[i] * w1 + 32768) >> 16
+static void blend_c(uchar *dst, const uint16_t *t, const uint16_t *b, int n, int w0, int w1) {
+  for (int i = 0; i < n; i++)
+    dst[i] = (uchar)((t[i] * (uint32_t)w0 + b[i] * (uint32_t)w1 + 32768) >> 16);
+}
+
+// dst[i] = (a[i] + b[i]) >> 1
+static void halve_v_c(uchar *dst, const uchar *a, const uchar *b, int n) {
+  for (int i = 0; i < n; i++)
+    dst[i] = (uchar)((a[i] + b[i]) >> 1);
+}
+
+// Halves w pixels of depth d horizontally
+static void halve_h_c(uchar *dst, const uchar *src, int w, int d) {
+  for (int x = 0; x < w; x++, src += 2 * d)
+    for (int c = 0; c < d; c++)
+      *dst++ = (uchar)((src[c] + src[c + d]) >> 1);
+}
+
+// ---- SSE2 -----------------------------------------------------------------
+
+#if FL_SIMD_SSE2
+
+static void accumulate_sse2(uint32_t *acc, const uchar *a, const uchar *b, int n, int wa, int wb) {
+  const __m128i weights = _mm_set1_epi32((wb << 16) | wa);
+  const __m128i zero = _mm_setzero_si128();
+  int i = 0;
+  for (; i + 16 <= n; i += 16) {
+    // interleave the bytes of both rows, so that madd computes a * wa + b * wb
+    __m128i va = _mm_loadu_si128((const __m128i *)(a + i));
+    __m128i vb = _mm_loadu_si128((const __m128i *)(b + i));
+    __m128i lo = _mm_unpacklo_epi8(va, vb);
+    __m128i hi = _mm_unpackhi_epi8(va, vb);
+    __m128i *p = (__m128i *)(acc + i);
+    __m128i s0 = _mm_madd_epi16(_mm_unpacklo_epi8(lo, zero), weights);
+    __m128i s1 = _mm_madd_epi16(_mm_unpackhi_epi8(lo, zero), weights);
+    __m128i s2 = _mm_madd_epi16(_mm_unpacklo_epi8(hi, zero), weights);
+    __m128i s3 = _mm_madd_epi16(_mm_unpackhi_epi8(hi, zero), weights);
+    _mm_storeu_si128(p, _mm_add_epi32(_mm_loadu_si128(p), s0));
+    _mm_storeu_si128(p + 1, _mm_add_epi32(_mm_loadu_si128(p + 1), s1));
+    _mm_storeu_si128(p + 2, _mm_add_epi32(_mm_loadu_si128(p + 2), s2));
+    _mm_storeu_si128(p + 3, _mm_add_epi32(_mm_loadu_si128(p + 3), s3));
+  }
+  accumulate_c(acc + i, a + i, b + i, n - i, wa, wb);
+}
+
+// (t * w0 + b * w1 + 32768) >> 16 for 8 16-bit values, w0, w1 <= 256
+static inline __m128i blend8_sse2(__m128i t, __m128i b, __m128i w0, __m128i w1) {
+  const __m128i half = _mm_set1_epi32(32768);
+  __m128i tl = _mm_mullo_epi16(t, w0), th = _mm_mulhi_epu16(t, w0);
+  __m128i bl = _mm_mullo_epi16(b, w1), bh = _mm_mulhi_epu16(b, w1);
+  __m128i lo = _mm_add_epi32(_mm_unpacklo_epi16(tl, th), _mm_unpacklo_epi16(bl, bh));
+  __m128i hi = _mm_add_epi32(_mm_unpackhi_epi16(tl, th), _mm_unpackhi_epi16(bl, bh));
+  lo = _mm_srli_epi32(_mm_add_epi32(lo, half), 16);
+  hi = _mm_srli_epi32(_mm_add_epi32(hi, half), 16);
+  return _mm_packs_epi32(lo, hi);
+}
+
+static void blend_sse2(uchar *dst, const uint16_t *t, const uint16_t *b, int n, int w0, int w1) {
+  const __m128i v0 = _mm_set1_epi16((short)w0);
+  const __m128i v1 = _mm_set1_epi16((short)w1);
+  int i = 0;
+  for (; i + 16 <= n; i += 16) {
+    __m128i lo = blend8_sse2(_mm_loadu_si128((const __m128i *)(t + i)),
+                             _mm_loadu_si128((const __m128i *)(b + i)), v0, v1);
+    __m128i hi = blend8_sse2(_mm_loadu_si128((const __m128i *)(t + i + 8)),
+                             _mm_loadu_si128((const __m128i *)(b + i + 8)), v0, v1);
+    _mm_storeu_si128((__m128i *)(dst + i), _mm_packus_epi16(lo, hi));
+  }
+  blend_c(dst + i, t + i, b + i, n - i, w0, w1);
+}
+
+// (a + b) >> 1 without the rounding of _mm_avg_epu8()
+static inline __m128i halve16_sse2(__m128i a, __m128i b) {
+  return _mm_sub_epi8(_mm_avg_epu8(a, b), _mm_and_si128(_mm_xor_si128(a, b), _mm_set1_epi8(1)));
+}
+
+static void halve_v_sse2(uchar *dst, const uchar *a, const uchar *b, int n) {
+  int i = 0;
+  for (; i + 16 <= n; i += 16) {
+    __m128i v = halve16_sse2(_mm_loadu_si128((const __m128i *)(a + i)),
+                             _mm_loadu_si128((const __m128i *)(b + i)));
+    _mm_storeu_si128((__m128i *)(dst + i), v);
+  }
+  halve_v_c(dst + i, a + i, b + i, n - i);
+}
+
+#endif // FL_SIMD_SSE2
+
+// ---- AVX2 -----------------------------------------------------------------
+
+#if FL_SIMD_AVX2
+
+FL_TARGET_AVX2
+static void accumulate_avx2(uint32_t *acc, const uchar *a, const uchar *b, int n, int wa, int wb) {
+  const __m256i weights = _mm256_set1_epi32((wb << 16) | wa);
+  int i = 0;
+  for (; i + 8 <= n; i += 8) {
+    // a in the low and b in the high 16 bits of each 32-bit lane
+    __m256i va = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(a + i)));
+    __m256i vb = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(b + i)));
+    __m256i s = _mm256_madd_epi16(_mm256_or_si256(va, _mm256_slli_epi32(vb, 16)), weights);
+    __m256i *p = (__m256i *)(acc + i);
+    _mm256_storeu_si256(p, _mm256_add_epi32(_mm256_loadu_si256(p), s));
+  }
+  accumulate_c(acc + i, a + i, b + i, n - i, wa, wb);
+}
+
+FL_TARGET_AVX2
+static inline __m256i blend16_avx2(__m256i t, __m256i b, __m256i w0, __m256i w1) {
+  const __m256i half = _mm256_set1_epi32(32768);
+  __m256i tl = _mm256_mullo_epi16(t, w0), th = _mm256_mulhi_epu16(t, w0);
+  __m256i bl = _mm256_mullo_epi16(b, w1), bh = _mm256_mulhi_epu16(b, w1);
+  __m256i lo = _mm256_add_epi32(_mm256_unpacklo_epi16(tl, th), _mm256_unpacklo_epi16(bl, bh));
+  __m256i hi = _mm256_add_epi32(_mm256_unpackhi_epi16(tl, th), _mm256_unpackhi_epi16(bl, bh));
+  lo = _mm256_srli_epi32(_mm256_add_epi32(lo, half), 16);
+  hi = _mm256_srli_epi32(_mm256_add_epi32(hi, half), 16);
+  return _mm256_packs_epi32(lo, hi); // in-lane, which restores the order of t and b
+}
+
+FL_TARGET_AVX2
+static void blend_avx2(uchar *dst, const uint16_t *t, const uint16_t *b, int n, int w0, int w1) {
+  const __m256i v0 = _mm256_set1_epi16((short)w0);
+  const __m256i v1 = _mm256_set1_epi16((short)w1);
+  int i = 0;
+  for (; i + 32 <= n; i += 32) {
+    __m256i lo = blend16_avx2(_mm256_loadu_si256((const __m256i *)(t + i)),
+                              _mm256_loadu_si256((const __m256i *)(b + i)), v0, v1);
+    __m256i hi = blend16_avx2(_mm256_loadu_si256((const __m256i *)(t + i + 16)),
+                              _mm256_loadu_si256((const __m256i *)(b + i + 16)), v0, v1);
+    __m256i v = _mm256_permute4x64_epi64(_mm256_packus_epi16(lo, hi), _MM_SHUFFLE(3, 1, 2, 0));
+    _mm256_storeu_si256((__m256i *)(dst + i), v);
+  }
+  blend_sse2(dst + i, t + i, b + i, n - i, w0, w1);
+}
+
+FL_TARGET_AVX2
+static void halve_v_avx2(uchar *dst, const uchar *a, const uchar *b, int n) {
+  const __m256i one = _mm256_set1_epi8(1);
+  int i = 0;
+  for (; i + 32 <= n; i += 32) {
+    __m256i va = _mm256_loadu_si256((const __m256i *)(a + i));
+    __m256i vb = _mm256_loadu_si256((const __m256i *)(b + i));
+    __m256i v = _mm256_sub_epi8(_mm256_avg_epu8(va, vb),
+                                _mm256_and_si256(_mm256_xor_si256(va, vb), one));
+    _mm256_storeu_si256((__m256i *)(dst + i), v);
+  }
+  halve_v_sse2(dst + i, a + i, b + i, n - i);
+}
+
+/*
+ Averages every pixel with its right neighbor, then picks every other pixel
+ from the 16 bytes with a byte shuffle. Each step writes 16 bytes, of which
+ the first 8 (9 for depth 3) are kept.
+ */
+FL_TARGET_AVX2
+static void halve_h_avx2(uchar *dst, const uchar *src, int w, int d) {
+  static const signed char pick[4][16] = {
+    { 0, 2, 4, 6, 8, 10, 12, 14, -1, -1, -1, -1, -1, -1, -1, -1 },
+    { 0, 1, 4, 5, 8, 9, 12, 13, -1, -1, -1, -1, -1, -1, -1, -1 },
+    { 0, 1, 2, 6, 7, 8, 12, 13, 14, -1, -1, -1, -1, -1, -1, -1 },
+    { 0, 1, 2, 3, 8, 9, 10, 11, -1, -1, -1, -1, -1, -1, -1, -1 }
+  };
+  static const int step[4] = { 8, 4, 3, 2 }; // destination pixels per step
+  int x = 0;
+  if (d >= 1 && d <= 4) {
+    const __m128i order = _mm_loadu_si128((const __m128i *)pick[d - 1]);
+    const int n = step[d - 1];
+    // the source row has at least 2 * w pixels, each step reads d + 16 bytes
+    // of the source and writes 16 bytes of the destination
+    for (; 2 * x * d + d + 16 <= 2 * w * d && x * d + 16 <= w * d; x += n) {
+      const uchar *s = src + 2 * x * d;
+      __m128i a = _mm_loadu_si128((const __m128i *)s);
+      __m128i b = _mm_loadu_si128((const __m128i *)(s + d));
+      _mm_storeu_si128((__m128i *)(dst + x * d), _mm_shuffle_epi8(halve16_sse2(a, b), order));
+    }
+  }
+  halve_h_c(dst + x * d, src + 2 * x * d, w - x, d);
+}
+
+#endif // FL_SIMD_AVX2
+
+// ---- dispatch -------------------------------------------------------------
+
+static int scale_level = -1;
+static void (*accumulate_fn)(uint32_t *, const uchar *, const uchar *, int, int, int) = accumulate_c;
+static void (*blend_fn)(uchar *, const uint16_t *, const uint16_t *, int, int, int) = blend_c;
+static void (*halve_v_fn)(uchar *, const uchar *, const uchar *, int) = halve_v_c;
+static void (*halve_h_fn)(uchar *, const uchar *, int, int) = halve_h_c;
+
+int fl_image_scale_level(int level) {
+  if (level < 0) {
+    if (scale_level >= 0)
+      return scale_level;
+    level = 2;
+  }
+  if (level >= 2 && !(FL_SIMD_AVX2 && fl_cpu_has_avx2()))
+    level = 1;
+  if (level >= 1 && !FL_SIMD_SSE2)
+    level = 0;
+  accumulate_fn = accumulate_c;
+  blend_fn = blend_c;
+  halve_v_fn = halve_v_c;
+  halve_h_fn = halve_h_c;
+#if FL_SIMD_SSE2
+  if (level == 1) {
+    accumulate_fn = accumulate_sse2;
+    blend_fn = blend_sse2;
+    halve_v_fn = halve_v_sse2;
+  }
+#endif
+#if FL_SIMD_AVX2
+  if (level == 2) {
+    accumulate_fn = accumulate_avx2;
+    blend_fn = blend_avx2;
+    halve_v_fn = halve_v_avx2;
+    halve_h_fn = halve_h_avx2;
+  }
+#endif
+  scale_level = level;
+  return level;
+}
+
+// ---- area averaging -------------------------------------------------------
+
+/*
+ Computes the source pixels and weights of n destination pixels along an
+ axis of s source pixels. Destination pixel i covers [i*s, (i+1)*s) and
+ source pixel j covers [j*n, (j+1)*n) in units of 1/n source pixels.
+ */
+static void area_taps(int s, int n, std::vector<int> &first, std::vector<int> &count,
+                      std::vector<int> &weight) {
+  first.resize(n);
+  count.resize(n);
+  weight.clear();
+  for (int i = 0; i < n; i++) {
+    int64_t start = (int64_t)i * s, end = start + s;
+    int j = (int)(start / n);
+    first[i] = j;
+    int k = 0, done = 0;
+    for (; (int64_t)j * n < end && j < s; j++, k++) {
+      int64_t e = (int64_t)(j + 1) * n;
+      if (e > end) e = end;
+      // cumulative weights telescope, so that every pixel gets exactly area_one
+      int cum = (int)(((e - start) * area_one + s / 2) / s);
+      weight.push_back(cum - done);
+      done = cum;
+    }
+    count[i] = k;
+  }
+}
+
+void fl_scale_area(const uchar *src, int sw, int sh, int sld, int d,
+                   uchar *dst, int w, int h, int y0, int y1) {
+  std::vector<int> xfirst, xcount, xweight, yfirst, ycount, yweight;
+  area_taps(sw, w, xfirst, xcount, xweight);
+  area_taps(sh, h, yfirst, ycount, yweight);
+  int n = sw * d;
+  std::vector<uint32_t> acc(n);
+  // position of the weights of row y0
+  size_t yk = 0;
+  for (int y = 0; y < y0; y++)
+    yk += ycount[y];
+  for (int y = y0; y < y1; y++) {
+    // vertical pass, two source rows at a time
+    memset(&acc[0], 0, n * sizeof(uint32_t));
+    const int *wy = &yweight[yk];
+    const uchar *row = src + (long)yfirst[y] * sld;
+    int k = 0;
+    for (; k + 2 <= ycount[y]; k += 2, row += 2 * sld)
+      accumulate_fn(&acc[0], row, row + sld, n, wy[k], wy[k + 1]);
+    if (k < ycount[y])
+      accumulate_fn(&acc[0], row, row, n, wy[k], 0);
+    yk += ycount[y];
+    // horizontal pass
+    uchar *out = dst + (long)y * w * d;
+    const int *wx = &xweight[0];
+    for (int x = 0; x < w; x++) {
+      const uint32_t *a = &acc[xfirst[x] * d];
+      for (int c = 0; c < d; c++) {
+        uint32_t sum = 0;
+        for (int j = 0; j < xcount[x]; j++)
+          sum += wx[j] * ((a[j * d + c] + 32) >> 6);
+        *out++ = (uchar)((sum + (1 << 21)) >> 22);
+      }
+      wx += xcount[x];
+    }
+  }
+}
+
+// ---- bilinear interpolation -----------------------------------------------
+
+/*
+ Maps n destination pixels to two source pixels and the 8-bit weight of the
+ second one, pixel center to pixel center. This is the mapping of the
+ previous scalar implementation in Fl_Image.cxx, so that results don't change.
+ */
+static void bilinear_taps(uint32_t s, uint32_t n, uint32_t mul, std::vector<uint32_t> &off0,
+                          std::vector<uint32_t> &off1, std::vector<uint32_t> &weight) {
+  off0.resize(n);
+  off1.resize(n);
+  weight.resize(n);
+  for (uint32_t i = 0; i < n; ++i) {
+    float si = ((i + 0.5f) * s) / (float)n - 0.5f;
+    int32_t i0 = (int32_t)si;
+    if (si < 0.0f && (float)i0 != si) i0--; // floor for negatives
+    float f = si - i0;
+    if (i0 < 0) {
+      i0 = 0;
+      f = 0.0f;
+    } else if (i0 >= (int32_t)s - 1) {
+      i0 = s - 1;
+      f = 0.0f;
+    }
+    uint32_t i1 = (i0 < (int32_t)s - 1) ? (i0 + 1) : i0;
+    int32_t wi = (int32_t)(f * 256.0f + 0.5f);
+    if (wi < 0) wi = 0;
+    else if (wi > 256) wi = 256;
+    off0[i] = i0 * mul;
+    off1[i] = i1 * mul;
+    weight[i] = wi;
+  }
+}
+
+void fl_scale_bilinear(const uchar *src, int sw, int sh, int sld, int d,
+                       uchar *dst, int w, int h, int y0, int y1) {
+  std::vector<uint32_t> x0_off, x1_off, wx1, y0_off, y1_off, wy1;
+  bilinear_taps(sw, w, d, x0_off, x1_off, wx1);
+  bilinear_taps(sh, h, sld, y0_off, y1_off, wy1);
+  // horizontally interpolated source rows, neighboring rows share them
+  const int n = w * d;
+  std::vector<uint16_t> rows(2 * n);
+  uint16_t *cached[2] = { &rows[0], &rows[n] };
+  long cached_off[2] = { -1, -1 };
+  for (int y = y0; y < y1; y++) {
+    uint32_t offs[2] = { y0_off[y], y1_off[y] };
+    int slot[2];
+    for (int r = 0; r < 2; r++) {
+      int k = (cached_off[0] == (long)offs[r]) ? 0 : (cached_off[1] == (long)offs[r]) ? 1 : -1;
+      if (k < 0) {
+        // don't replace the row that the other source row needs
+        k = (r == 0) ? (cached_off[0] == (long)offs[1] ? 1 : 0) : 1 - slot[0];
+        const uchar *row = src + offs[r];
+        uint16_t *t = cached[k];
+        for (int x = 0; x < w; x++) {
+          const uchar *p0 = row + x0_off[x], *p1 = row + x1_off[x];
+          uint32_t w1 = wx1[x], w0 = 256 - w1;
+          for (int c = 0; c < d; c++)
+            *t++ = (uint16_t)(p0[c] * w0 + p1[c] * w1);
+        }
+        cached_off[k] = offs[r];
+      }
+      slot[r] = k;
+    }
+    blend_fn(dst + (long)y * n, cached[slot[0]], cached[slot[1]], n, 256 - wy1[y], wy1[y]);
+  }
+}
+
+// ---- halving --------------------------------------------------------------
+
+void fl_scale_halve_h(const uchar *src, int sw, int sld, int d,
+                      uchar *dst, int y0, int y1) {
+  int w = sw / 2;
+  for (int y = y0; y < y1; y++)
+    halve_h_fn(dst + (long)y * w * d, src + (long)y * sld, w, d);
+}
+
+void fl_scale_halve_v(const uchar *src, int sw, int sld, int d,
+                      uchar *dst, int y0, int y1) {
+  for (int y = y0; y < y1; y++) {
+    const uchar *s = src + 2L * y * sld;
+    halve_v_fn(dst + (long)y * sw * d, s, s + sld, sw * d);
+  }
+}
+
+// ---- threads --------------------------------------------------------------
+
+#if FL_SCALE_THREADS
+
+struct Band {
+  void (*fn)(void *, int, int);
+  void *data;
+  int y0, y1;
+};
+
+static void run_band(Band b) {
+  b.fn(b.data, b.y0, b.y1);
+}
+
+#endif // FL_SCALE_THREADS
+
+void fl_scale_bands(int rows, long bytes, int threads,
+                    void (*fn)(void *data, int y0, int y1), void *data) {
+  // select the kernels before any thread uses them
+  if (scale_level < 0) fl_image_scale_level();
+#if FL_SCALE_THREADS
+  if (threads > rows) threads = rows;
+  if (threads > bytes / band_min_bytes) threads = (int)(bytes / band_min_bytes);
+  if (threads > 1) {
+    std::vector<std::thread> workers;
+    int y = 0;
+    for (int i = 0; i < threads; i++) {
+      int next = (int)((long)rows * (i + 1) / threads);
+      Band b = { fn, data, y, next };
+      if (i == threads - 1) {
+        run_band(b); // the last band runs in the calling thread
+      } else {
+        try {
+          workers.push_back(std::thread(run_band, b));
+        } catch (const std::system_error &) {
+          run_band(b);
+        }
+      }
+      y = next;
+    }
+    for (size_t i = 0; i < workers.size(); i++)
+      workers[i].join();
+    return;
+  }
+#endif // FL_SCALE_THREADS
+  fn(data, 0, rows);
+}
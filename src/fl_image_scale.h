@@ -0,0 +1,67 @@
+//
+// Image scaling kernels for the Fast Light Tool Kit (FLTK).
+//
+// Copyright 2026 by Bill Spitzak and others.
+//
+// This library is free software. Distribution and use rights are outlined in
+// the file "COPYING" which should have been included with this file.  If this
+// file is missing or damaged, see the license at:
+//
+//     https://www.fltk.org/COPYING.php
+//
+// Please see the following page on how to report bugs and issues:
+//
+//     https://www.fltk.org/bugs.php
+//
+
+/*
+ Internal use only.
+
+ Scaling functions used by Fl_RGB_Image::copy(int, int). They read an image
+ of sw x sh pixels with d bytes per pixel and sld bytes per line, and write
+ the rows y0 to y1 - 1 of a packed image of w x h pixels. Different row
+ ranges of the same image can be computed concurrently, see fl_scale_bands().
+ The kernels don't select their implementation themselves: call them through
+ fl_scale_bands(), or call fl_image_scale_level() first.
+
+ The implementation is selected at runtime: AVX2 if the CPU supports it,
+ otherwise SSE2 or plain C++. See fl_image_scale_level(). All levels
+ produce identical results.
+*/
+
+#ifndef _src_fl_image_scale_h_
+#define _src_fl_image_scale_h_
+
+#include <FL/fl_types.h>
+
+// Area averaging (box filter): every pixel is the mean of the source area
+// that it covers, weighted by the covered fraction of each source pixel.
+void fl_scale_area(const uchar *src, int sw, int sh, int sld, int d,
+                   uchar *dst, int w, int h, int y0, int y1);
+
+// Bilinear interpolation between the 4 source pixels around the center of
+// every pixel.
+void fl_scale_bilinear(const uchar *src, int sw, int sh, int sld, int d,
+                       uchar *dst, int w, int h, int y0, int y1);
+
+// Halving: every pixel is the truncated mean of 2 pixels of the source,
+// horizontally neighbors (w = sw / 2, h = sh) or vertically (w = sw,
+// h = sh / 2).
+void fl_scale_halve_h(const uchar *src, int sw, int sld, int d,
+                      uchar *dst, int y0, int y1);
+void fl_scale_halve_v(const uchar *src, int sw, int sld, int d,
+                      uchar *dst, int y0, int y1);
+
+// Calls fn(data, y0, y1) for bands of consecutive rows that cover rows 0 to
+// rows - 1, in up to the given number of threads if the source image has
+// enough bytes to make that worthwhile. Returns when all bands are done.
+void fl_scale_bands(int rows, long bytes, int threads,
+                    void (*fn)(void *data, int y0, int y1), void *data);
+
+// Selects the implementation: 0 = plain C++, 1 = SSE2, 2 = AVX2.
+// Levels that are not supported by the CPU or the build fall back to the
+// highest supported level. Returns the level that is used. Pass -1 to query
+// the current level without changing it.
+int fl_image_scale_level(int level = -1);
+
+#endif // _src_fl_image_scale_h_
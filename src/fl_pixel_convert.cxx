@@ -0,0 +1,391 @@
+//
+// Pixel format conversion kernels for the Fast Light Tool Kit (FLTK).
+//
+// Copyright 2026 by Bill Spitzak and others.
+//
+// This library is free software. Distribution and use rights are outlined in
+// the file "COPYING" which should have been included with this file.  If this
+// file is missing or damaged, see the license at:
+//
+//     https://www.fltk.org/COPYING.php
+//
+// Please see the following page on how to report bugs and issues:
+//
+//     https://www.fltk.org/bugs.php
+//
+
+#include <config.h>
+#include "fl_pixel_convert.h"
+#include "fl_simd.h"
+
+#include <string.h>
+
+// Exact a*b/255 for a, b <= 255
+static inline unsigned mul255_(unsigned a, unsigned b) {
+  return (a * b) / 255;
+}
+
+// ---- plain C++ ------------------------------------------------------------
+
+static void rgb_to_32_c(const uchar *from, uchar *to, int w, int delta,
+                        int rs, int gs, int bs) {
+  U32 *t = (U32 *)to;
+  for (; w-- > 0; from += delta)
+    *t++ = (U32(from[0]) << rs) + (U32(from[1]) << gs) + (U32(from[2]) << bs);
+}
+
+static void gray_to_32_c(const uchar *from, uchar *to, int w, int delta,
+                         int rs, int gs, int bs) {
+  U32 *t = (U32 *)to;
+  for (; w-- > 0; from += delta)
+    *t++ = (U32(*from) << rs) + (U32(*from) << gs) + (U32(*from) << bs);
+}
+
+static void rgb_to_24_c(const uchar *from, uchar *to, int w, int delta, bool bgr) {
+  if (!bgr && delta == 3) {
+    memcpy(to, from, (size_t)w * 3);
+    return;
+  }
+  for (; w-- > 0; from += delta, to += 3) {
+    uchar r = from[0], g = from[1], b = from[2];
+    to[0] = bgr ? b : r;
+    to[1] = g;
+    to[2] = bgr ? r : b;
+  }
+}
+
+static void rgba_premul_c(const uchar *from, uchar *to, int w, int delta) {
+  U32 *t = (U32 *)to;
+  for (; w-- > 0; from += delta) {
+    unsigned a = from[3];
+    *t++ = (U32(a) << 24) + (mul255_(from[0], a) << 16) +
+           (mul255_(from[1], a) << 8) + mul255_(from[2], a);
+  }
+}
+
+static void ga_premul_c(const uchar *from, uchar *to, int w, int delta) {
+  U32 *t = (U32 *)to;
+  for (; w-- > 0; from += delta) {
+    unsigned a = from[1];
+    *t++ = (U32(a) << 24) + mul255_(from[0], a) * 0x10101U;
+  }
+}
+
+// ---- SSE2 -----------------------------------------------------------------
+
+#if FL_SIMD_SSE2
+
+/*
+ The vector code computes x/255 for the 16-bit products x = a*b of two bytes
+ as (x + (x >> 8) + 1) >> 8, which is exact for all x <= 255*255.
+ */
+static inline __m128i div255_sse2(__m128i x) {
+  x = _mm_add_epi16(_mm_add_epi16(x, _mm_srli_epi16(x, 8)), _mm_set1_epi16(1));
+  return _mm_srli_epi16(x, 8);
+}
+
+// Moves the bytes R, G, B of 32-bit lanes R | G<<8 | B<<16 to their shifts
+static inline __m128i place_sse2(__m128i v, __m128i rs, __m128i gs, __m128i bs) {
+  const __m128i m = _mm_set1_epi32(0xff);
+  __m128i r = _mm_and_si128(v, m);
+  __m128i g = _mm_and_si128(_mm_srli_epi32(v, 8), m);
+  __m128i b = _mm_and_si128(_mm_srli_epi32(v, 16), m);
+  return _mm_add_epi32(_mm_add_epi32(_mm_sll_epi32(r, rs), _mm_sll_epi32(g, gs)),
+                       _mm_sll_epi32(b, bs));
+}
+
+// Premultiplies 2 RGBA pixels in 16-bit lanes and reorders them to B, G, R, A
+static inline __m128i premul2_sse2(__m128i v) {
+  const __m128i keep_alpha = _mm_set_epi16(-1, 0, 0, 0, -1, 0, 0, 0);
+  __m128i a = _mm_shufflehi_epi16(_mm_shufflelo_epi16(v, 0xff), 0xff);
+  __m128i p = div255_sse2(_mm_mullo_epi16(v, a));
+  p = _mm_shufflehi_epi16(_mm_shufflelo_epi16(p, _MM_SHUFFLE(3, 0, 1, 2)),
+                          _MM_SHUFFLE(3, 0, 1, 2));
+  return _mm_or_si128(_mm_andnot_si128(keep_alpha, p), _mm_and_si128(keep_alpha, v));
+}
+
+// Premultiplies 4 gray + alpha pixels in 32-bit lanes V | A<<16
+static inline __m128i ga_premul4_sse2(__m128i v) {
+  __m128i a = _mm_srli_epi32(v, 16);
+  __m128i p = div255_sse2(_mm_mullo_epi16(v, a));
+  p = _mm_or_si128(p, _mm_or_si128(_mm_slli_epi32(p, 8), _mm_slli_epi32(p, 16)));
+  return _mm_or_si128(p, _mm_slli_epi32(a, 24));
+}
+
+static void rgb_to_32_sse2(const uchar *from, uchar *to, int w, int delta,
+                           int rs, int gs, int bs) {
+  int i = 0;
+  if (delta == 4) {
+    const __m128i vr = _mm_cvtsi32_si128(rs);
+    const __m128i vg = _mm_cvtsi32_si128(gs);
+    const __m128i vb = _mm_cvtsi32_si128(bs);
+    for (; i + 4 <= w; i += 4) {
+      __m128i v = _mm_loadu_si128((const __m128i *)(from + 4 * i));
+      _mm_storeu_si128((__m128i *)(to + 4 * i), place_sse2(v, vr, vg, vb));
+    }
+  }
+  rgb_to_32_c(from + delta * i, to + 4 * i, w - i, delta, rs, gs, bs);
+}
+
+static void gray_to_32_sse2(const uchar *from, uchar *to, int w, int delta,
+                            int rs, int gs, int bs) {
+  int i = 0;
+  if (delta == 1) {
+    const __m128i vr = _mm_cvtsi32_si128(rs);
+    const __m128i vg = _mm_cvtsi32_si128(gs);
+    const __m128i vb = _mm_cvtsi32_si128(bs);
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 16 <= w; i += 16) {
+      __m128i v = _mm_loadu_si128((const __m128i *)(from + i));
+      __m128i lo = _mm_unpacklo_epi8(v, zero);
+      __m128i hi = _mm_unpackhi_epi8(v, zero);
+      __m128i q[4] = { _mm_unpacklo_epi16(lo, zero), _mm_unpackhi_epi16(lo, zero),
+                       _mm_unpacklo_epi16(hi, zero), _mm_unpackhi_epi16(hi, zero) };
+      for (int k = 0; k < 4; k++) {
+        __m128i p = _mm_add_epi32(_mm_add_epi32(_mm_sll_epi32(q[k], vr),
+                                                _mm_sll_epi32(q[k], vg)),
+                                  _mm_sll_epi32(q[k], vb));
+        _mm_storeu_si128((__m128i *)(to + 4 * (i + 4 * k)), p);
+      }
+    }
+  }
+  gray_to_32_c(from + delta * i, to + 4 * i, w - i, delta, rs, gs, bs);
+}
+
+static void rgba_premul_sse2(const uchar *from, uchar *to, int w, int delta) {
+  int i = 0;
+  if (delta == 4) {
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 4 <= w; i += 4) {
+      __m128i v = _mm_loadu_si128((const __m128i *)(from + 4 * i));
+      __m128i lo = premul2_sse2(_mm_unpacklo_epi8(v, zero));
+      __m128i hi = premul2_sse2(_mm_unpackhi_epi8(v, zero));
+      _mm_storeu_si128((__m128i *)(to + 4 * i), _mm_packus_epi16(lo, hi));
+    }
+  }
+  rgba_premul_c(from + delta * i, to + 4 * i, w - i, delta);
+}
+
+static void ga_premul_sse2(const uchar *from, uchar *to, int w, int delta) {
+  int i = 0;
+  if (delta == 2) {
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 8 <= w; i += 8) {
+      __m128i v = _mm_loadu_si128((const __m128i *)(from + 2 * i));
+      _mm_storeu_si128((__m128i *)(to + 4 * i), ga_premul4_sse2(_mm_unpacklo_epi8(v, zero)));
+      _mm_storeu_si128((__m128i *)(to + 4 * i + 16), ga_premul4_sse2(_mm_unpackhi_epi8(v, zero)));
+    }
+  }
+  ga_premul_c(from + delta * i, to + 4 * i, w - i, delta);
+}
+
+#endif // FL_SIMD_SSE2
+
+// ---- AVX2 -----------------------------------------------------------------
+
+#if FL_SIMD_AVX2
+
+FL_TARGET_AVX2
+static inline __m256i div255_avx2(__m256i x) {
+  x = _mm256_add_epi16(_mm256_add_epi16(x, _mm256_srli_epi16(x, 8)), _mm256_set1_epi16(1));
+  return _mm256_srli_epi16(x, 8);
+}
+
+FL_TARGET_AVX2
+static inline __m256i place_avx2(__m256i v, __m128i rs, __m128i gs, __m128i bs) {
+  const __m256i m = _mm256_set1_epi32(0xff);
+  __m256i r = _mm256_and_si256(v, m);
+  __m256i g = _mm256_and_si256(_mm256_srli_epi32(v, 8), m);
+  __m256i b = _mm256_and_si256(_mm256_srli_epi32(v, 16), m);
+  return _mm256_add_epi32(_mm256_add_epi32(_mm256_sll_epi32(r, rs), _mm256_sll_epi32(g, gs)),
+                          _mm256_sll_epi32(b, bs));
+}
+
+FL_TARGET_AVX2
+static inline __m256i premul2_avx2(__m256i v) {
+  const __m256i keep_alpha = _mm256_set_epi16(-1, 0, 0, 0, -1, 0, 0, 0,
+                                              -1, 0, 0, 0, -1, 0, 0, 0);
+  __m256i a = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(v, 0xff), 0xff);
+  __m256i p = div255_avx2(_mm256_mullo_epi16(v, a));
+  p = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(p, _MM_SHUFFLE(3, 0, 1, 2)),
+                             _MM_SHUFFLE(3, 0, 1, 2));
+  return _mm256_or_si256(_mm256_andnot_si256(keep_alpha, p), _mm256_and_si256(keep_alpha, v));
+}
+
+FL_TARGET_AVX2
+static inline __m256i ga_premul4_avx2(__m256i v) {
+  __m256i a = _mm256_srli_epi32(v, 16);
+  __m256i p = div255_avx2(_mm256_mullo_epi16(v, a));
+  p = _mm256_or_si256(p, _mm256_or_si256(_mm256_slli_epi32(p, 8), _mm256_slli_epi32(p, 16)));
+  return _mm256_or_si256(p, _mm256_slli_epi32(a, 24));
+}
+
+FL_TARGET_AVX2
+static void rgb_to_32_avx2(const uchar *from, uchar *to, int w, int delta,
+                           int rs, int gs, int bs) {
+  const __m128i vr = _mm_cvtsi32_si128(rs);
+  const __m128i vg = _mm_cvtsi32_si128(gs);
+  const __m128i vb = _mm_cvtsi32_si128(bs);
+  int i = 0;
+  if (delta == 4) {
+    for (; i + 8 <= w; i += 8) {
+      __m256i v = _mm256_loadu_si256((const __m256i *)(from + 4 * i));
+      _mm256_storeu_si256((__m256i *)(to + 4 * i), place_avx2(v, vr, vg, vb));
+    }
+  } else if (delta == 3) {
+    // spread 4 packed RGB pixels of each 128-bit lane to 32-bit lanes
+    const __m256i spread = _mm256_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1,
+                                            0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+    // the second 16-byte load reads 4 bytes past the 8 pixels
+    for (; i + 10 <= w; i += 8) {
+      const uchar *f = from + 3 * i;
+      __m256i v = _mm256_inserti128_si256(
+        _mm256_castsi128_si256(_mm_loadu_si128((const __m128i *)f)),
+        _mm_loadu_si128((const __m128i *)(f + 12)), 1);
+      v = _mm256_shuffle_epi8(v, spread);
+      _mm256_storeu_si256((__m256i *)(to + 4 * i), place_avx2(v, vr, vg, vb));
+    }
+  }
+  rgb_to_32_c(from + delta * i, to + 4 * i, w - i, delta, rs, gs, bs);
+}
+
+FL_TARGET_AVX2
+static void gray_to_32_avx2(const uchar *from, uchar *to, int w, int delta,
+                            int rs, int gs, int bs) {
+  int i = 0;
+  if (delta == 1) {
+    const __m128i vr = _mm_cvtsi32_si128(rs);
+    const __m128i vg = _mm_cvtsi32_si128(gs);
+    const __m128i vb = _mm_cvtsi32_si128(bs);
+    for (; i + 8 <= w; i += 8) {
+      __m256i v = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(from + i)));
+      __m256i p = _mm256_add_epi32(_mm256_add_epi32(_mm256_sll_epi32(v, vr),
+                                                    _mm256_sll_epi32(v, vg)),
+                                   _mm256_sll_epi32(v, vb));
+      _mm256_storeu_si256((__m256i *)(to + 4 * i), p);
+    }
+  }
+  gray_to_32_c(from + delta * i, to + 4 * i, w - i, delta, rs, gs, bs);
+}
+
+FL_TARGET_AVX2
+static void rgb_to_24_avx2(const uchar *from, uchar *to, int w, int delta, bool bgr) {
+  int i = 0;
+  if ((delta == 3 && bgr) || delta == 4) {
+    // 4 pixels per step, the 16-byte load and store touch up to 2 more pixels
+    const int d = delta;
+    const __m128i order = bgr
+      ? _mm_setr_epi8(2, 1, 0, d+2, d+1, d, 2*d+2, 2*d+1, 2*d, 3*d+2, 3*d+1, 3*d, -1, -1, -1, -1)
+      : _mm_setr_epi8(0, 1, 2, d, d+1, d+2, 2*d, 2*d+1, 2*d+2, 3*d, 3*d+1, 3*d+2, -1, -1, -1, -1);
+    for (; i + 6 <= w; i += 4) {
+      __m128i v = _mm_loadu_si128((const __m128i *)(from + d * i));
+      _mm_storeu_si128((__m128i *)(to + 3 * i), _mm_shuffle_epi8(v, order));
+    }
+  }
+  rgb_to_24_c(from + delta * i, to + 3 * i, w - i, delta, bgr);
+}
+
+FL_TARGET_AVX2
+static void rgba_premul_avx2(const uchar *from, uchar *to, int w, int delta) {
+  int i = 0;
+  if (delta == 4) {
+    const __m256i zero = _mm256_setzero_si256();
+    for (; i + 8 <= w; i += 8) {
+      __m256i v = _mm256_loadu_si256((const __m256i *)(from + 4 * i));
+      __m256i lo = premul2_avx2(_mm256_unpacklo_epi8(v, zero));
+      __m256i hi = premul2_avx2(_mm256_unpackhi_epi8(v, zero));
+      _mm256_storeu_si256((__m256i *)(to + 4 * i), _mm256_packus_epi16(lo, hi));
+    }
+  }
+  rgba_premul_c(from + delta * i, to + 4 * i, w - i, delta);
+}
+
+FL_TARGET_AVX2
+static void ga_premul_avx2(const uchar *from, uchar *to, int w, int delta) {
+  int i = 0;
+  if (delta == 2) {
+    for (; i + 8 <= w; i += 8) {
+      __m256i v = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(from + 2 * i)));
+      _mm256_storeu_si256((__m256i *)(to + 4 * i), ga_premul4_avx2(v));
+    }
+  }
+  ga_premul_c(from + delta * i, to + 4 * i, w - i, delta);
+}
+
+#endif // FL_SIMD_AVX2
+
+// ---- dispatch -------------------------------------------------------------
+
+typedef void (*To32_Fn)(const uchar *, uchar *, int, int, int, int, int);
+typedef void (*To24_Fn)(const uchar *, uchar *, int, int, bool);
+typedef void (*Premul_Fn)(const uchar *, uchar *, int, int);
+
+static int convert_level = -1;
+static To32_Fn rgb_to_32_fn = rgb_to_32_c;
+static To32_Fn gray_to_32_fn = gray_to_32_c;
+static To24_Fn rgb_to_24_fn = rgb_to_24_c;
+static Premul_Fn rgba_premul_fn = rgba_premul_c;
+static Premul_Fn ga_premul_fn = ga_premul_c;
+
+int fl_pixel_convert_level(int level) {
+  if (level < 0) {
+    if (convert_level >= 0)
+      return convert_level;
+    level = 2;
+  }
+  if (level >= 2 && !(FL_SIMD_AVX2 && fl_cpu_has_avx2()))
+    level = 1;
+  if (level >= 1 && !FL_SIMD_SSE2)
+    level = 0;
+  rgb_to_32_fn = rgb_to_32_c;
+  gray_to_32_fn = gray_to_32_c;
+  rgb_to_24_fn = rgb_to_24_c;
+  rgba_premul_fn = rgba_premul_c;
+  ga_premul_fn = ga_premul_c;
+#if FL_SIMD_SSE2
+  if (level == 1) {
+    rgb_to_32_fn = rgb_to_32_sse2;
+    gray_to_32_fn = gray_to_32_sse2;
+    rgba_premul_fn = rgba_premul_sse2;
+    ga_premul_fn = ga_premul_sse2;
+  }
+#endif
+#if FL_SIMD_AVX2
+  if (level == 2) {
+    rgb_to_32_fn = rgb_to_32_avx2;
+    gray_to_32_fn = gray_to_32_avx2;
+    rgb_to_24_fn = rgb_to_24_avx2;
+    rgba_premul_fn = rgba_premul_avx2;
+    ga_premul_fn = ga_premul_avx2;
+  }
+#endif
+  convert_level = level;
+  return level;
+}
+
+void fl_pixel_rgb_to_32(const uchar *from, uchar *to, int w, int delta,
+                        int rs, int gs, int bs) {
+  if (convert_level < 0) fl_pixel_convert_level();
+  rgb_to_32_fn(from, to, w, delta, rs, gs, bs);
+}
+
+void fl_pixel_gray_to_32(const uchar *from, uchar *to, int w, int delta,
+                         int rs, int gs, int bs) {
+  if (convert_level < 0) fl_pixel_convert_level();
+  gray_to_32_fn(from, to, w, delta, rs, gs, bs);
+}
+
+void fl_pixel_rgb_to_24(const uchar *from, uchar *to, int w, int delta, bool bgr) {
+  if (convert_level < 0) fl_pixel_convert_level();
+  rgb_to_24_fn(from, to, w, delta, bgr);
+}
+
+void fl_pixel_rgba_to_argb_premul(const uchar *from, uchar *to, int w, int delta) {
+  if (convert_level < 0) fl_pixel_convert_level();
+  rgba_premul_fn(from, to, w, delta);
+}
+
+void fl_pixel_ga_to_argb_premul(const uchar *from, uchar *to, int w, int delta) {
+  if (convert_level < 0) fl_pixel_convert_level();
+  ga_premul_fn(from, to, w, delta);
+}
@@ -0,0 +1,61 @@
+//
+// Pixel format conversion kernels for the Fast Light Tool Kit (FLTK).
+//
+// Copyright 2026 by Bill Spitzak and others.
+//
+// This library is free software. Distribution and use rights are outlined in
+// the file "COPYING" which should have been included with this file.  If this
+// file is missing or damaged, see the license at:
+//
+//     https://www.fltk.org/COPYING.php
+//
+// Please see the following page on how to report bugs and issues:
+//
+//     https://www.fltk.org/bugs.php
+//
+
+/*
+ Internal use only.
+
+ Row converters used by the Xlib graphics driver to turn image data into
+ the pixel format of the X server. They all read \p w source pixels that
+ start \p delta bytes apart. \p delta may be larger than the number of
+ channels, or negative to read the pixels from right to left. 32-bit
+ pixels are written as unsigned integers in native byte order, \p to must
+ be suitably aligned.
+
+ The implementation is selected at runtime: AVX2 if the CPU supports it,
+ otherwise SSE2 or plain C++. See fl_pixel_convert_level(). All levels
+ produce identical results.
+*/
+
+#ifndef _src_fl_pixel_convert_h_
+#define _src_fl_pixel_convert_h_
+
+#include <FL/fl_types.h>
+
+// Writes (r << rs) + (g << gs) + (b << bs) for each RGB pixel.
+void fl_pixel_rgb_to_32(const uchar *from, uchar *to, int w, int delta,
+                        int rs, int gs, int bs);
+
+// Writes (v << rs) + (v << gs) + (v << bs) for each gray pixel.
+void fl_pixel_gray_to_32(const uchar *from, uchar *to, int w, int delta,
+                         int rs, int gs, int bs);
+
+// Writes 3 bytes R, G, B, or B, G, R if bgr is true, for each RGB pixel.
+void fl_pixel_rgb_to_24(const uchar *from, uchar *to, int w, int delta, bool bgr);
+
+// Writes (a << 24) + (r*a/255 << 16) + (g*a/255 << 8) + b*a/255 for each
+// RGBA pixel.
+void fl_pixel_rgba_to_argb_premul(const uchar *from, uchar *to, int w, int delta);
+
+// Writes (a << 24) + (v*a/255) * 0x10101 for each gray + alpha pixel.
+void fl_pixel_ga_to_argb_premul(const uchar *from, uchar *to, int w, int delta);
+
+// Selects the implementation: 0 = plain C++, 1 = SSE2, 2 = AVX2.
+// Levels that are not supported by the CPU or the build fall back to the
+// highest supported level. Returns the level that is used. Pass -1 to query
+// the current level without changing it.
+int fl_pixel_convert_level(int level = -1);
+
+#endif // _src_fl_pixel_convert_h_
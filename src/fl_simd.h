@@ -0,0 +1,101 @@
+//
+// SIMD support macros for the Fast Light Tool Kit (FLTK).
+//
+// Copyright 2026 by Bill Spitzak and others.
+//
+// This library is free software. Distribution and use rights are outlined in
+// the file "COPYING" which should have been included with this file.  If this
+// file is missing or damaged, see the license at:
+//
+//     https://www.fltk.org/COPYING.php
+//
+// Please see the following page on how to report bugs and issues:
+//
+//     https://www.fltk.org/bugs.php
+//
+
+/*
+ Internal use only. This header must not be included by public headers.
+
+ It defines which vector instruction sets can be used by the library's
+ optional SIMD code paths:
+
+ - FL_SIMD_SSE2 is 1 if SSE2 intrinsics are always available (x86_64, or
+   32-bit x86 builds with SSE2 enabled). No runtime check is needed.
+ - FL_SIMD_AVX2 is 1 if the compiler can build AVX2 functions next to the
+   baseline code (GCC and Clang, see FL_TARGET_AVX2). Such functions must
+   only be called if fl_cpu_has_avx2() returns true.
+
+ Every SIMD code path must have a plain C++ fallback with identical results.
+ Define FL_NO_SIMD to build the library with the fallbacks only.
+*/
+
+#ifndef _src_fl_simd_h_
+#define _src_fl_simd_h_
+
+#if !defined(FL_NO_SIMD) && (defined(__x86_64__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__))
+#  define FL_SIMD_SSE2 1
+#  include <emmintrin.h>
+#else
+#  define FL_SIMD_SSE2 0
+#endif
+
+#if FL_SIMD_SSE2 && ((defined(__GNUC__) && __GNUC__ >= 5) || defined(__clang__))
+#  define FL_SIMD_AVX2 1
+#  include <immintrin.h>
+#  define FL_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#  define FL_SIMD_AVX2 0
+#  define FL_TARGET_AVX2
+#endif
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#  include <intrin.h>
+#endif
+
+/** Returns true if AVX2 code can be executed on this CPU. */
+static inline bool fl_cpu_has_avx2() {
+#if FL_SIMD_AVX2
+  static int has_avx2 = -1;
+  if (has_avx2 < 0) {
+    __builtin_cpu_init();
+    has_avx2 = __builtin_cpu_supports("avx2") ? 1 : 0;
+  }
+  return has_avx2 != 0;
+#else
+  return false;
+#endif
+}
+
+/** Returns the index of the lowest set bit, \p v must not be 0. */
+static inline int fl_ctz32(unsigned v) {
+#if defined(__GNUC__) || defined(__clang__)
+  return __builtin_ctz(v);
+#elif defined(_MSC_VER)
+  unsigned long i;
+  _BitScanForward(&i, v);
+  return (int)i;
+#else
+  int n = 0;
+  while (!(v & 1)) { v >>= 1; n++; }
+  return n;
+#endif
+}
+
+/** Returns the index of the highest set bit, \p v must not be 0. */
+static inline int fl_msb32(unsigned v) {
+#if defined(__GNUC__) || defined(__clang__)
+  return 31 - __builtin_clz(v);
+#elif defined(_MSC_VER)
+  unsigned long i;
+  _BitScanReverse(&i, v);
+  return (int)i;
+#else
+  int n = 0;
+  while (v >>= 1) n++;
+  return n;
+#endif
+}
+
+#endif // _src_fl_simd_h_
@@ -0,0 +1,406 @@
+//
+// Text scanning kernels for the Fast Light Tool Kit (FLTK).
+//
+// Copyright 2026 by Bill Spitzak and others.
+//
+// This library is free software. Distribution and use rights are outlined in
+// the file "COPYING" which should have been included with this file.  If this
+// file is missing or damaged, see the license at:
+//
+//     https://www.fltk.org/COPYING.php
+//
+// Please see the following page on how to report bugs and issues:
+//
+//     https://www.fltk.org/bugs.php
+//
+
+#include "fl_text_scan.h"
+#include "fl_simd.h"
+
+#include <string.h>
+
+// Needles with at least this many bytes are searched with Boyer-Moore-Horspool,
+// shorter needles are found by scanning for their first byte.
+static const int bmh_min = 16;
+
+static inline unsigned char fold_(unsigned char c) {
+  return (c >= 'A' && c <= 'Z') ? (unsigned char)(c + 32) : c;
+}
+
+// Returns the other case of an ASCII letter, or c
+static inline char swapcase_(char c) {
+  if (c >= 'A' && c <= 'Z') return (char)(c + 32);
+  if (c >= 'a' && c <= 'z') return (char)(c - 32);
+  return c;
+}
+
+static inline bool equal_(const char *a, const char *b, int n, bool fold) {
+  if (!fold)
+    return memcmp(a, b, n) == 0;
+  for (int i = 0; i < n; i++)
+    if (fold_((unsigned char)a[i]) != fold_((unsigned char)b[i]))
+      return false;
+  return true;
+}
+
+// ---- plain C++ ------------------------------------------------------------
+
+static int count_c(const char *p, int len, char c) {
+  int n = 0;
+  for (int i = 0; i < len; i++)
+    n += (p[i] == c);
+  return n;
+}
+
+static int find_c(const char *p, int len, char c1, char c2) {
+  for (int i = 0; i < len; i++)
+    if (p[i] == c1 || p[i] == c2)
+      return i;
+  return -1;
+}
+
+static int rfind_c(const char *p, int len, char c1, char c2) {
+  for (int i = len - 1; i >= 0; i--)
+    if (p[i] == c1 || p[i] == c2)
+      return i;
+  return -1;
+}
+
+static int ascii_c(const char *p, int len) {
+  int i = 0;
+  while (i < len && (unsigned char)(p[i] - 1) < 0x7f)
+    i++;
+  return i;
+}
+
+static int printable_c(const char *p, int len) {
+  int i = 0;
+  while (i < len && (unsigned char)(p[i] - 0x20) < 0x5f)
+    i++;
+  return i;
+}
+
+// ---- SSE2 -----------------------------------------------------------------
+
+#if FL_SIMD_SSE2
+
+static int count_sse2(const char *p, int len, char c) {
+  const __m128i vc = _mm_set1_epi8(c);
+  const __m128i zero = _mm_setzero_si128();
+  int n = 0, i = 0;
+  while (len - i >= 16) {
+    // each byte counter can take at most 255 matches before it overflows
+    int blocks = (len - i) / 16;
+    if (blocks > 255) blocks = 255;
+    __m128i acc = zero;
+    for (int b = 0; b < blocks; b++, i += 16) {
+      __m128i v = _mm_loadu_si128((const __m128i *)(p + i));
+      acc = _mm_sub_epi8(acc, _mm_cmpeq_epi8(v, vc));
+    }
+    __m128i s = _mm_sad_epu8(acc, zero);
+    n += _mm_cvtsi128_si32(s) + _mm_cvtsi128_si32(_mm_srli_si128(s, 8));
+  }
+  return n + count_c(p + i, len - i, c);
+}
+
+static int find_sse2(const char *p, int len, char c1, char c2) {
+  const __m128i v1 = _mm_set1_epi8(c1);
+  const __m128i v2 = _mm_set1_epi8(c2);
+  int i = 0;
+  for (; i + 16 <= len; i += 16) {
+    __m128i v = _mm_loadu_si128((const __m128i *)(p + i));
+    unsigned m = (unsigned)_mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, v1),
+                                                          _mm_cmpeq_epi8(v, v2)));
+    if (m)
+      return i + fl_ctz32(m);
+  }
+  int k = find_c(p + i, len - i, c1, c2);
+  return k < 0 ? -1 : i + k;
+}
+
+static int rfind_sse2(const char *p, int len, char c1, char c2) {
+  const __m128i v1 = _mm_set1_epi8(c1);
+  const __m128i v2 = _mm_set1_epi8(c2);
+  int i = len;
+  while (i >= 16) {
+    i -= 16;
+    __m128i v = _mm_loadu_si128((const __m128i *)(p + i));
+    unsigned m = (unsigned)_mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, v1),
+                                                          _mm_cmpeq_epi8(v, v2)));
+    if (m)
+      return i + fl_msb32(m);
+  }
+  return rfind_c(p, i, c1, c2);
+}
+
+static int ascii_sse2(const char *p, int len) {
+  const __m128i zero = _mm_setzero_si128();
+  int i = 0;
+  for (; i + 16 <= len; i += 16) {
+    __m128i v = _mm_loadu_si128((const __m128i *)(p + i));
+    unsigned m = (unsigned)(_mm_movemask_epi8(v) | _mm_movemask_epi8(_mm_cmpeq_epi8(v, zero)));
+    if (m)
+      return i + fl_ctz32(m);
+  }
+  return i + ascii_c(p + i, len - i);
+}
+
+// Bytes >= 0x80 are negative, so a signed compare with 0x1f finds them too
+static int printable_sse2(const char *p, int len) {
+  const __m128i space = _mm_set1_epi8(0x1f);
+  const __m128i del = _mm_set1_epi8(0x7f);
+  int i = 0;
+  for (; i + 16 <= len; i += 16) {
+    __m128i v = _mm_loadu_si128((const __m128i *)(p + i));
+    unsigned m = (unsigned)(_mm_movemask_epi8(_mm_cmpgt_epi8(v, space)) ^ 0xffff) |
+                 (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(v, del));
+    if (m)
+      return i + fl_ctz32(m);
+  }
+  return i + printable_c(p + i, len - i);
+}
+
+#endif // FL_SIMD_SSE2
+
+// ---- AVX2 -----------------------------------------------------------------
+
+#if FL_SIMD_AVX2
+
+FL_TARGET_AVX2
+static int count_avx2(const char *p, int len, char c) {
+  const __m256i vc = _mm256_set1_epi8(c);
+  const __m256i zero = _mm256_setzero_si256();
+  int n = 0, i = 0;
+  while (len - i >= 32) {
+    int blocks = (len - i) / 32;
+    if (blocks > 255) blocks = 255;
+    __m256i acc = zero;
+    for (int b = 0; b < blocks; b++, i += 32) {
+      __m256i v = _mm256_loadu_si256((const __m256i *)(p + i));
+      acc = _mm256_sub_epi8(acc, _mm256_cmpeq_epi8(v, vc));
+    }
+    __m256i s = _mm256_sad_epu8(acc, zero);
+    __m128i t = _mm_add_epi64(_mm256_castsi256_si128(s), _mm256_extracti128_si256(s, 1));
+    n += _mm_cvtsi128_si32(t) + _mm_cvtsi128_si32(_mm_srli_si128(t, 8));
+  }
+  return n + count_sse2(p + i, len - i, c);
+}
+
+FL_TARGET_AVX2
+static int find_avx2(const char *p, int len, char c1, char c2) {
+  const __m256i v1 = _mm256_set1_epi8(c1);
+  const __m256i v2 = _mm256_set1_epi8(c2);
+  int i = 0;
+  for (; i + 32 <= len; i += 32) {
+    __m256i v = _mm256_loadu_si256((const __m256i *)(p + i));
+    unsigned m = (unsigned)_mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(v, v1),
+                                                                _mm256_cmpeq_epi8(v, v2)));
+    if (m)
+      return i + fl_ctz32(m);
+  }
+  int k = find_sse2(p + i, len - i, c1, c2);
+  return k < 0 ? -1 : i + k;
+}
+
+FL_TARGET_AVX2
+static int rfind_avx2(const char *p, int len, char c1, char c2) {
+  const __m256i v1 = _mm256_set1_epi8(c1);
+  const __m256i v2 = _mm256_set1_epi8(c2);
+  int i = len;
+  while (i >= 32) {
+    i -= 32;
+    __m256i v = _mm256_loadu_si256((const __m256i *)(p + i));
+    unsigned m = (unsigned)_mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(v, v1),
+                                                                _mm256_cmpeq_epi8(v, v2)));
+    if (m)
+      return i + fl_msb32(m);
+  }
+  return rfind_sse2(p, i, c1, c2);
+}
+
+FL_TARGET_AVX2
+static int ascii_avx2(const char *p, int len) {
+  const __m256i zero = _mm256_setzero_si256();
+  int i = 0;
+  for (; i + 32 <= len; i += 32) {
+    __m256i v = _mm256_loadu_si256((const __m256i *)(p + i));
+    unsigned m = (unsigned)(_mm256_movemask_epi8(v) |
+                            _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, zero)));
+    if (m)
+      return i + fl_ctz32(m);
+  }
+  return i + ascii_sse2(p + i, len - i);
+}
+
+FL_TARGET_AVX2
+static int printable_avx2(const char *p, int len) {
+  const __m256i space = _mm256_set1_epi8(0x1f);
+  const __m256i del = _mm256_set1_epi8(0x7f);
+  int i = 0;
+  for (; i + 32 <= len; i += 32) {
+    __m256i v = _mm256_loadu_si256((const __m256i *)(p + i));
+    unsigned m = ~(unsigned)_mm256_movemask_epi8(_mm256_cmpgt_epi8(v, space)) |
+                 (unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, del));
+    if (m)
+      return i + fl_ctz32(m);
+  }
+  return i + printable_sse2(p + i, len - i);
+}
+
+#endif // FL_SIMD_AVX2
+
+// ---- dispatch -------------------------------------------------------------
+
+static int scan_level = -1;
+static int (*count_fn)(const char *, int, char) = count_c;
+static int (*find_fn)(const char *, int, char, char) = find_c;
+static int (*rfind_fn)(const char *, int, char, char) = rfind_c;
+static int (*ascii_fn)(const char *, int) = ascii_c;
+static int (*printable_fn)(const char *, int) = printable_c;
+
+int fl_text_scan_level(int level) {
+  if (level < 0) {
+    if (scan_level >= 0)
+      return scan_level;
+    level = 2;
+  }
+  if (level >= 2 && !(FL_SIMD_AVX2 && fl_cpu_has_avx2()))
+    level = 1;
+  if (level >= 1 && !FL_SIMD_SSE2)
+    level = 0;
+  count_fn = count_c;
+  find_fn = find_c;
+  rfind_fn = rfind_c;
+  ascii_fn = ascii_c;
+  printable_fn = printable_c;
+#if FL_SIMD_SSE2
+  if (level == 1) {
+    count_fn = count_sse2;
+    find_fn = find_sse2;
+    rfind_fn = rfind_sse2;
+    ascii_fn = ascii_sse2;
+    printable_fn = printable_sse2;
+  }
+#endif
+#if FL_SIMD_AVX2
+  if (level == 2) {
+    count_fn = count_avx2;
+    find_fn = find_avx2;
+    rfind_fn = rfind_avx2;
+    ascii_fn = ascii_avx2;
+    printable_fn = printable_avx2;
+  }
+#endif
+  scan_level = level;
+  return level;
+}
+
+int fl_text_count_byte(const char *p, int len, char c) {
+  if (scan_level < 0) fl_text_scan_level();
+  return count_fn(p, len, c);
+}
+
+int fl_text_find_byte(const char *p, int len, char c1, char c2) {
+  if (scan_level < 0) fl_text_scan_level();
+  return find_fn(p, len, c1, c2);
+}
+
+int fl_text_rfind_byte(const char *p, int len, char c1, char c2) {
+  if (scan_level < 0) fl_text_scan_level();
+  return rfind_fn(p, len, c1, c2);
+}
+
+int fl_text_ascii_prefix(const char *p, int len) {
+  if (scan_level < 0) fl_text_scan_level();
+  return ascii_fn(p, len);
+}
+
+int fl_text_printable_prefix(const char *p, int len) {
+  if (scan_level < 0) fl_text_scan_level();
+  return printable_fn(p, len);
+}
+
+// ---- substring search -----------------------------------------------------
+
+/*
+ Boyer-Moore-Horspool: compare the last byte of the window first and shift
+ by the distance of that byte from the end of the needle.
+ */
+static int bmh_search(const char *p, int len, const char *needle, int m, bool fold) {
+  int skip[256];
+  for (int i = 0; i < 256; i++)
+    skip[i] = m;
+  for (int i = 0; i < m - 1; i++) {
+    skip[(unsigned char)needle[i]] = m - 1 - i;
+    if (fold) skip[(unsigned char)swapcase_(needle[i])] = m - 1 - i;
+  }
+  unsigned char last = fold ? fold_(needle[m - 1]) : (unsigned char)needle[m - 1];
+  for (int i = 0; i <= len - m; ) {
+    unsigned char t = (unsigned char)p[i + m - 1];
+    if ((fold ? fold_(t) : t) == last && equal_(p + i, needle, m - 1, fold))
+      return i;
+    i += skip[t];
+  }
+  return -1;
+}
+
+/*
+ Boyer-Moore-Horspool from the end: compare the first byte of the window first
+ and shift by the distance of that byte from the start of the needle.
+ */
+static int bmh_rsearch(const char *p, int len, const char *needle, int m, bool fold) {
+  int skip[256];
+  for (int i = 0; i < 256; i++)
+    skip[i] = m;
+  for (int i = m - 1; i > 0; i--) {
+    skip[(unsigned char)needle[i]] = i;
+    if (fold) skip[(unsigned char)swapcase_(needle[i])] = i;
+  }
+  unsigned char first = fold ? fold_(needle[0]) : (unsigned char)needle[0];
+  for (int i = len - m; i >= 0; ) {
+    unsigned char t = (unsigned char)p[i];
+    if ((fold ? fold_(t) : t) == first && equal_(p + i + 1, needle + 1, m - 1, fold))
+      return i;
+    i -= skip[t];
+  }
+  return -1;
+}
+
+int fl_text_search(const char *p, int len, const char *needle, int m, bool fold) {
+  if (m <= 0)
+    return 0;
+  if (m > len)
+    return -1;
+  if (m >= bmh_min)
+    return bmh_search(p, len, needle, m, fold);
+  char c1 = needle[0], c2 = fold ? swapcase_(c1) : c1;
+  int last = len - m;
+  for (int i = 0; i <= last; i++) {
+    int k = fl_text_find_byte(p + i, last - i + 1, c1, c2);
+    if (k < 0)
+      return -1;
+    i += k;
+    if (equal_(p + i + 1, needle + 1, m - 1, fold))
+      return i;
+  }
+  return -1;
+}
+
+int fl_text_rsearch(const char *p, int len, const char *needle, int m, bool fold) {
+  if (m <= 0)
+    return len;
+  if (m > len)
+    return -1;
+  if (m >= bmh_min)
+    return bmh_rsearch(p, len, needle, m, fold);
+  char c1 = needle[0], c2 = fold ? swapcase_(c1) : c1;
+  for (int n = len - m + 1; n > 0; ) {
+    int k = fl_text_rfind_byte(p, n, c1, c2);
+    if (k < 0)
+      return -1;
+    if (equal_(p + k + 1, needle + 1, m - 1, fold))
+      return k;
+    n = k;
+  }
+  return -1;
+}
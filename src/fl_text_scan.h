@@ -0,0 +1,63 @@
+//
+// Text scanning kernels for the Fast Light Tool Kit (FLTK).
+//
+// Copyright 2026 by Bill Spitzak and others.
+//
+// This library is free software. Distribution and use rights are outlined in
+// the file "COPYING" which should have been included with this file.  If this
+// file is missing or damaged, see the license at:
+//
+//     https://www.fltk.org/COPYING.php
+//
+// Please see the following page on how to report bugs and issues:
+//
+//     https://www.fltk.org/bugs.php
+//
+
+/*
+ Internal use only.
+
+ Byte scanning functions used by Fl_Text_Buffer and Fl_Terminal. They all operate on a single
+ contiguous run of bytes, the caller is responsible for text that is split by
+ the gap of a gap buffer or by the pieces of a piece table.
+
+ The implementation is selected at runtime: AVX2 if the CPU supports it,
+ otherwise SSE2 or plain C++. See fl_text_scan_level().
+
+ If \p fold is true, ASCII letters match regardless of case. All other bytes,
+ including all bytes of multi-byte UTF-8 sequences, must match exactly.
+*/
+
+#ifndef _src_fl_text_scan_h_
+#define _src_fl_text_scan_h_
+
+// Returns the number of bytes in p[0..len) that are equal to c.
+int fl_text_count_byte(const char *p, int len, char c);
+
+// Returns the index of the first byte in p[0..len) equal to c1 or c2, or -1.
+int fl_text_find_byte(const char *p, int len, char c1, char c2);
+
+// Returns the index of the last byte in p[0..len) equal to c1 or c2, or -1.
+int fl_text_rfind_byte(const char *p, int len, char c1, char c2);
+
+// Returns the number of leading bytes in p[0..len) that are ASCII characters
+// other than NUL, i.e. the index of the first byte that is 0 or >= 0x80.
+int fl_text_ascii_prefix(const char *p, int len);
+
+// Returns the number of leading bytes in p[0..len) that are printable ASCII
+// characters, i.e. the index of the first byte that is < 0x20 or >= 0x7f.
+int fl_text_printable_prefix(const char *p, int len);
+
+// Returns the index of the first occurrence of needle[0..m) in p[0..len), or -1.
+int fl_text_search(const char *p, int len, const char *needle, int m, bool fold);
+
+// Returns the index of the last occurrence of needle[0..m) in p[0..len), or -1.
+int fl_text_rsearch(const char *p, int len, const char *needle, int m, bool fold);
+
+// Selects the implementation: 0 = plain C++, 1 = SSE2, 2 = AVX2.
+// Levels that are not supported by the CPU or the build fall back to the
+// highest supported level. Returns the level that is used. Pass -1 to query
+// the current level without changing it.
+int fl_text_scan_level(int level = -1);
+
+#endif // _src_fl_text_scan_h_
@@ -0,0 +1,127 @@
+//
+// Image scaling benchmark for the Fast Light Tool Kit (FLTK).
+//
+// Copyright 2026 by Bill Spitzak and others.
+//
+// This library is free software. Distribution and use rights are outlined in
+// the file "COPYING" which should have been included with this file.  If this
+// file is missing or damaged, see the license at:
+//
+//     https://www.fltk.org/COPYING.php
+//
+// Please see the following page on how to report bugs and issues:
+//
+//     https://www.fltk.org/bugs.php
+//
+
+/*
+ This program measures the throughput of the scaling functions that
+ Fl_RGB_Image::copy(int, int) uses with FL_RGB_SCALING_AREA and
+ FL_RGB_SCALING_BILINEAR, for every implementation that the CPU supports
+ (plain C++, SSE2, AVX2), and checks that all implementations produce the
+ same pixels for many image sizes and depths.
+
+ Usage: image_scale_bench [megapixels]
+*/
+
+#include "../src/fl_image_scale.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static const char *level_names[] = { "C++", "SSE2", "AVX2" };
+
+static double seconds() {
+  return (double)clock() / CLOCKS_PER_SEC;
+}
+
+typedef void (*Scale_Fn)(const uchar *src, int sw, int sh, int sld, int d,
+                         uchar *dst, int w, int h, int y0, int y1);
+
+// One scaling function with the source and target size of the benchmark
+struct Scaler {
+  const char *name;
+  Scale_Fn fn;
+  int d, sw, sh, w, h;
+};
+
+static const Scaler scalers[] = {
+  { "area     RGB  1920 -> 640",    fl_scale_area,     3, 1920, 1080,  640,  360 },
+  { "area     RGBA 1920 -> 1366",   fl_scale_area,     4, 1920, 1080, 1366,  768 },
+  { "area     gray 1920 -> 500",    fl_scale_area,     1, 1920, 1080,  500,  281 },
+  { "area     RGBA 640 -> 1920",    fl_scale_area,     4,  640,  360, 1920, 1080 },
+  { "bilinear RGB  1920 -> 640",    fl_scale_bilinear, 3, 1920, 1080,  640,  360 },
+  { "bilinear RGBA 1920 -> 1366",   fl_scale_bilinear, 4, 1920, 1080, 1366,  768 },
+  { "bilinear gray+A 640 -> 1920",  fl_scale_bilinear, 2,  640,  360, 1920, 1080 },
+  { "bilinear RGBA 640 -> 1920",    fl_scale_bilinear, 4,  640,  360, 1920, 1080 }
+};
+
+// Checks random sizes, depths and line sizes, scaled up and down, against C++
+static bool check(const char *name, Scale_Fn fn, const uchar *src, int max_level) {
+  static uchar ref[96 * 96 * 4 + 16], out[96 * 96 * 4 + 16];
+  srand(2);
+  for (int n = 0; n < 2000; n++) {
+    int d = 1 + rand() % 4;
+    int sw = 1 + rand() % 96, sh = 1 + rand() % 96;
+    int w = 1 + rand() % 96, h = 1 + rand() % 96;
+    int sld = sw * d + rand() % 8;
+    int y0 = rand() % h, y1 = y0 + 1 + rand() % (h - y0);
+    memset(ref, 0x55, sizeof(ref));
+    fl_image_scale_level(0);
+    fn(src, sw, sh, sld, d, ref, w, h, y0, y1);
+    for (int level = 1; level <= max_level; level++) {
+      memset(out, 0x55, sizeof(out));
+      fl_image_scale_level(level);
+      fn(src, sw, sh, sld, d, out, w, h, y0, y1);
+      if (memcmp(ref, out, sizeof(ref))) {
+        printf("  %s: %s differs from C++ for %dx%d -> %dx%d, depth %d\n",
+               name, level_names[level], sw, sh, w, h, d);
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+int main(int argc, char **argv) {
+  int mp = argc > 1 ? atoi(argv[1]) : 64;
+  if (mp < 1) mp = 1;
+
+  const size_t src_size = (size_t)1920 * 1080 * 4 + 64;
+  uchar *src = (uchar *)malloc(src_size);
+  uchar *dst = (uchar *)malloc((size_t)1920 * 1080 * 4 + 64);
+  srand(1);
+  for (size_t i = 0; i < src_size; i++)
+    src[i] = (uchar)rand();
+
+  int max_level = fl_image_scale_level(2);
+  printf("%d megapixels written per test\n\n", mp);
+  printf("  %-30s", "");
+  for (int level = 0; level <= max_level; level++)
+    printf("%10s MP/s", level_names[level]);
+  printf("\n");
+
+  bool ok = true;
+  for (unsigned n = 0; n < sizeof(scalers) / sizeof(scalers[0]); n++) {
+    const Scaler &s = scalers[n];
+    const int rounds = (int)(((long)mp * 1000000 + (long)s.w * s.h - 1) / ((long)s.w * s.h));
+    printf("  %-30s", s.name);
+    for (int level = 0; level <= max_level; level++) {
+      fl_image_scale_level(level);
+      double t0 = seconds();
+      for (int r = 0; r < rounds; r++)
+        s.fn(src, s.sw, s.sh, s.sw * s.d, s.d, dst, s.w, s.h, 0, s.h);
+      double t = seconds() - t0;
+      printf("%15.0f", t > 0.0 ? (double)rounds * s.w * s.h / t / 1e6 : 0.0);
+    }
+    printf("\n");
+    if (!check(s.name, s.fn, src, max_level))
+      ok = false;
+  }
+
+  free(src);
+  free(dst);
+  return ok ? 0 : 1;
+}
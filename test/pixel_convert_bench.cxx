@@ -0,0 +1,132 @@
+//
+// Pixel conversion benchmark for the Fast Light Tool Kit (FLTK).
+//
+// Copyright 2026 by Bill Spitzak and others.
+//
+// This library is free software. Distribution and use rights are outlined in
+// the file "COPYING" which should have been included with this file.  If this
+// file is missing or damaged, see the license at:
+//
+//     https://www.fltk.org/COPYING.php
+//
+// Please see the following page on how to report bugs and issues:
+//
+//     https://www.fltk.org/bugs.php
+//
+
+/*
+ This program measures the throughput of the row converters that the Xlib
+ graphics driver uses to send images to the X server, for every
+ implementation that the CPU supports (plain C++, SSE2, AVX2), and checks
+ that all implementations produce the same pixels.
+
+ Usage: pixel_convert_bench [megapixels]
+*/
+
+#include "../src/fl_pixel_convert.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static const char *level_names[] = { "C++", "SSE2", "AVX2" };
+
+static double seconds() {
+  return (double)clock() / CLOCKS_PER_SEC;
+}
+
+// One converter with the source depth it reads and the bytes it writes
+struct Converter {
+  const char *name;
+  int delta;
+  int out;
+  void (*fn)(const uchar *from, uchar *to, int w, int delta);
+};
+
+static void xrgb(const uchar *f, uchar *t, int w, int d) { fl_pixel_rgb_to_32(f, t, w, d, 16, 8, 0); }
+static void xbgr(const uchar *f, uchar *t, int w, int d) { fl_pixel_rgb_to_32(f, t, w, d, 0, 8, 16); }
+static void rgbx(const uchar *f, uchar *t, int w, int d) { fl_pixel_rgb_to_32(f, t, w, d, 24, 16, 8); }
+static void xrrr(const uchar *f, uchar *t, int w, int d) { fl_pixel_gray_to_32(f, t, w, d, 16, 8, 0); }
+static void bgr(const uchar *f, uchar *t, int w, int d) { fl_pixel_rgb_to_24(f, t, w, d, true); }
+static void rgb(const uchar *f, uchar *t, int w, int d) { fl_pixel_rgb_to_24(f, t, w, d, false); }
+static void argb(const uchar *f, uchar *t, int w, int d) { fl_pixel_rgba_to_argb_premul(f, t, w, d); }
+static void gaargb(const uchar *f, uchar *t, int w, int d) { fl_pixel_ga_to_argb_premul(f, t, w, d); }
+
+static const Converter converters[] = {
+  { "RGB  -> xRGB 32",          3, 4, xrgb },
+  { "RGBA -> xRGB 32",          4, 4, xrgb },
+  { "RGB  -> xBGR 32",          3, 4, xbgr },
+  { "RGB  -> RGBx 32",          3, 4, rgbx },
+  { "gray -> xRRR 32",          1, 4, xrrr },
+  { "RGB  -> BGR 24",           3, 3, bgr },
+  { "RGBA -> RGB 24",           4, 3, rgb },
+  { "RGBA -> ARGB premul",      4, 4, argb },
+  { "gray+A -> ARGB premul",    2, 4, gaargb }
+};
+
+// Checks all widths up to 64 and a few offsets against the C++ converters
+static bool check(const Converter &c, const uchar *src, int max_level) {
+  unsigned ref_buf[64 + 4], out_buf[64 + 4]; // aligned for 32-bit pixels
+  uchar *ref = (uchar *)ref_buf, *out = (uchar *)out_buf;
+  for (int level = 1; level <= max_level; level++) {
+    for (int w = 0; w <= 64; w++) {
+      for (int off = 0; off < 3; off++) {
+        const uchar *from = src + off * c.delta;
+        memset(ref, 0x55, sizeof(ref_buf));
+        memset(out, 0x55, sizeof(out_buf));
+        fl_pixel_convert_level(0);
+        c.fn(from, ref, w, c.delta);
+        fl_pixel_convert_level(level);
+        c.fn(from, out, w, c.delta);
+        if (memcmp(ref, out, sizeof(ref_buf))) {
+          printf("  %s: %s differs from C++ for %d pixels\n", c.name, level_names[level], w);
+          return false;
+        }
+      }
+    }
+  }
+  return true;
+}
+
+int main(int argc, char **argv) {
+  int mp = argc > 1 ? atoi(argv[1]) : 64;
+  if (mp < 1) mp = 1;
+
+  const int W = 1920, H = 64;           // one block of rows, converted repeatedly
+  const int rounds = (mp * 1000000 + W * H - 1) / (W * H);
+  uchar *src = (uchar *)malloc((size_t)W * H * 4 + 64);
+  uchar *dst = (uchar *)malloc((size_t)W * H * 4 + 64);
+  srand(1);
+  for (int i = 0; i < W * H * 4 + 64; i++)
+    src[i] = (uchar)rand();
+
+  int max_level = fl_pixel_convert_level(2);
+  printf("%d megapixels per test, %d pixels per row\n\n", mp, W);
+  printf("  %-24s", "");
+  for (int level = 0; level <= max_level; level++)
+    printf("%10s MP/s", level_names[level]);
+  printf("\n");
+
+  bool ok = true;
+  for (unsigned n = 0; n < sizeof(converters) / sizeof(converters[0]); n++) {
+    const Converter &c = converters[n];
+    printf("  %-24s", c.name);
+    for (int level = 0; level <= max_level; level++) {
+      fl_pixel_convert_level(level);
+      double t0 = seconds();
+      for (int r = 0; r < rounds; r++)
+        for (int y = 0; y < H; y++)
+          c.fn(src + y * W * c.delta, dst + y * W * c.out, W, c.delta);
+      double t = seconds() - t0;
+      printf("%15.0f", t > 0.0 ? (double)rounds * W * H / t / 1e6 : 0.0);
+    }
+    printf("\n");
+    if (!check(c, src, max_level))
+      ok = false;
+  }
+
+  free(src);
+  free(dst);
+  return ok ? 0 : 1;
+}
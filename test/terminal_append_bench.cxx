@@ -0,0 +1,158 @@
+//
+// Fl_Terminal append benchmark for the Fast Light Tool Kit (FLTK).
+//
+// Copyright 2026 by Bill Spitzak and others.
+//
+// This library is free software. Distribution and use rights are outlined in
+// the file "COPYING" which should have been included with this file.  If this
+// file is missing or damaged, see the license at:
+//
+//     https://www.fltk.org/COPYING.php
+//
+// Please see the following page on how to report bugs and issues:
+//
+//     https://www.fltk.org/bugs.php
+//
+
+/*
+ This program measures how fast Fl_Terminal::append() takes in log output,
+ compared to printing one character at a time with print_char() as
+ append() did before FLTK 1.5.0, for every implementation of the byte
+ scanner that the CPU supports (plain C++, SSE2, AVX2). It checks that
+ both ways leave the same text, colors and cursor position behind.
+
+ The terminal is never shown, so no display is needed.
+
+ Usage: terminal_append_bench [megabytes]
+*/
+
+#include <FL/Fl_Terminal.H>
+#include <FL/fl_utf8.h>
+#include "../src/fl_text_scan.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <string>
+
+static const char *level_names[] = { "C++", "SSE2", "AVX2" };
+static const int block = 4096;          // bytes per append(), like reads from a pipe
+
+static double seconds() {
+  return (double)clock() / CLOCKS_PER_SEC;
+}
+
+// Terminal with access to the character cells and the old append()
+class Terminal : public Fl_Terminal {
+public:
+  Terminal() : Fl_Terminal(0, 0, 800, 600, 0, 24, 80, 1000) {
+    redraw_style(NO_REDRAW);
+  }
+  // The previous implementation of append() for complete, valid UTF-8
+  void old_append(const char *p, int len) {
+    while (len > 0) {
+      int clen = fl_utf8len(*p);
+      print_char(p, clen);
+      p += clen;
+      len -= clen;
+    }
+  }
+  // Returns true if text, style and cursor match those of 'o'
+  bool same(const Terminal &o) const {
+    if (cursor_row() != o.cursor_row() || cursor_col() != o.cursor_col())
+      return false;
+    for (int row = 0; row < ring_rows(); row++) {
+      for (int col = 0; col < ring_cols(); col++) {
+        const Utf8Char *a = utf8_char_at_glob(row, col);
+        const Utf8Char *b = o.utf8_char_at_glob(row, col);
+        if (a->length() != b->length() || memcmp(a->text_utf8(), b->text_utf8(), a->length()) ||
+            a->attrib() != b->attrib() || a->charflags() != b->charflags() ||
+            a->fgcolor() != b->fgcolor() || a->bgcolor() != b->bgcolor())
+          return false;
+      }
+    }
+    return true;
+  }
+};
+
+// Appends all of 'text' in blocks that end at character boundaries
+static void feed(Terminal &t, const std::string &text, bool old_way) {
+  const char *p = text.data(), *end = p + text.size();
+  while (p < end) {
+    const char *e = (end - p > block) ? p + block : end;
+    while (e < end && (*e & 0xc0) == 0x80)
+      e++;
+    if (old_way) t.old_append(p, int(e - p));
+    else         t.append(p, int(e - p));
+    p = e;
+  }
+}
+
+// Builds about 'bytes' of log output
+static std::string make_log(size_t bytes, bool color, bool utf8) {
+  static const char *words[] = { "connection", "from", "10.0.3.17", "accepted", "user",
+                                 "session", "opened", "closed", "request", "GET",
+                                 "/index.html", "200", "timeout", "retrying" };
+  static const char *umlauts[] = { "\xc3\xa4", "\xc3\xb6", "\xc3\xbc", "\xe2\x82\xac" };
+  std::string s;
+  char buf[64];
+  srand(1);
+  for (int line = 0; s.size() < bytes; line++) {
+    snprintf(buf, sizeof(buf), "2026-10-16 12:%02d:%02d.%03d ", line / 60 % 60, line % 60, line % 1000);
+    s += buf;
+    if (color) s += (line % 3) ? "\033[32mINFO\033[0m " : "\033[1;31mERROR\033[0m ";
+    int n = 4 + rand() % 8;
+    for (int w = 0; w < n; w++) {
+      s += words[rand() % 14];
+      if (utf8 && rand() % 3 == 0) s += umlauts[rand() % 4];
+      s += ' ';
+    }
+    s += '\n';
+  }
+  return s;
+}
+
+int main(int argc, char **argv) {
+  int mb = argc > 1 ? atoi(argv[1]) : 16;
+  if (mb < 1) mb = 1;
+
+  struct { const char *name; std::string text; } tests[] = {
+    { "plain ASCII log",      make_log(size_t(mb) << 20, false, false) },
+    { "ANSI colored log",     make_log(size_t(mb) << 20, true, false) },
+    { "UTF-8 log",            make_log(size_t(mb) << 20, false, true) }
+  };
+
+  int max_level = fl_text_scan_level(2);
+  printf("%d megabytes per test, %d bytes per append()\n\n", mb, block);
+  printf("  %-20s%10s MB/s", "", "old");
+  for (int level = 0; level <= max_level; level++)
+    printf("%10s MB/s", level_names[level]);
+  printf("\n");
+
+  bool ok = true;
+  for (unsigned n = 0; n < sizeof(tests) / sizeof(tests[0]); n++) {
+    const std::string &text = tests[n].text;
+    double mbytes = double(text.size()) / (1 << 20);
+    printf("  %-20s", tests[n].name);
+    Terminal ref;
+    double t0 = seconds();
+    feed(ref, text, true);
+    double t = seconds() - t0;
+    printf("%15.1f", t > 0.0 ? mbytes / t : 0.0);
+    for (int level = 0; level <= max_level; level++) {
+      fl_text_scan_level(level);
+      Terminal tty;
+      t0 = seconds();
+      feed(tty, text, false);
+      t = seconds() - t0;
+      printf("%15.1f", t > 0.0 ? mbytes / t : 0.0);
+      if (!tty.same(ref)) {
+        printf("\n  %s: %s differs from print_char()", tests[n].name, level_names[level]);
+        ok = false;
+      }
+    }
+    printf("\n");
+  }
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,332 @@
+//
+// Text buffer scanning benchmark for the Fast Light Tool Kit (FLTK).
+//
+// Copyright 2026 by Bill Spitzak and others.
+//
+// This library is free software. Distribution and use rights are outlined in
+// the file "COPYING" which should have been included with this file.  If this
+// file is missing or damaged, see the license at:
+//
+//     https://www.fltk.org/COPYING.php
+//
+// Please see the following page on how to report bugs and issues:
+//
+//     https://www.fltk.org/bugs.php
+//
+
+/*
+ This program compares the time needed to search and count lines in a large
+ Fl_Text_Buffer with the implementation of Fl_Text_Buffer before FLTK 1.5.0
+ and with the current implementation, for every implementation of the byte
+ scanner that the CPU supports (plain C++, SSE2, AVX2). The previous
+ implementation only supported gap buffers, so it is also the reference for
+ piece tables.
+
+ It also checks that all implementations of the byte scanner return the same
+ results for many short texts.
+
+ Usage: text_scan_bench [megabytes]
+*/
+
+#include <FL/Fl_Text_Buffer.H>
+#include <FL/fl_utf8.h>
+#include "../src/fl_text_scan.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static const char *level_names[] = { "C++", "SSE2", "AVX2" };
+
+static double seconds() {
+  return (double)clock() / CLOCKS_PER_SEC;
+}
+
+// Gap buffer with the implementation of FLTK 1.4
+class Old_Buffer : public Fl_Text_Buffer {
+public:
+  // The previous implementation of Fl_Text_Buffer::count_lines()
+  int count_lines(int startPos, int endPos) const {
+    int gapLen = mGapEnd - mGapStart;
+    int lineCount = 0;
+
+    int pos = startPos;
+    while (pos < mGapStart)
+    {
+      if (pos == endPos)
+        return lineCount;
+      if (mBuf[pos++] == '\n')
+        lineCount++;
+    }
+    while (pos < mLength) {
+      if (pos == endPos)
+        return lineCount;
+      if (mBuf[pos++ + gapLen] == '\n')
+        lineCount++;
+    }
+    return lineCount;
+  }
+
+  // The previous implementation of Fl_Text_Buffer::findchar_forward()
+  int findchar_forward(int startPos, unsigned searchChar, int *foundPos) const {
+    if (startPos >= mLength) {
+      *foundPos = mLength;
+      return 0;
+    }
+
+    if (startPos<0)
+      startPos = 0;
+
+    for ( ; startPos<mLength; startPos = next_char(startPos)) {
+      if (searchChar == char_at(startPos)) {
+        *foundPos = startPos;
+        return 1;
+      }
+    }
+
+    *foundPos = mLength;
+    return 0;
+  }
+
+  // The previous implementation of Fl_Text_Buffer::search_forward()
+  int search_forward(int startPos, const char *searchString,
+                     int *foundPos, int matchCase) const {
+    if (!searchString)
+      return 0;
+    int bp;
+    const char *sp;
+    if (matchCase) {
+      while (startPos < length()) {
+        bp = startPos;
+        sp = searchString;
+        for (;;) {
+          char c = *sp;
+          // we reached the end of the "needle", so we found the string!
+          if (!c) {
+            *foundPos = startPos;
+            return 1;
+          }
+          int len = fl_utf8len1(c);
+          if (memcmp(sp, address(bp), len))
+            break;
+          sp += len; bp += len;
+        }
+        startPos = next_char(startPos);
+      }
+    } else {
+      while (startPos < length()) {
+        bp = startPos;
+        sp = searchString;
+        for (;;) {
+          // we reached the end of the "needle", so we found the string!
+          if (!*sp) {
+            *foundPos = startPos;
+            return 1;
+          }
+          int len;
+          unsigned int b = char_at(bp);
+          unsigned int s = fl_utf8decode(sp, 0, &len);
+          if (fl_tolower(b)!=fl_tolower(s))
+            break;
+          sp += len;
+          bp = next_char(bp);
+        }
+        startPos = next_char(startPos);
+      }
+    }
+    return 0;
+  }
+
+  // The previous implementation of Fl_Text_Buffer::search_backward()
+  int search_backward(int startPos, const char *searchString,
+                      int *foundPos, int matchCase) const {
+    if (!searchString)
+      return 0;
+    int bp;
+    const char *sp;
+    if (matchCase) {
+      while (startPos >= 0) {
+        bp = startPos;
+        sp = searchString;
+        for (;;) {
+          char c = *sp;
+          // we reached the end of the "needle", so we found the string!
+          if (!c) {
+            *foundPos = startPos;
+            return 1;
+          }
+          int len = fl_utf8len1(c);
+          if (memcmp(sp, address(bp), len))
+            break;
+          sp += len; bp += len;
+        }
+        startPos = prev_char(startPos);
+      }
+    } else {
+      while (startPos >= 0) {
+        bp = startPos;
+        sp = searchString;
+        for (;;) {
+          // we reached the end of the "needle", so we found the string!
+          if (!*sp) {
+            *foundPos = startPos;
+            return 1;
+          }
+          int len;
+          unsigned int b = char_at(bp);
+          unsigned int s = fl_utf8decode(sp, 0, &len);
+          if (fl_tolower(b)!=fl_tolower(s))
+            break;
+          sp += len;
+          bp = next_char(bp);
+        }
+        startPos = prev_char(startPos);
+      }
+    }
+    return 0;
+  }
+};
+
+// One benchmark: runs an operation on a buffer and returns its result
+struct Test {
+  const char *name;
+  int (*old_fn)(const Old_Buffer &buf);
+  int (*new_fn)(const Fl_Text_Buffer &buf);
+};
+
+static const char *needle = "The quick brown fox jumps over the lazy cat";
+
+#define OPERATION(name, expr) \
+  static int old_##name(const Old_Buffer &buf) { int found = -1; (void)found; return expr; } \
+  static int new_##name(const Fl_Text_Buffer &buf) { int found = -1; (void)found; return expr; }
+
+OPERATION(count,   buf.count_lines(0, buf.length()))
+OPERATION(findchar, (buf.findchar_forward(0, '#', &found), found))
+OPERATION(short,   buf.search_forward(0, "lazy cat", &found, 1) ? found : -1)
+OPERATION(long,    buf.search_forward(0, needle, &found, 1) ? found : -1)
+OPERATION(nocase,  buf.search_forward(0, "LAZY CAT", &found, 0) ? found : -1)
+OPERATION(back,    buf.search_backward(buf.length(), "lazy cow", &found, 1) ? found : -1)
+
+static const Test tests[] = {
+  { "count_lines()",                  old_count,    new_count },
+  { "findchar_forward()",             old_findchar, new_findchar },
+  { "search_forward(), short",        old_short,    new_short },
+  { "search_forward(), long",         old_long,     new_long },
+  { "search_forward(), ignore case",  old_nocase,   new_nocase },
+  { "search_backward()",              old_back,     new_back }
+};
+
+static bool bench(const Old_Buffer &old_buf, const Fl_Text_Buffer &buf,
+                  const char *name, int max_level) {
+  bool ok = true;
+  printf("%s, %d bytes:\n", name, buf.length());
+  for (unsigned n = 0; n < sizeof(tests) / sizeof(tests[0]); n++) {
+    printf("  %-32s", tests[n].name);
+    double t0 = seconds();
+    int ref = tests[n].old_fn(old_buf);
+    double t = seconds() - t0;
+    printf("%12.2f", t * 1000.0);
+    for (int level = 0; level <= max_level; level++) {
+      fl_text_scan_level(level);
+      t0 = seconds();
+      int r = tests[n].new_fn(buf);
+      t = seconds() - t0;
+      printf("%12.2f", t * 1000.0);
+      if (r != ref) {
+        printf("\n  %s: %s returns %d instead of %d", tests[n].name, level_names[level], r, ref);
+        ok = false;
+      }
+    }
+    printf("\n");
+  }
+  return ok;
+}
+
+// Fills p[0..len) with letters and spaces, and a few bytes that stop scans
+static void random_text(char *p, int len) {
+  static const char stops[] = { '\n', '\t', 0, '\x7f', '\x80', '\xc3', '\xff', '#' };
+  for (int i = 0; i < len; i++) {
+    int r = rand() % 64;
+    p[i] = r < 26 ? char('a' + r) : r < 52 ? char('A' + r - 26) : ' ';
+  }
+  for (int n = rand() % 4; n > 0 && len > 0; n--)
+    p[rand() % len] = stops[rand() % sizeof(stops)];
+}
+
+// Checks the SSE2 and AVX2 byte scanners against the C++ ones
+static bool check(int max_level) {
+  char text[512 + 64], needle[32];
+  srand(1);
+  for (int trial = 0; trial < 20000; trial++) {
+    int len = rand() % 512, off = rand() % 64;
+    char *p = text + off;
+    random_text(p, len);
+    int m = 1 + rand() % 24;
+    if (len >= m && rand() % 2) {
+      memcpy(needle, p + rand() % (len - m + 1), m);  // make sure that it is found
+    } else {
+      random_text(needle, m);
+    }
+    bool fold = rand() % 2 != 0;
+    int ref[7], r[7];
+    for (int level = 0; level <= max_level; level++) {
+      fl_text_scan_level(level);
+      int *v = level ? r : ref;
+      v[0] = fl_text_count_byte(p, len, '\n');
+      v[1] = fl_text_find_byte(p, len, '\n', '#');
+      v[2] = fl_text_rfind_byte(p, len, '\n', '#');
+      v[3] = fl_text_ascii_prefix(p, len);
+      v[4] = fl_text_printable_prefix(p, len);
+      v[5] = fl_text_search(p, len, needle, m, fold);
+      v[6] = fl_text_rsearch(p, len, needle, m, fold);
+      if (level && memcmp(ref, r, sizeof(r))) {
+        printf("  %s differs from C++ for %d bytes at offset %d\n", level_names[level], len, off);
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+int main(int argc, char **argv) {
+  int mb = argc > 1 ? atoi(argv[1]) : 16;
+  if (mb < 1) mb = 1;
+
+  // build the text, the needles are only found at the very start or end
+  const char *line = "The quick brown fox jumps over the lazy dog. \xc3\xa4\xc3\xb6\xc3\xbc 0123456789\n";
+  int line_len = (int)strlen(line);
+  int lines = mb * 1024 * 1024 / line_len;
+  char *text = (char *)malloc((size_t)lines * line_len + 128);
+  strcpy(text, "The lazy cow\n");
+  char *p = text + strlen(text);
+  for (int i = 0; i < lines; i++, p += line_len)
+    memcpy(p, line, line_len);
+  strcpy(p, "# The quick brown fox jumps over the lazy cat\n");
+
+  int max_level = fl_text_scan_level(2);
+  printf("  %-32s%9s ms", "", "old");
+  for (int level = 0; level <= max_level; level++)
+    printf("%9s ms", level_names[level]);
+  printf("\n");
+
+  Old_Buffer old_gap;
+  old_gap.text(text);
+  old_gap.insert(old_gap.length() / 2, " "); // put the gap in the middle of the text
+  Fl_Text_Buffer gap;
+  gap.text(text);
+  gap.insert(gap.length() / 2, " ");
+  bool ok = bench(old_gap, gap, "Gap buffer", max_level);
+
+  Fl_Text_Buffer pieces(0, 1024, Fl_Text_Buffer::PIECE_TABLE);
+  pieces.text(text);
+  pieces.insert(pieces.length() / 2, " ");
+  if (!bench(old_gap, pieces, "Piece table", max_level))
+    ok = false;
+
+  if (!check(max_level))
+    ok = false;
+
+  free(text);
+  return ok ? 0 : 1;
+}
@@ -1,7 +1,7 @@
 //
 // Unit tests for the Fast Light Tool Kit (FLTK).
 //
-// Copyright 1998-2023 by Bill Spitzak and others.
+// Copyright 1998-2026 by Bill Spitzak and others.
 //
 // This library is free software. Distribution and use rights are outlined in
 // the file "COPYING" which should have been included with this file.  If this
@@ -18,13 +18,27 @@
 
 #include <FL/Fl_Group.H>
 #include <FL/Fl_Button.H>
+#include <FL/Fl_Box.H>
 #include <FL/Fl_Terminal.H>
 #include <FL/Fl_Preferences.H>
+#include <FL/Fl_Shared_Image.H>
+#include <FL/Fl_RGB_Image.H>
+#include <FL/Fl_Text_Buffer.H>
+#include <FL/Fl_Text_Display.H>
+#include <FL/Fl_Graphics_Driver.H>
+#include <FL/Fl_Browser.H>
+#include <FL/Fl_Tree.H>
 #include <FL/fl_callback_macros.H>
 #include <FL/filename.H>
 #include <FL/fl_utf8.h>
 
 #include <string>
+#include <vector>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <limits.h>
+#include <math.h>
 
 
 /* Test additions to Fl_Preferences. */
@@ -50,6 +64,712 @@ TEST(Fl_Preferences, Strings) {
   return true;
 }
 
+/* Test the cache of released shared images. */
+
+// A named 8x8 RGB image, like an image loaded from a file
+class Ut_Shared_Image : public Fl_Shared_Image {
+  Ut_Shared_Image(const char *name, Fl_RGB_Image *rgb) : Fl_Shared_Image(name, rgb) {
+    alloc_image_ = 1;
+  }
+public:
+  static const int bytes = 8 * 8 * 3;
+  static Fl_Shared_Image *load(const char *name) {
+    uchar *data = new uchar[bytes];
+    memset(data, 0x80, bytes);
+    Fl_RGB_Image *rgb = new Fl_RGB_Image(data, 8, 8, 3);
+    rgb->alloc_array = 1;
+    Ut_Shared_Image *img = new Ut_Shared_Image(name, rgb);
+    img->add();
+    return img;
+  }
+};
+
+// Returns true if find() returns every image in images(), and no others
+static bool ut_images_match_find() {
+  Fl_Shared_Image **images = Fl_Shared_Image::images();
+  for (int i = 0; i < Fl_Shared_Image::num_images(); i++) {
+    Fl_Shared_Image *img = images[i];
+    Fl_Shared_Image *found = img->original() ? Fl_Shared_Image::find(img->name())
+                           : Fl_Shared_Image::find(img->name(), img->data_w(), img->data_h());
+    if (found) found->release();
+    if (found != img) return false;
+  }
+  return true;
+}
+
+// Returns true if an image with that name is in the pool. Unlike find(),
+// this doesn't change the order in which released images are evicted.
+static bool ut_in_cache(const char *name) {
+  Fl_Shared_Image **images = Fl_Shared_Image::images();
+  for (int i = 0; i < Fl_Shared_Image::num_images(); i++)
+    if (strcmp(images[i]->name(), name) == 0) return true;
+  return false;
+}
+
+TEST(Fl_Shared_Image, Cache) {
+  size_t old_budget = Fl_Shared_Image::cache_budget();
+  Fl_Shared_Image::cache_budget(0);
+  int num = Fl_Shared_Image::num_images();
+  size_t base = Fl_Shared_Image::cache_bytes();
+  const int bytes = Ut_Shared_Image::bytes;
+  Fl_Shared_Image::cache_budget(base + 4 * bytes);
+  Fl_Shared_Image::cache_reset_stats();
+
+  // released images stay in the cache
+  const char *names[] = { "ut_cache_a", "ut_cache_b", "ut_cache_c", "ut_cache_d" };
+  for (int i = 0; i < 4; i++)
+    Ut_Shared_Image::load(names[i])->release();
+  EXPECT_EQ(Fl_Shared_Image::num_images(), num + 4);
+  EXPECT_EQ((int)(Fl_Shared_Image::cache_bytes() - base), 4 * bytes);
+  EXPECT_TRUE(ut_images_match_find());
+
+  // get() returns the released image: a hit, also moves it to the end of
+  // the eviction order, which is now b, c, d, a
+  Fl_Shared_Image *a = Fl_Shared_Image::get("ut_cache_a");
+  EXPECT_TRUE(a != NULL);
+  EXPECT_EQ(a->refcount(), 1);
+  a->release();
+  EXPECT_EQ((int)Fl_Shared_Image::cache_hits(), 1);
+  EXPECT_EQ((int)Fl_Shared_Image::cache_misses(), 0);
+
+  // an unknown image is a miss
+  EXPECT_TRUE(Fl_Shared_Image::get("ut_cache_no_such_file") == NULL);
+  EXPECT_EQ((int)Fl_Shared_Image::cache_hits(), 1);
+  EXPECT_EQ((int)Fl_Shared_Image::cache_misses(), 1);
+
+  // images from get(Fl_RGB_Image*) can't be found again and are not kept
+  uchar *data = new uchar[bytes];
+  memset(data, 0, bytes);
+  Fl_RGB_Image *rgb = new Fl_RGB_Image(data, 8, 8, 3);
+  rgb->alloc_array = 1;
+  Fl_Shared_Image::get(rgb)->release();
+  EXPECT_EQ(Fl_Shared_Image::num_images(), num + 4);
+  EXPECT_EQ((int)(Fl_Shared_Image::cache_bytes() - base), 4 * bytes);
+
+  // a new image evicts the least recently released image: b
+  Fl_Shared_Image *e = Ut_Shared_Image::load("ut_cache_e");
+  e->release();
+  EXPECT_TRUE(!ut_in_cache("ut_cache_b"));
+  EXPECT_TRUE(ut_in_cache("ut_cache_c"));
+  EXPECT_TRUE(ut_in_cache("ut_cache_a"));
+  EXPECT_TRUE(ut_in_cache("ut_cache_e"));
+
+  // a smaller budget evicts in the same order: c, then d
+  Fl_Shared_Image::cache_budget(base + 2 * bytes);
+  EXPECT_TRUE(!ut_in_cache("ut_cache_c"));
+  EXPECT_TRUE(!ut_in_cache("ut_cache_d"));
+  EXPECT_TRUE(ut_in_cache("ut_cache_a"));
+  EXPECT_TRUE(ut_in_cache("ut_cache_e"));
+  EXPECT_EQ(Fl_Shared_Image::num_images(), num + 2);
+  EXPECT_TRUE(ut_images_match_find());
+
+  // images in use are never evicted
+  a = Fl_Shared_Image::get("ut_cache_a");
+  Fl_Shared_Image::cache_budget(1);
+  EXPECT_TRUE(ut_in_cache("ut_cache_a"));
+  EXPECT_TRUE(!ut_in_cache("ut_cache_e"));
+  a->release();
+
+  // without a budget, released images are destroyed
+  Fl_Shared_Image::cache_budget(0);
+  EXPECT_EQ(Fl_Shared_Image::num_images(), num);
+  EXPECT_TRUE(ut_images_match_find());
+  Fl_Shared_Image::cache_budget(old_budget);
+  return true;
+}
+
+// Returns the path of a file in the directory for temporary files
+static std::string ut_temp_file(const char *name) {
+  const char *dir = fl_getenv("TMPDIR");
+  if (!dir) dir = fl_getenv("TEMP");
+  if (!dir) dir = "/tmp";
+  return std::string(dir) + "/" + name;
+}
+
+// Returns random text of 'words' short words, newlines, and UTF-8 characters
+static std::string ut_random_text(int words) {
+  static const char *w[] = { "a", "bc", "\n", "def ", "\xc3\xa4", "\xe2\x82\xac\n", "\n\n", "ghij" };
+  std::string s;
+  for (int i = 0; i < words; i++) s += w[rand() % 8];
+  return s;
+}
+
+// Returns the start of the UTF-8 character at pos
+static int ut_char_start(const std::string &s, int pos) {
+  while (pos > 0 && pos < (int)s.size() && (s[pos] & 0xc0) == 0x80) pos--;
+  return pos;
+}
+
+// Applies the same random insert(), remove() or replace() to buf and ref
+static void ut_random_edit(Fl_Text_Buffer &buf, std::string &ref) {
+  int len = (int)ref.size();
+  int start = ut_char_start(ref, rand() % (len + 1));
+  int end = ut_char_start(ref, start + rand() % (len - start < 200 ? len - start + 1 : 200));
+  int words = rand() % 50 ? rand() % 20 : rand() % 8000;  // sometimes larger than a piece
+  std::string text = ut_random_text(words);
+  switch (rand() % 3) {
+    case 0:
+      buf.insert(start, text.c_str());
+      ref.insert(start, text);
+      break;
+    case 1:
+      buf.remove(start, end);
+      ref.erase(start, end - start);
+      break;
+    default:
+      buf.replace(start, end, text.c_str());
+      ref.replace(start, end - start, text);
+      break;
+  }
+}
+
+/* Random edits with both storage engines, compared to a std::string. */
+TEST(Fl_Text_Buffer, RandomEdits) {
+  Fl_Text_Buffer::Storage storage[] = { Fl_Text_Buffer::GAP_BUFFER, Fl_Text_Buffer::PIECE_TABLE };
+  for (int i = 0; i < 2; i++) {
+    Fl_Text_Buffer buf(0, 16, storage[i]);
+    std::string ref;
+    bool same = true;
+    srand(7);
+    for (int n = 0; n < 2000 && same; n++) {
+      ut_random_edit(buf, ref);
+      int len = (int)ref.size();
+      char *text = buf.text();
+      if (buf.length() != len || ref != text) same = false;
+      free(text);
+      for (int k = 0; k < 10 && len; k++) {
+        int start = rand() % len, end = start + rand() % (len - start + 1);
+        char *range = buf.text_range(start, end);
+        if (ref.compare(start, end - start, range) != 0) same = false;
+        free(range);
+        if (buf.byte_at(start) != ref[start] || *buf.address(start) != ref[start]) same = false;
+      }
+    }
+    EXPECT_TRUE(same);
+  }
+  return true;
+}
+
+// Returns true if the line functions of buf agree with a search in ref at pos
+static bool ut_lines_match(const Fl_Text_Buffer &buf, const std::string &ref, int pos) {
+  int len = (int)ref.size();
+  size_t nl = pos ? ref.rfind('\n', pos - 1) : std::string::npos;
+  int start = nl == std::string::npos ? 0 : (int)nl + 1;
+  nl = ref.find('\n', pos);
+  int end = nl == std::string::npos ? len : (int)nl;
+  int line = 0;
+  for (int i = 0; i < pos; i++) if (ref[i] == '\n') line++;
+  if (buf.line_start(pos) != start || buf.line_end(pos) != end) return false;
+  if (buf.line_of_position(pos) != line || buf.position_of_line(line) != start) return false;
+  int to = pos + rand() % (len - pos + 1), count = 0;
+  for (int i = pos; i < to; i++) if (ref[i] == '\n') count++;
+  if (buf.count_lines(pos, to) != count) return false;
+  // skip_lines(): the position after the n-th newline from pos, or the end
+  int n = rand() % 5, skip = pos;
+  for (int k = 0; k < n && skip < len; ) if (ref[skip++] == '\n') k++;
+  if (n == 0) skip = pos;
+  if (buf.skip_lines(pos, n) != skip) return false;
+  // rewind_lines(): the start of the n-th line before the one with pos - 1
+  int rewind = pos - 1;
+  if (rewind <= 0) {
+    rewind = 0;
+  } else {
+    int k = -1;
+    for (; rewind >= 0; rewind--)
+      if (ref[rewind] == '\n' && ++k >= n) break;
+    rewind++;
+  }
+  return buf.rewind_lines(pos, n) == rewind;
+}
+
+/* The line functions of both storage engines after random edits. */
+TEST(Fl_Text_Buffer, Lines) {
+  Fl_Text_Buffer::Storage storage[] = { Fl_Text_Buffer::GAP_BUFFER, Fl_Text_Buffer::PIECE_TABLE };
+  for (int i = 0; i < 2; i++) {
+    Fl_Text_Buffer buf(0, 16, storage[i]);
+    std::string ref;
+    bool same = true;
+    srand(11);
+    for (int n = 0; n < 500 && same; n++) {
+      ut_random_edit(buf, ref);
+      int len = (int)ref.size();
+      for (int k = 0; k < 10 && same; k++)
+        same = ut_lines_match(buf, ref, ut_char_start(ref, rand() % (len + 1)));
+      same = same && ut_lines_match(buf, ref, 0) && ut_lines_match(buf, ref, len);
+      int lines = 0;
+      for (int k = 0; k < len; k++) if (ref[k] == '\n') lines++;
+      if (buf.count_lines(0, len) != lines || buf.position_of_line(lines + 1) != len)
+        same = false;
+    }
+    EXPECT_TRUE(same);
+  }
+  return true;
+}
+
+/* Saving a lazily loaded buffer to the file that it was loaded from. */
+TEST(Fl_Text_Buffer, LazySaveSameFile) {
+  std::string name = ut_temp_file("fltk_ut_lazy_save.txt");
+  const char *file = name.c_str();
+  std::string text;
+  for (int i = 0; i < 20000; i++)
+    text += "The quick brown fox jumps over the lazy dog.\n";
+  FILE *fp = fl_fopen(file, "wb");
+  EXPECT_TRUE(fp != NULL);
+  if (!fp) return true;
+  fwrite(text.data(), 1, text.size(), fp);
+  fclose(fp);
+
+  Fl_Text_Buffer::Storage storage[] = { Fl_Text_Buffer::GAP_BUFFER, Fl_Text_Buffer::PIECE_TABLE };
+  for (int i = 0; i < 2; i++) {
+    Fl_Text_Buffer buf(0, 1024, storage[i]);
+    buf.lazy_loading(true);
+    EXPECT_EQ(buf.loadfile(file, 4096), 0);       // loading continues in the background
+    buf.insert(0, "edited\n");
+    text.insert(0, "edited\n");
+    EXPECT_EQ(buf.savefile(file), 0);
+    EXPECT_EQ(buf.length(), (int)text.size());
+    char *saved = buf.text();
+    EXPECT_TRUE(text == saved);                     // still readable after the file was rewritten
+    free(saved);
+
+    Fl_Text_Buffer check;
+    EXPECT_EQ(check.loadfile(file), 0);
+    saved = check.text();
+    EXPECT_TRUE(text == saved);
+    free(saved);
+  }
+  fl_unlink(file);
+  return true;
+}
+
+// Graphics driver that measures text without fonts or a display:
+// at size 14 every character is 5 to 9 pixels wide, or 7 if monospaced,
+// and 'kerning' pixels are taken off for every "AV" in a string
+class Ut_Text_Driver : public Fl_Graphics_Driver {
+  int kerning_;
+  bool mono_;
+public:
+  Ut_Text_Driver(int kerning, bool mono) : kerning_(kerning), mono_(mono) { }
+  double width(const char *str, int n) FL_OVERRIDE {
+    double w = 0;
+    for (const char *p = str, *end = str + n; p < end; ) {
+      int l;
+      w += width(fl_utf8decode(p, end, &l));
+      if (p > str && p[-1] == 'A' && p[0] == 'V') w -= kerning_;
+      p += l;
+    }
+    return w;
+  }
+  double width(unsigned int c) FL_OVERRIDE {
+    return (mono_ ? 7 : 5 + c % 5) * size() / 14.0;
+  }
+  int height() FL_OVERRIDE { return 14; }
+  int descent() FL_OVERRIDE { return 3; }
+};
+
+class Ut_Text_Surface : public Fl_Surface_Device {
+public:
+  Ut_Text_Surface(int kerning = 0, bool mono = false)
+    : Fl_Surface_Device(new Ut_Text_Driver(kerning, mono)) { }
+  ~Ut_Text_Surface() { delete driver(); }
+};
+
+// Text display that exposes its width cache and wrap cache
+class Ut_Text_Display : public Fl_Text_Display {
+public:
+  Ut_Text_Display() : Fl_Text_Display(0, 0, 300, 200) { }
+  // measures the estimated lines of the wrap cache, false if not used
+  bool measure_all() {
+    if (!wrap_cache()) return false;
+    measure_wrapped_lines(0, INT_MAX, INT_MAX);
+    return true;
+  }
+  // measures text in the text font, with the width cache
+  double width(const std::string &text) const {
+    return string_width(text.c_str(), (int)text.size(), 0);
+  }
+  // counts the wrapped lines from start to end without the wrap cache
+  int count_all(int start, int end) const {
+    int retPos, retLines, retLineStart, retLineEnd;
+    wrapped_line_counter(buffer(), start, end, INT_MAX, false, 0,
+                         &retPos, &retLines, &retLineStart, &retLineEnd);
+    return retLines;
+  }
+};
+
+// Returns random text of 'words' words, with a newline every 20 words or so
+static std::string ut_wrap_text(int words) {
+  static const char *w[] = { "lorem ", "ipsum ", "dolor", "\xc3\xa4 ", "\xe2\x82\xac", "sit amet " };
+  std::string s;
+  for (int i = 0; i < words; i++) s += rand() % 20 ? w[rand() % 6] : "\n";
+  return s;
+}
+
+/* The wrapped line counts of a large buffer after random edits. */
+TEST(Fl_Text_Display, WrapCache) {
+  Ut_Text_Surface surface;
+  Fl_Surface_Device::push_current(&surface);
+  Fl_Text_Buffer buf;
+  buf.text((ut_wrap_text(8000) + "\n").c_str());
+  Ut_Text_Display display;
+  display.buffer(&buf);
+  display.wrap_mode(Fl_Text_Display::WRAP_AT_PIXEL, 200);
+  bool same = display.measure_all();
+  for (int n = 0; n < 200 && same; n++) {
+    int len = buf.length();
+    int start = buf.utf8_align(rand() % len);
+    int end = start + rand() % 2000;
+    end = buf.utf8_align(end < len ? end : len);
+    std::string text = ut_wrap_text(rand() % 10 ? rand() % 50 : rand() % 500);
+    switch (len < 20000 ? 0 : rand() % 3) {  // keep the wrap cache in use
+      case 0: buf.insert(start, text.c_str()); break;
+      case 1: buf.remove(start, end); break;
+      default: buf.replace(start, end, text.c_str()); break;
+    }
+    // wrapped_line_counter() miscounts a last line without a newline
+    if (buf.char_at(buf.length() - 1) != '\n') buf.append("\n");
+    if (n % 4 == 0)                       // sometimes change the wrap margin
+      display.wrap_mode(Fl_Text_Display::WRAP_AT_PIXEL, 150 + rand() % 100);
+    if (!display.measure_all()) same = false;
+    len = buf.length();
+    if (display.count_lines(0, len, true) != display.count_all(0, len))
+      same = false;
+    for (int i = 0; i < 10; i++) {
+      int a = buf.utf8_align(rand() % len), b = buf.utf8_align(rand() % len);
+      if (a > b) { int t = a; a = b; b = t; }
+      if (display.count_lines(a, b, false) != display.count_all(a, b))
+        same = false;
+    }
+  }
+  EXPECT_TRUE(same);
+  display.buffer(0);
+  Fl_Surface_Device::pop_current();
+  return true;
+}
+
+/* Cached character widths, compared to fl_width() on different surfaces. */
+TEST(Fl_Text_Display, WidthCache) {
+  static const char *w[] = { "A", "V", "AV", "W", " ", "x", "\xc3\xa4", "\xe2\x82\xac" };
+  Ut_Text_Surface proportional, kerning(2), mono(0, true);
+  Ut_Text_Surface *surfaces[] = { &proportional, &kerning, &mono };
+  Ut_Text_Display display;
+  bool same = true;
+  for (int n = 0; n < 300; n++) {
+    Fl_Surface_Device::push_current(surfaces[n % 3]);  // widths change with the surface..
+    display.textsize(10 + 2 * (n % 4));                 // ..and with the font size
+    std::string text;
+    for (int i = rand() % 20; i > 0; i--) text += w[rand() % 8];
+    double cached = display.width(text);
+    fl_font(display.textfont(), display.textsize());
+    if (fabs(cached - fl_width(text.c_str(), (int)text.size())) > 0.001)
+      same = false;
+    Fl_Surface_Device::pop_current();
+  }
+  EXPECT_TRUE(same);
+  return true;
+}
+
+// Browser with line heights that don't need fonts:
+// 10 pixels, plus 10 for each format_char() and column_char() in the text
+class Ut_Browser : public Fl_Browser {
+public:
+  Ut_Browser() : Fl_Browser(0, 0, 200, 100) { }
+  int item_height(void *item) const override {
+    if (!visible(lineno(item))) return 0;
+    int h = 10;
+    for (const char *p = item_text(item); *p; p++)
+      if (*p == format_char() || *p == column_char()) h += 10;
+    return h;
+  }
+  int position(int line) const { return item_position(find_line(line)); }
+  int line_at(int pos) const { int p; return lineno(item_at_position(pos, &p)); }
+  int total() const { return full_height(); }
+};
+
+/* Cached line heights and positions of Fl_Browser. */
+TEST(Fl_Browser, Positions) {
+  Ut_Browser b;
+  b.add("a");
+  b.add("b#c");
+  b.add("d");
+  b.add("e");
+  EXPECT_EQ(b.total(), 40);
+  EXPECT_EQ(b.position(3), 20);
+
+  // setters that change the line heights
+  b.format_char('#');
+  EXPECT_EQ(b.total(), 50);
+  EXPECT_EQ(b.position(3), 30);
+  EXPECT_EQ(b.line_at(29), 2);
+  EXPECT_EQ(b.line_at(30), 3);
+  b.column_char('d');
+  EXPECT_EQ(b.total(), 60);
+  EXPECT_EQ(b.position(4), 50);
+
+  // the spacing is added to every line that is not hidden
+  b.linespacing(2);
+  EXPECT_EQ(b.total(), 68);
+  EXPECT_EQ(b.position(4), 56);
+  b.hide(2);
+  EXPECT_EQ(b.total(), 46);
+  EXPECT_EQ(b.position(3), 12);
+  EXPECT_EQ(b.position(4), 34);
+  EXPECT_EQ(b.line_at(11), 1);
+  EXPECT_EQ(b.line_at(12), 3);
+  EXPECT_EQ(b.line_at(1000), 4);
+  b.show(2);
+  EXPECT_EQ(b.total(), 68);
+  EXPECT_EQ(b.position(4), 56);
+
+  b.format_char('@');
+  EXPECT_EQ(b.total(), 58);
+  EXPECT_EQ(b.position(3), 24);
+  b.remove(1);
+  EXPECT_EQ(b.total(), 46);
+  EXPECT_EQ(b.position(3), 34);
+  return true;
+}
+
+// Returns the first child of 'dir' with the label 'name', without the label index
+static Fl_Tree_Item *ut_find_child(Fl_Tree_Item *dir, const char *name) {
+  for (int i = 0; i < dir->children(); i++)
+    if (dir->child(i)->label() && strcmp(dir->child(i)->label(), name) == 0)
+      return dir->child(i);
+  return 0;
+}
+
+/* Finding tree items by their label while items are renamed, added and removed. */
+TEST(Fl_Tree, FindByLabel) {
+  Fl_Tree tree(0, 0, 200, 200);
+  tree.sortorder(FL_TREE_SORT_ASCENDING);
+  char name[32], path[40];
+  for (int i = 0; i < 100; i++) {
+    snprintf(path, sizeof(path), "dir/n%03d", i * 2);
+    tree.add(path);
+  }
+  Fl_Tree_Item *dir = tree.find_item("dir");
+  EXPECT_TRUE(dir != NULL);
+  if (!dir) return true;
+  EXPECT_EQ(dir->children(), 100);
+  EXPECT_TRUE(tree.find_item("dir/n100") == dir->child(50));
+
+  srand(5);
+  bool same = true;
+  for (int n = 0; n < 1000 && same; n++) {
+    snprintf(name, sizeof(name), "n%03d", rand() % 250);
+    snprintf(path, sizeof(path), "dir/%s", name);
+    int op = rand() % 4, i = rand() % dir->children();
+    if (op == 0) {                              // rename
+      dir->child(i)->label(name);
+    } else if (op == 1) {                       // add sorted: before the first larger label
+      bool exists = ut_find_child(dir, name) != NULL;
+      int pos = 0;
+      while (pos < dir->children() && strcmp(dir->child(pos)->label(), name) <= 0) pos++;
+      Fl_Tree_Item *item = tree.add(path);      // NULL if the path exists
+      if (exists ? item != NULL : item != dir->child(pos)) same = false;
+    } else if (op == 2) {                       // insert anywhere
+      tree.insert(dir, name, i);
+    } else if (dir->children() > 40) {          // remove
+      tree.remove(dir->child(i));
+    }
+    for (int k = 0; k < 250; k++) {
+      snprintf(name, sizeof(name), "n%03d", k);
+      snprintf(path, sizeof(path), "dir/%s", name);
+      Fl_Tree_Item *ref = ut_find_child(dir, name);
+      if (dir->find_child_item(name) != ref || tree.find_item(path) != ref)
+        same = false;
+    }
+  }
+  EXPECT_TRUE(same);
+  return true;
+}
+
+// Appends the items that the tree displays, in display order, without the index
+static void ut_displayed_items(Fl_Tree_Item *item, bool show, std::vector<Fl_Tree_Item*> &v) {
+  if (!item->visible()) return;
+  if (show) v.push_back(item);
+  if (item->is_open())
+    for (int i = 0; i < item->children(); i++)
+      ut_displayed_items(item->child(i), true, v);
+}
+
+// Returns true if the tree walks and finds its displayed items as expected
+static bool ut_tree_rows_match(Fl_Tree &tree, bool clicks) {
+  std::vector<Fl_Tree_Item*> ref;
+  ut_displayed_items(tree.root(), tree.showroot() != 0, ref);
+  Fl_Tree_Item *item = ref.empty() ? 0 : ref[0];
+  for (size_t i = 0; i < ref.size(); i++) {
+    if (item != ref[i]) return false;
+    Fl_Tree_Item *next = tree.next_visible_item(item, FL_Down);
+    if (i > 0 && tree.next_visible_item(item, FL_Up) != ref[i - 1]) return false;
+    item = next;
+  }
+  if (item) return false;
+  if (!clicks) return true;
+  Fl::e_x = tree.x() + tree.w() / 2;
+  int top = tree.y() + Fl::box_dy(tree.box()) + tree.margintop();
+  for (size_t i = 0; i < ref.size(); i++) {
+    Fl::e_y = top + ref[i]->h() / 2;        // the middle of the item
+    if (tree.find_clicked(1) != ref[i]) return false;
+    top += ref[i]->h();
+  }
+  return true;
+}
+
+/* Walking and clicking the displayed items while the tree changes. */
+TEST(Fl_Tree, DisplayedItems) {
+  Ut_Text_Surface surface;                  // no fonts needed
+  Fl_Surface_Device::push_current(&surface);
+  Fl_Tree tree(0, 0, 200, 300);
+  tree.end();
+  char path[40];
+  bool same = true;
+  for (int n = 0; n < 2000 && same; n++) {
+    std::vector<Fl_Tree_Item*> items;
+    for (Fl_Tree_Item *item = tree.first(); item; item = tree.next(item))
+      items.push_back(item);
+    Fl_Tree_Item *item = items[rand() % items.size()];
+    switch (rand() % 8) {
+      case 0: case 1: case 2:
+        snprintf(path, sizeof(path), "%c/%c/%c", 'a' + rand() % 4, 'a' + rand() % 4, 'a' + rand() % 8);
+        path[2 * (rand() % 3) + 1] = 0;
+        tree.add(path);
+        break;
+      case 3:
+        if (item != tree.root()) tree.remove(item);
+        break;
+      case 4: case 5: case 6:
+        if (item != tree.root()) { if (item->is_open()) tree.close(item, 0); else tree.open(item, 0); }
+        break;
+      default:
+        tree.showroot(!tree.showroot());
+        break;
+    }
+    if (!ut_tree_rows_match(tree, false)) same = false;  // before calc_tree()
+    tree.calc_tree();
+    if (!ut_tree_rows_match(tree, true)) same = false;   // with the index
+  }
+  EXPECT_TRUE(same);
+  Fl_Surface_Device::pop_current();
+  return true;
+}
+
+/* Test the order in which timeouts run. */
+static std::string ut_timeouts;           // one letter per timeout that ran
+
+static void ut_timeout_cb(void *d) {
+  ut_timeouts += (char)(fl_intptr_t)d;
+}
+
+static void ut_repeat_cb(void *d) {
+  ut_timeouts += 'r';
+  int *count = (int *)d;
+  if (--*count > 0) Fl::repeat_timeout(0.002, ut_repeat_cb, d);
+}
+
+static void ut_add_first_cb(void *) {     // adds a timeout that expired long ago
+  ut_timeouts += 'A';
+  Fl::add_timeout(-1.0, ut_timeout_cb, (void *)'Y');
+}
+
+static void ut_readd_cb(void *) {         // adds itself again without delay
+  ut_timeouts += '0';
+  Fl::add_timeout(0.0, ut_readd_cb);
+}
+
+static void ut_run_timeouts() {           // run all timeouts but ut_readd_cb
+  for (int i = 0; i < 200; i++) {
+    std::vector<Fl::TimeoutData> list = Fl::timeout_list();
+    if (list.empty()) break;
+    Fl::wait(0.01);
+  }
+}
+
+TEST(Fl_Timeout, Order) {
+  // by expiration time, then in the order they were added
+  ut_timeouts.clear();
+  Fl::add_timeout(0.03, ut_timeout_cb, (void *)'d');
+  Fl::add_timeout(0.01, ut_timeout_cb, (void *)'a');
+  Fl::add_timeout(0.02, ut_timeout_cb, (void *)'b');
+  Fl::add_timeout(0.02, ut_timeout_cb, (void *)'c');
+  Fl::add_timeout(0.015, ut_timeout_cb, (void *)'x');
+  Fl::add_timeout(0.025, ut_timeout_cb, (void *)'x');
+  EXPECT_TRUE(Fl::has_timeout(ut_timeout_cb, (void *)'x'));
+  EXPECT_TRUE(Fl::has_timeout(ut_timeout_cb, (void *)'a'));
+  EXPECT_TRUE(!Fl::has_timeout(ut_timeout_cb, (void *)'e'));
+  Fl::remove_timeout(ut_timeout_cb, (void *)'x');  // removes both
+  EXPECT_TRUE(!Fl::has_timeout(ut_timeout_cb, (void *)'x'));
+  EXPECT_EQ((int)Fl::timeout_list().size(), 4);
+  ut_run_timeouts();
+  EXPECT_STREQ(ut_timeouts.c_str(), "abcd");
+  EXPECT_TRUE(!Fl::has_timeout(ut_timeout_cb, (void *)'a'));
+
+  // repeat_timeout() reschedules a running timeout
+  ut_timeouts.clear();
+  int count = 3;
+  Fl::add_timeout(0.001, ut_repeat_cb, &count);
+  Fl::add_timeout(0.1, ut_timeout_cb, (void *)'e');
+  ut_run_timeouts();
+  EXPECT_STREQ(ut_timeouts.c_str(), "rrre");
+  EXPECT_EQ(count, 0);
+
+  // NULL data removes all timeouts of a callback
+  Fl::add_timeout(0.01, ut_timeout_cb, (void *)'f');
+  Fl::add_timeout(0.02, ut_timeout_cb, (void *)'g');
+  Fl::remove_timeout(ut_timeout_cb);
+  EXPECT_TRUE(!Fl::has_timeout(ut_timeout_cb));
+  EXPECT_TRUE(Fl::timeout_list().empty());
+
+  // timeouts added by a timeout callback run after the timeouts that
+  // expired before, even if they expire first (issue #450)
+  ut_timeouts.clear();
+  Fl::add_timeout(-0.003, ut_add_first_cb);      // all expired already
+  Fl::add_timeout(-0.002, ut_timeout_cb, (void *)'Z');
+  Fl::add_timeout(-0.001, ut_timeout_cb, (void *)'z');
+  ut_run_timeouts();
+  EXPECT_STREQ(ut_timeouts.c_str(), "AZzY");
+
+  // a timeout that adds itself again runs once per wait
+  ut_timeouts.clear();
+  Fl::add_timeout(0.0, ut_readd_cb);
+  Fl::wait(0.0);
+  EXPECT_TRUE(ut_timeouts.size() >= 1 && ut_timeouts.size() <= 2);
+  Fl::remove_timeout(ut_readd_cb);
+  EXPECT_TRUE(!Fl::has_timeout(ut_readd_cb));
+  return true;
+}
+
+/* Test the widget watch list, with many pointers to the same widgets. */
+TEST(Fl, WatchWidgetPointer) {
+  Fl_Group *group = new Fl_Group(0, 0, 100, 100);
+  group->end();
+  Fl_Widget *a = new Fl_Box(0, 0, 10, 10);
+  Fl_Widget *b = new Fl_Box(0, 0, 10, 10);
+  group->add(a);
+  Fl_Widget *pa1 = a, *pa2 = a, *pb = b, *pn = b;
+  Fl::watch_widget_pointer(pa1);
+  Fl::watch_widget_pointer(pa2);
+  Fl::watch_widget_pointer(pb);
+  Fl::watch_widget_pointer(pn);
+  Fl::watch_widget_pointer(pn);             // watching twice is fine
+  pn = 0;                                   // may be set to NULL while watched
+  pb = a;                                   // points to another widget now..
+  Fl::watch_widget_pointer(pb);             // ..so it must be watched again
+  Fl::release_widget_pointer(pa2);
+  delete b;
+  EXPECT_TRUE(pa1 == a);
+  EXPECT_TRUE(pb == a);
+  delete group;                             // deletes 'a'
+  EXPECT_TRUE(pa1 == 0);
+  EXPECT_TRUE(pa2 == a);                    // released before
+  EXPECT_TRUE(pb == 0);
+  EXPECT_TRUE(pn == 0);
+  Fl::release_widget_pointer(pa1);
+  Fl::release_widget_pointer(pb);
+  Fl::release_widget_pointer(pn);
+  return true;
+}
+
 #if 0
 
 TEST(fl_filename, ext) {
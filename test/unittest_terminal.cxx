@@ -1,7 +1,7 @@
 //
 // Unit tests for the Fast Light Tool Kit (FLTK).
 //
-// Copyright 1998-2022 by Bill Spitzak and others.
+// Copyright 1998-2026 by Bill Spitzak and others.
 //
 // This library is free software. Distribution and use rights are outlined in
 // the file "COPYING" which should have been included with this file.  If this
@@ -17,9 +17,157 @@
 #include "unittests.h"
 
 #include <time.h>
+#include <stdlib.h>
+#include <string.h>
+#include <deque>
+#include <vector>
 #include <FL/Fl_Group.H>
+#include <FL/Fl_Button.H>
 #include <FL/Fl_Terminal.H>
 
+//
+//------- test the Fl_Terminal history against a plain model ----------
+//
+class Ut_Terminal : public Fl_Terminal {
+public:
+  typedef Fl_Terminal::RingBuffer RingBuffer;
+  typedef Fl_Terminal::Utf8Char Utf8Char;
+  typedef Fl_Terminal::CharStyle CharStyle;
+  // never shown, so no display is needed
+  Ut_Terminal() : Fl_Terminal(0, 0, 400, 300, 0, 6, 20, 50) { }
+  const Utf8Char *disp_row(int drow) const { return u8c_disp_row(drow); }
+  Utf8Char *hist_use_row(int hrow) { return u8c_hist_use_row(hrow); }
+  int history_use() const { return hist_use(); }
+};
+
+typedef Ut_Terminal::Utf8Char Ut_Char;
+typedef std::vector<Ut_Char> Ut_Row;
+
+static bool ut_same_char(const Ut_Char &a, const Ut_Char &b) {
+  return a.length() == b.length() && memcmp(a.text_utf8(), b.text_utf8(), a.length()) == 0 &&
+         a.attrib() == b.attrib() && a.charflags() == b.charflags() &&
+         a.fgcolor() == b.fgcolor() && a.bgcolor() == b.bgcolor();
+}
+
+// Returns true if the history in use and the display hold the rows of the model.
+// Reads through the const methods, so packed history rows stay packed.
+static bool ut_ring_matches(const Ut_Terminal::RingBuffer &ring, const std::deque<Ut_Row> &model) {
+  const int hist_use = ring.hist_use();
+  if ((int)model.size() != hist_use + ring.disp_rows()) return false;
+  for (int row = 0; row < (int)model.size(); row++) {
+    const Ut_Char *u8c = (row < hist_use) ? ring.u8c_hist_use_row(row)
+                                          : ring.u8c_disp_row(row - hist_use);
+    for (int col = 0; col < ring.ring_cols(); col++)
+      if ((int)model[row].size() != ring.ring_cols() || !ut_same_char(u8c[col], model[row][col]))
+        return false;
+  }
+  return true;
+}
+
+// Randomly scrolls, writes into display and history rows, resizes and clears
+// the history, and compares the ring buffer to a deque of plain rows that
+// holds the history in use followed by the display.
+TEST(Fl_Terminal, RingBuffer) {
+  static const char *text[] = { "a", " ", "Z", "\xc3\xa9", "\xe2\x82\xac", "\xf0\x9f\x98\x80" };
+  Ut_Terminal::CharStyle style(true), blank(true);
+  int drows = 5, cols = 12, hrows = 20;
+  Ut_Terminal::RingBuffer ring(drows, cols, hrows);
+  std::deque<Ut_Row> model(drows, Ut_Row(cols));
+  Ut_Char cleared;
+  srand(3);
+  for (int n = 0; n < 20000; n++) {
+    int op = rand() % 16;
+    if (op < 7) {                               // write into the display
+      int row = rand() % drows, col = rand() % cols;
+      const char *t = text[rand() % 6];
+      style.attrib(uchar(rand() % 4));
+      style.fgcolor(Fl_Color(rand() % 3));
+      style.bgcolor(Fl_Color((rand() % 2) * 0x11223300));
+      ring.u8c_disp_row(row)[col].text_utf8(t, (int)strlen(t), style);
+      model[model.size() - drows + row][col] = ring.u8c_disp_row(row)[col];
+    } else if (op < 9 && ring.hist_use()) {     // write into the history
+      int row = rand() % ring.hist_use(), col = rand() % cols;
+      style.attrib(uchar(rand() % 4));
+      ring.u8c_hist_use_row(row)[col].text_utf8("Q", 1, style);
+      model[row][col] = ring.u8c_hist_use_row(row)[col];
+    } else if (op < 12) {                       // scroll up into the history
+      int rows = 1 + rand() % 7, hist_use = ring.hist_use();
+      blank.bgcolor(Fl_Color(rand() % 3));
+      cleared.clear(blank);
+      ring.scroll(rows, blank);
+      if (rows > drows) rows = drows;
+      for (int i = 0; i < rows; i++) model.push_back(Ut_Row(cols, cleared));
+      hist_use += rows;
+      if (hist_use > hrows) hist_use = hrows;
+      while ((int)model.size() > hist_use + drows) model.pop_front();
+    } else if (op < 13) {                       // scroll down, history unchanged
+      int rows = 1 + rand() % 7;
+      cleared.clear(blank);
+      ring.scroll(-rows, blank);
+      if (rows > drows) rows = drows;
+      for (int i = 0; i < rows; i++) {
+        model.erase(model.end() - 1);
+        model.insert(model.end() - (drows - 1), Ut_Row(cols, cleared));
+      }
+    } else if (op < 15) {                       // resize, keeping the bottom rows
+      int new_drows = 2 + rand() % 6, new_cols = 4 + rand() % 12, new_hrows = rand() % 25;
+      if (rand() % 2) {                         // only move rows between display and history
+        new_cols = cols;
+        new_hrows = hrows + drows - new_drows;
+        if (new_hrows < 0) { new_drows += new_hrows; new_hrows = 0; }
+      }
+      int hist_use = ring.hist_use() + drows - new_drows;
+      if (hist_use < 0) hist_use = 0;
+      if (hist_use > new_hrows) hist_use = new_hrows;
+      ring.resize(new_drows, new_cols, new_hrows, blank);
+      drows = new_drows; cols = new_cols; hrows = new_hrows;
+      while ((int)model.size() > hist_use + drows) model.pop_front();
+      while ((int)model.size() < hist_use + drows) model.push_front(Ut_Row(cols));
+      for (size_t row = 0; row < model.size(); row++) model[row].resize(cols);
+    } else {                                    // what Fl_Terminal::clear_history() does
+      ring.clear_hist();
+      model.erase(model.begin(), model.end() - drows);
+    }
+    EXPECT_TRUE(ut_ring_matches(ring, model));
+    if (!ut_ring_matches(ring, model)) break;   // one failure is enough
+  }
+
+  // Scroll many rows of new colors through a small history, so that the
+  // history drops the styles of rows that are gone now and then
+  Ut_Terminal::RingBuffer small(3, 8, 40);     // more history rows than cached ones
+  model.assign(3, Ut_Row(8));
+  cleared.clear(blank);
+  for (int n = 0; n < 2000; n++) {
+    Ut_Char *u8c = small.u8c_disp_row(2);
+    for (int col = 0; col < 8; col++) {
+      style.fgcolor(Fl_Color((n * 8 + col) << 8));
+      u8c[col].text_utf8(text[col % 6], (int)strlen(text[col % 6]), style);
+      model.back()[col] = u8c[col];
+    }
+    small.scroll(1, blank);
+    model.push_back(Ut_Row(8, cleared));
+    while ((int)model.size() > small.hist_use() + 3) model.pop_front();
+    if (!ut_ring_matches(small, model)) break;
+  }
+  EXPECT_EQ(small.hist_use(), 40);
+  EXPECT_TRUE(ut_ring_matches(small, model));
+
+  // Fl_Terminal::clear_history() empties the history and keeps the display
+  Ut_Terminal tty;
+  for (int i = 0; i < 30; i++) tty.printf("line %d\n", i);
+  EXPECT_EQ(tty.history_use(), 25);
+  tty.hist_use_row(0)[0].text_ascii('X', blank);
+  Ut_Row top(tty.disp_row(0), tty.disp_row(0) + tty.display_columns());
+  tty.clear_history();
+  EXPECT_EQ(tty.history_use(), 0);
+  bool same = true;
+  for (int col = 0; col < tty.display_columns(); col++)
+    if (!ut_same_char(tty.disp_row(0)[col], top[col])) same = false;
+  EXPECT_TRUE(same);
+  EXPECT_EQ(*tty.disp_row(0)->text_utf8(), 'l');
+  return true;
+}
+
 //
 //------- test the Fl_Terminal drawing capabilities ----------
 //
@@ -71,6 +219,32 @@ class Ut_Terminal_Test : public Fl_Group {
     tty->printf("The time and date is now: %s", ctime(&lt));
     Fl::repeat_timeout(3.0, date_timer_cb, data);
   }
+  // Fills the screen with colored text like a build log,
+  // then measures how fast the whole screen can be redrawn.
+  static void redraw_bench_cb(Fl_Widget *, void *data) {
+    Ut_Terminal_Test *t = (Ut_Terminal_Test*)data;
+    Fl_Terminal *tty = t->tty1;
+    const int rows = tty->display_rows(), cols = tty->display_columns();
+    tty->clear_screen_home();
+    for (int r = 0; r < rows; r++) {
+      for (int c = 0; c < cols; c += 8)
+        tty->printf("\033[%dm%-8.*s", 31 + (r + c / 8) % 7, cols - c, "compile ");
+      if (r < rows - 1) tty->append("\033[0m\n");
+    }
+    tty->append("\033[0m");
+    const int frames = 100;
+    Fl::flush();
+    Fl_Timestamp start = Fl::now();
+    for (int i = 0; i < frames; i++) {
+      tty->redraw();
+      Fl::flush();
+    }
+    double secs = Fl::seconds_since(start);
+    t->tty2->printf("Redraw %dx%d cells: %.0f frames/s, %.1f Mcells/s\n", cols, rows,
+                    frames / secs, frames * (double)rows * cols / secs / 1e6);
+    tty->clear_screen_home();
+    t->ansi_test_pattern(tty);
+  }
 public:
   static Fl_Widget *create() {
     return new Ut_Terminal_Test(UT_TESTAREA_X, UT_TESTAREA_Y, UT_TESTAREA_W, UT_TESTAREA_H);
@@ -91,6 +265,11 @@ public:
     gray_test_pattern(tty2);
     Fl::add_timeout(0.5, date_timer_cb, (void*)tty2);
 
+    Fl_Button *bench = new Fl_Button(x+w-120, y, 120, 20, "Redraw benchmark");
+    bench->labelsize(12);
+    bench->tooltip("Redraws Tty 1 full of colored text and shows the speed in Tty 2");
+    bench->callback(redraw_bench_cb, (void*)this);
+
     end();
   }
 };